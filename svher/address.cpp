@@ -9,6 +9,7 @@
 #include "address.h"
 #include "endian.h"
 #include "log.h"
+#include "dns.h"
 
 namespace svher {
 
@@ -75,14 +76,8 @@ namespace svher {
         return result;
     }
 
-    bool Address::Lookup(std::vector<Address::ptr> &results, const std::string &host, int family, int type, int protocol) {
-        addrinfo hints, *ans;
-        memset(&hints, 0, sizeof(hints));
-        hints.ai_family = family;
-        hints.ai_socktype = type;
-        hints.ai_protocol = protocol;
-        std::string node;
-        const char* service = nullptr;
+    // 拆分 host:port / [ipv6]:port，没有端口时 service 为空
+    static void SplitHost(const std::string& host, std::string& node, std::string& service) {
         if (!host.empty() && host[0] == '[') {
             // The memchr() and memrchr() functions return a pointer to the matching byte
             const char* endipv6 = (const char*)memchr(host.c_str() + 1, ']', host.size() - 1);
@@ -96,11 +91,11 @@ namespace svher {
             }
         }
         if (node.empty()) {
-            service = (const char*)memchr(host.c_str(), ':', host.size());
-            if (service) {
-                if (!memchr(service + 1, ':', host.c_str() + host.size() - service - 1)) {
-                    node = host.substr(0, service - host.c_str());
-                    ++service;
+            const char* pos = (const char*)memchr(host.c_str(), ':', host.size());
+            if (pos) {
+                if (!memchr(pos + 1, ':', host.c_str() + host.size() - pos - 1)) {
+                    node = host.substr(0, pos - host.c_str());
+                    service = pos + 1;
                 }
             }
         }
@@ -108,7 +103,17 @@ namespace svher {
         if (node.empty()) {
             node = host;
         }
-        int error = getaddrinfo(node.c_str(), service, &hints, &ans);
+    }
+
+    bool Address::Lookup(std::vector<Address::ptr> &results, const std::string &host, int family, int type, int protocol) {
+        addrinfo hints, *ans;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = family;
+        hints.ai_socktype = type;
+        hints.ai_protocol = protocol;
+        std::string node, service;
+        SplitHost(host, node, service);
+        int error = getaddrinfo(node.c_str(), service.empty() ? nullptr : service.c_str(), &hints, &ans);
         if (error) {
             LOG_ERROR(g_logger) << "Address::Lookup getaddress(" << host
                     << ", " << family << ", " << type << ") err=" << error
@@ -124,6 +129,32 @@ namespace svher {
         return true;
     }
 
+    bool Address::LookupAsync(std::vector<Address::ptr> &results, const std::string &host, int family, int type, int protocol) {
+        std::string node, service;
+        SplitHost(host, node, service);
+        uint16_t port = 0;
+        if (!service.empty()) {
+            char* end = nullptr;
+            long v = strtol(service.c_str(), &end, 10);
+            if (*end || v < 0 || v > 65535) {
+                // 服务名 (如 "http") 需要查 /etc/services，交给 getaddrinfo
+                return Lookup(results, host, family, type, protocol);
+            }
+            port = (uint16_t)v;
+        }
+        std::vector<IPAddress::ptr> addrs;
+        if (!DnsMgr::GetInstance()->resolve(addrs, node, family)) {
+            LOG_ERROR(g_logger) << "Address::LookupAsync resolve(" << host
+                    << ", " << family << ") failed";
+            return false;
+        }
+        for (auto& i : addrs) {
+            i->setPort(port);
+            results.push_back(i);
+        }
+        return true;
+    }
+
     Address::ptr Address::LookupAny(const std::string &host, int family, int type, int protocol) {
         std::vector<Address::ptr> results;
         if (Lookup(results, host, family, type, protocol)) {
@@ -132,6 +163,25 @@ namespace svher {
         return nullptr;
     }
 
+    Address::ptr Address::LookupAnyAsync(const std::string &host, int family, int type, int protocol) {
+        std::vector<Address::ptr> results;
+        if (LookupAsync(results, host, family, type, protocol)) {
+            return results[0];
+        }
+        return nullptr;
+    }
+
+    IPAddress::ptr Address::LookupAnyIPAddressAsync(const std::string &host, int family, int type, int protocol) {
+        std::vector<Address::ptr> results;
+        if (LookupAsync(results, host, family, type, protocol)) {
+            for (auto& i : results) {
+                IPAddress::ptr v = std::dynamic_pointer_cast<IPAddress>(i);
+                if (v) return v;
+            }
+        }
+        return nullptr;
+    }
+
     IPAddress::ptr Address::LookupAnyIPAddress(const std::string &host, int family, int type, int protocol) {
         std::vector<Address::ptr> results;
         if (Lookup(results, host, family, type, protocol)) {
@@ -396,7 +446,7 @@ namespace svher {
         if (!path.empty() && path[0] == '\0') {
             --m_length;
         }
-        if (m_length <= sizeof(m_addr.sun_path)) {
+        if (m_length > sizeof(m_addr.sun_path)) {
             throw std::logic_error("path too long");
         }
         memcpy(&m_addr.sun_path, path.c_str(), m_length);
@@ -20,6 +20,11 @@ namespace svher {
                            int family = AF_INET, int type = 0, int protocol = 0);
         static Address::ptr LookupAny(const std::string& host, int family = AF_INET, int type = 0, int protocol = 0);
         static std::shared_ptr<IPAddress> LookupAnyIPAddress(const std::string& host, int family = AF_INET, int type = 0, int protocol = 0);
+        // 通过 DnsResolver 解析，协程中不会阻塞线程，每个地址只返回一项
+        static bool LookupAsync(std::vector<Address::ptr>& results, const std::string& host,
+                                int family = AF_INET, int type = 0, int protocol = 0);
+        static Address::ptr LookupAnyAsync(const std::string& host, int family = AF_INET, int type = 0, int protocol = 0);
+        static std::shared_ptr<IPAddress> LookupAnyIPAddressAsync(const std::string& host, int family = AF_INET, int type = 0, int protocol = 0);
         static bool GetInterfaceAddresses(std::multimap<std::string, std::pair<Address::ptr, uint32_t>>& results, int family = AF_INET);
         static bool GetInterfaceAddresses(std::vector<std::pair<Address::ptr, uint32_t>>& results, const std::string& iface, int family = AF_INET);
         virtual ~Address() = default;
@@ -284,6 +284,11 @@ namespace svher {
         m_root->next = nullptr;
     }
 
+    void ByteArray::reset() {
+        m_position = m_size = 0;
+        m_cur = m_root;
+    }
+
     void ByteArray::write(const void *buf, size_t size) {
         if (!size) return;
         addCapacity(size);
@@ -363,6 +368,19 @@ namespace svher {
         }
     }
 
+    void ByteArray::commitWrite(size_t n) {
+        if (n > getCapacity()) {
+            throw std::out_of_range("commitWrite");
+        }
+        size_t npos = m_position % m_blockSize + n;
+        m_position += n;
+        if (m_position > m_size) m_size = m_position;
+        while (npos >= m_blockSize) {
+            npos -= m_blockSize;
+            m_cur = m_cur->next;
+        }
+    }
+
     bool ByteArray::writeToFile(const std::string &name) const {
         std::ofstream ofs;
         ofs.open(name, std::ios::trunc | std::ios::binary);
@@ -422,7 +440,11 @@ namespace svher {
         int oldCapacity = getCapacity();
         size -= oldCapacity;
         size_t count = size / m_blockSize + 1;
+        // 接在链表末尾，m_cur 之后可能还有已分配的节点
         Node* tmp = m_cur;
+        while (tmp->next) {
+            tmp = tmp->next;
+        }
         for (size_t i = 0; i < count; ++i) {
             tmp->next = new Node(m_blockSize);
             tmp = tmp->next;
@@ -497,16 +519,18 @@ namespace svher {
         uint64_t size = len;
         size_t npos = m_position % m_blockSize;
         size_t left = m_blockSize - npos;
+        // 只取数据，不移动读位置
+        Node* cur = m_cur;
 
         struct iovec iov;
 
         if (left > len) {
-            iov.iov_base = m_cur->ptr + npos;
+            iov.iov_base = cur->ptr + npos;
             iov.iov_len = len;
             buffers.push_back(iov);
             return len;
         } else {
-            iov.iov_base = m_cur->ptr + npos;
+            iov.iov_base = cur->ptr + npos;
             iov.iov_len = left;
             buffers.push_back(iov);
             len -= left;
@@ -514,14 +538,14 @@ namespace svher {
 
         size_t cnt = len / m_blockSize;
         for (size_t i = 0; i < cnt; i++) {
-            m_cur = m_cur->next;
-            iov.iov_base = m_cur->ptr;
+            cur = cur->next;
+            iov.iov_base = cur->ptr;
             iov.iov_len = m_blockSize;
             buffers.push_back(iov);
         }
-        m_cur = m_cur->next;
+        cur = cur->next;
         if (len % m_blockSize) {
-            iov.iov_base = m_cur->ptr;
+            iov.iov_base = cur->ptr;
             iov.iov_len = len % m_blockSize;
             buffers.push_back(iov);
         }
@@ -581,18 +605,18 @@ namespace svher {
         size_t npos = m_position % m_blockSize;
         size_t left = m_blockSize - npos;
 
-        struct iovec iov;
+        // 写入后由调用方 commitWrite 提交
+        Node* cur = m_cur;
 
-        m_position += len;
-        if (len > m_size) m_size = len;
+        struct iovec iov;
 
         if (left > len) {
-            iov.iov_base = m_cur->ptr + npos;
+            iov.iov_base = cur->ptr + npos;
             iov.iov_len = len;
             buffers.push_back(iov);
             return len;
         } else {
-            iov.iov_base = m_cur->ptr + npos;
+            iov.iov_base = cur->ptr + npos;
             iov.iov_len = left;
             buffers.push_back(iov);
             len -= left;
@@ -600,14 +624,14 @@ namespace svher {
 
         size_t cnt = len / m_blockSize;
         for (size_t i = 0; i < cnt; i++) {
-            m_cur = m_cur->next;
-            iov.iov_base = m_cur->ptr;
+            cur = cur->next;
+            iov.iov_base = cur->ptr;
             iov.iov_len = m_blockSize;
             buffers.push_back(iov);
         }
-        m_cur = m_cur->next;
+        cur = cur->next;
         if (len % m_blockSize) {
-            iov.iov_base = m_cur->ptr;
+            iov.iov_base = cur->ptr;
             iov.iov_len = len % m_blockSize;
             buffers.push_back(iov);
         }
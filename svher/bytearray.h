@@ -71,11 +71,14 @@ namespace svher {
         std::string readStringVint();
 
         void clear();
+        // 清空内容但保留已分配的节点，反复写入时不再分配
+        void reset();
 
         void write(const void *buf, size_t size);
         void read(void *buf, size_t size, bool peek = false);
 
         size_t getPosition() const { return m_position; }
+        // 不能超过已写入大小
         void setPosition(size_t v);
 
         bool writeToFile(const std::string& name) const;
@@ -91,9 +94,13 @@ namespace svher {
         std::string toString();
         std::string toHexString(uint16_t cnt = 16);
 
+        // 从当前位置取出最多 len 字节可读数据的 iovec，不移动位置
         size_t getReadBuffers(std::vector<iovec>& buffers, size_t len = ~0ull);
         size_t getReadBuffers(std::vector<iovec>& buffers, size_t len, size_t position) const;
+        // 在当前位置预留 len 字节可写空间，写入 n 字节后 commitWrite(n) 提交
         size_t getWriteBuffers(std::vector<iovec>& buffers, size_t len);
+        // 提交 getWriteBuffers 中写入的 n 字节，位置前移并扩展 size
+        void commitWrite(size_t n);
     private:
         void addCapacity(size_t size);
         size_t getCapacity() const { return m_capacity - m_position; }
@@ -0,0 +1,279 @@
+#pragma once
+
+#include <memory>
+#include <deque>
+#include <list>
+#include <vector>
+#include <cerrno>
+#include "fibersync.h"
+#include "thread.h"
+#include "util.h"
+
+namespace svher {
+
+    // 协程间传递数据的通道，阻塞时只挂起当前协程 (普通线程中则阻塞线程)
+    // capacity 为 0 表示无界，send 永不阻塞
+    // 阻塞中遇到协程截止时间或取消时 send/recv 返回 false，errno 为 ETIMEDOUT/ECANCELED
+    template<class T>
+    class Channel : Noncopyable {
+    public:
+        typedef std::shared_ptr<Channel> ptr;
+        typedef Spinlock MutexType;
+
+        explicit Channel(size_t capacity = 0) : m_capacity(capacity) {}
+
+        // 通道已关闭返回 false
+        bool send(const T& v) {
+            T tmp(v);
+            return send(std::move(tmp));
+        }
+
+        bool send(T&& v) {
+            while (true) {
+                FiberWaiter::ptr waiter;
+                {
+                    MutexType::Lock lock(m_mutex);
+                    if (m_closed) {
+                        return false;
+                    }
+                    if (!isFull()) {
+                        m_queue.push_back(std::move(v));
+                        waiter = popWaiter(m_recvWaiters);
+                        lock.unlock();
+                        notifyOne(waiter, m_recvWaiters);
+                        return true;
+                    }
+                    waiter.reset(new FiberWaiter("channel"));
+                    m_sendWaiters.push_back(waiter);
+                }
+                // 被唤醒后重新检查，可能又被其它发送者抢先
+                if (!wait(waiter, m_sendWaiters)) {
+                    return false;
+                }
+            }
+        }
+
+        // 满或已关闭时返回 false，不阻塞
+        bool trySend(const T& v) {
+            FiberWaiter::ptr waiter;
+            {
+                MutexType::Lock lock(m_mutex);
+                if (m_closed || isFull()) {
+                    return false;
+                }
+                m_queue.push_back(v);
+                waiter = popWaiter(m_recvWaiters);
+            }
+            notifyOne(waiter, m_recvWaiters);
+            return true;
+        }
+
+        // 只在成功时移走 v，失败时 v 保持不变
+        bool trySend(T&& v) {
+            FiberWaiter::ptr waiter;
+            {
+                MutexType::Lock lock(m_mutex);
+                if (m_closed || isFull()) {
+                    return false;
+                }
+                m_queue.push_back(std::move(v));
+                waiter = popWaiter(m_recvWaiters);
+            }
+            notifyOne(waiter, m_recvWaiters);
+            return true;
+        }
+
+        // 通道已关闭且数据已取完时返回 false
+        bool recv(T& v) {
+            while (true) {
+                FiberWaiter::ptr waiter;
+                {
+                    MutexType::Lock lock(m_mutex);
+                    if (!m_queue.empty()) {
+                        v = std::move(m_queue.front());
+                        m_queue.pop_front();
+                        waiter = popWaiter(m_sendWaiters);
+                        lock.unlock();
+                        notifyOne(waiter, m_sendWaiters);
+                        return true;
+                    }
+                    if (m_closed) {
+                        return false;
+                    }
+                    waiter.reset(new FiberWaiter("channel"));
+                    m_recvWaiters.push_back(waiter);
+                }
+                if (!wait(waiter, m_recvWaiters)) {
+                    return false;
+                }
+            }
+        }
+
+        bool tryRecv(T& v) {
+            FiberWaiter::ptr waiter;
+            {
+                MutexType::Lock lock(m_mutex);
+                if (m_queue.empty()) {
+                    return false;
+                }
+                v = std::move(m_queue.front());
+                m_queue.pop_front();
+                waiter = popWaiter(m_sendWaiters);
+            }
+            notifyOne(waiter, m_sendWaiters);
+            return true;
+        }
+
+        // 阻塞直到至少有一个元素，再一次取走最多 max 个，返回取到的个数
+        // 返回 0 表示通道已关闭且数据已取完，或等待被截止时间/取消打断
+        size_t recvMany(std::vector<T>& out, size_t max) {
+            while (true) {
+                FiberWaiter::ptr waiter;
+                {
+                    MutexType::Lock lock(m_mutex);
+                    if (!m_queue.empty()) {
+                        size_t n = std::min(max, m_queue.size());
+                        for (size_t i = 0; i < n; ++i) {
+                            out.push_back(std::move(m_queue.front()));
+                            m_queue.pop_front();
+                        }
+                        // 腾出了 n 个位置，唤醒至多 n 个发送者
+                        std::list<FiberWaiter::ptr> waiters;
+                        for (size_t i = 0; i < n && !m_sendWaiters.empty(); ++i) {
+                            waiters.push_back(popWaiter(m_sendWaiters));
+                        }
+                        lock.unlock();
+                        for (auto& i : waiters) {
+                            notifyOne(i, m_sendWaiters);
+                        }
+                        return n;
+                    }
+                    if (m_closed || max == 0) {
+                        return 0;
+                    }
+                    waiter.reset(new FiberWaiter("channel"));
+                    m_recvWaiters.push_back(waiter);
+                }
+                if (!wait(waiter, m_recvWaiters)) {
+                    return 0;
+                }
+            }
+        }
+
+        // 关闭后 send 失败，recv 仍可取完剩余数据，所有等待者被唤醒
+        void close() {
+            std::list<FiberWaiter::ptr> waiters;
+            {
+                MutexType::Lock lock(m_mutex);
+                if (m_closed) {
+                    return;
+                }
+                m_closed = true;
+                waiters.swap(m_sendWaiters);
+                waiters.splice(waiters.end(), m_recvWaiters);
+            }
+            for (auto& i : waiters) {
+                i->notify();
+            }
+        }
+
+        bool isClosed() {
+            MutexType::Lock lock(m_mutex);
+            return m_closed;
+        }
+
+        size_t size() {
+            MutexType::Lock lock(m_mutex);
+            return m_queue.size();
+        }
+
+        size_t getCapacity() const { return m_capacity; }
+
+        // 供 Selector 使用: 可接收 (有数据或已关闭) 时返回 true，
+        // 否则 waiter 非空时挂入接收等待队列，就绪时被 notify，不取走数据
+        bool watchRecv(const FiberWaiter::ptr& waiter) {
+            MutexType::Lock lock(m_mutex);
+            if (!m_queue.empty() || m_closed) {
+                return true;
+            }
+            if (waiter) {
+                m_recvWaiters.push_back(waiter);
+            }
+            return false;
+        }
+
+        // 可发送 (未满或已关闭) 时返回 true，否则挂入发送等待队列
+        bool watchSend(const FiberWaiter::ptr& waiter) {
+            MutexType::Lock lock(m_mutex);
+            if (!isFull() || m_closed) {
+                return true;
+            }
+            if (waiter) {
+                m_sendWaiters.push_back(waiter);
+            }
+            return false;
+        }
+
+        // 移出等待队列；pass 为 true 时，若通道就绪则改为唤醒其它等待者，
+        // 避免本次唤醒被未选中的 Selector 分支吞掉
+        void unwatch(const FiberWaiter::ptr& waiter, bool pass) {
+            FiberWaiter::ptr recv_waiter;
+            FiberWaiter::ptr send_waiter;
+            {
+                MutexType::Lock lock(m_mutex);
+                m_recvWaiters.remove(waiter);
+                m_sendWaiters.remove(waiter);
+                if (pass && !m_queue.empty()) {
+                    recv_waiter = popWaiter(m_recvWaiters);
+                }
+                if (pass && !isFull()) {
+                    send_waiter = popWaiter(m_sendWaiters);
+                }
+            }
+            notifyOne(recv_waiter, m_recvWaiters);
+            notifyOne(send_waiter, m_sendWaiters);
+        }
+    private:
+        bool isFull() const {
+            return m_capacity && m_queue.size() >= m_capacity;
+        }
+
+        static FiberWaiter::ptr popWaiter(std::list<FiberWaiter::ptr>& waiters) {
+            if (waiters.empty()) {
+                return nullptr;
+            }
+            FiberWaiter::ptr waiter = waiters.front();
+            waiters.pop_front();
+            return waiter;
+        }
+
+        // 挂起直到被唤醒；被打断时从等待队列中移除自己
+        bool wait(const FiberWaiter::ptr& waiter, std::list<FiberWaiter::ptr>& waiters) {
+            int err = waiter->waitInterruptible();
+            if (!err) {
+                return true;
+            }
+            {
+                MutexType::Lock lock(m_mutex);
+                waiters.remove(waiter);
+            }
+            errno = err;
+            return false;
+        }
+
+        // 唤醒 waiter，它已放弃等待则改为唤醒队列中的下一个
+        void notifyOne(FiberWaiter::ptr waiter, std::list<FiberWaiter::ptr>& waiters) {
+            while (waiter && !waiter->notify()) {
+                MutexType::Lock lock(m_mutex);
+                waiter = popWaiter(waiters);
+            }
+        }
+
+        MutexType m_mutex;
+        std::deque<T> m_queue;
+        std::list<FiberWaiter::ptr> m_sendWaiters;
+        std::list<FiberWaiter::ptr> m_recvWaiters;
+        size_t m_capacity;
+        bool m_closed = false;
+    };
+}
@@ -0,0 +1,288 @@
+#include "connectionpool.h"
+#include "config.h"
+#include "deadline.h"
+#include "hook.h"
+#include "log.h"
+
+namespace svher {
+
+    static Logger::ptr g_logger = LOG_NAME("sys");
+
+    static ConfigVar<uint32_t>::ptr g_pool_max_per_host =
+            Config::Lookup<uint32_t>("connection_pool.max_per_host", 64, "max connections per address");
+    static ConfigVar<uint32_t>::ptr g_pool_max_idle =
+            Config::Lookup<uint32_t>("connection_pool.max_idle", 16, "max idle connections kept per address");
+    static ConfigVar<uint32_t>::ptr g_pool_min_idle =
+            Config::Lookup<uint32_t>("connection_pool.min_idle", 0, "idle connections kept warm per address");
+    static ConfigVar<uint64_t>::ptr g_pool_idle_timeout =
+            Config::Lookup<uint64_t>("connection_pool.idle_timeout", 60 * 1000, "idle connection timeout (ms)");
+    static ConfigVar<uint64_t>::ptr g_pool_connect_timeout =
+            Config::Lookup<uint64_t>("connection_pool.connect_timeout", 3000, "pool connect timeout (ms)");
+    static ConfigVar<uint64_t>::ptr g_pool_check_interval =
+            Config::Lookup<uint64_t>("connection_pool.check_interval", 5000, "idle connection check interval (ms)");
+
+    ConnectionPool::ConnectionPool(IOManager *iom)
+        : m_iom(iom),
+          m_checkInterval(g_pool_check_interval->getValue()),
+          m_maxPerHost(g_pool_max_per_host->getValue()),
+          m_maxIdle(g_pool_max_idle->getValue()),
+          m_minIdle(g_pool_min_idle->getValue()),
+          m_idleTimeout(g_pool_idle_timeout->getValue()),
+          m_connectTimeout(g_pool_connect_timeout->getValue()) {
+    }
+
+    ConnectionPool::~ConnectionPool() {
+        close();
+    }
+
+    void ConnectionPool::close() {
+        std::vector<Socket::ptr> idles;
+        std::vector<FiberWaiter::ptr> waiters;
+        {
+            Mutex::Lock lock(m_mutex);
+            m_closed = true;
+            if (m_timer) {
+                m_timer->cancel();
+                m_timer.reset();
+            }
+            for (auto& i : m_hosts) {
+                for (auto& idle : i.second->idle) {
+                    idles.push_back(idle.sock);
+                }
+                i.second->total -= i.second->idle.size();
+                i.second->idle.clear();
+                waiters.insert(waiters.end(), i.second->waiters.begin(), i.second->waiters.end());
+                i.second->waiters.clear();
+            }
+        }
+        // 等待中的协程醒来后看到 m_closed 返回失败
+        for (auto& i : waiters) {
+            i->notify();
+        }
+    }
+
+    void ConnectionPool::setCheckInterval(uint64_t ms) {
+        Mutex::Lock lock(m_mutex);
+        m_checkInterval = ms;
+        if (m_timer) {
+            m_timer->reset(ms, true);
+        }
+    }
+
+    ConnectionPool::HostPtr ConnectionPool::getHost(Address::ptr addr) {
+        SockAddr key(*addr);
+        Mutex::Lock lock(m_mutex);
+        HostPtr& host = m_hosts[key];
+        if (!host) {
+            host.reset(new Host);
+            host->addr = addr;
+        }
+        if (!m_timer && !m_closed && m_iom) {
+            std::weak_ptr<ConnectionPool> weak(shared_from_this());
+            m_timer = m_iom->addConditionalTimer(m_checkInterval, [weak]() {
+                ConnectionPool::ptr self = weak.lock();
+                if (self) {
+                    self->check();
+                }
+            }, weak, true);
+        }
+        return host;
+    }
+
+    size_t ConnectionPool::getIdleCount(Address::ptr addr) {
+        SockAddr key(*addr);
+        Mutex::Lock lock(m_mutex);
+        auto it = m_hosts.find(key);
+        return it == m_hosts.end() ? 0 : it->second->idle.size();
+    }
+
+    size_t ConnectionPool::getTotalCount(Address::ptr addr) {
+        SockAddr key(*addr);
+        Mutex::Lock lock(m_mutex);
+        auto it = m_hosts.find(key);
+        return it == m_hosts.end() ? 0 : it->second->total;
+    }
+
+    bool ConnectionPool::IsHealthy(const Socket::ptr &sock) {
+        if (!sock->isConnected()) {
+            return false;
+        }
+        // 空闲连接上不应有数据，可读说明对端已关闭或残留了上次的响应
+        char c;
+        int rt = recv_f(sock->getSocket(), &c, 1, MSG_PEEK | MSG_DONTWAIT);
+        return rt < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+
+    Socket::ptr ConnectionPool::get(Address::ptr addr, uint64_t timeout_ms) {
+        DeadlineScope scope(timeout_ms);
+        HostPtr host = getHost(addr);
+        while (true) {
+            int err = FiberDeadline::Check();
+            if (err) {
+                errno = err;
+                return nullptr;
+            }
+            Socket::ptr sock;
+            FiberWaiter::ptr waiter;
+            bool create = false;
+            // 在锁外析构
+            std::vector<Socket::ptr> brokens;
+            {
+                Mutex::Lock lock(m_mutex);
+                if (m_closed) {
+                    errno = ECANCELED;
+                    return nullptr;
+                }
+                while (!host->idle.empty()) {
+                    sock = host->idle.back().sock;
+                    host->idle.pop_back();
+                    if (IsHealthy(sock)) {
+                        break;
+                    }
+                    ++m_brokens;
+                    --host->total;
+                    brokens.push_back(sock);
+                    sock.reset();
+                }
+                if (!sock) {
+                    if (host->total < m_maxPerHost) {
+                        ++host->total;
+                        create = true;
+                    } else {
+                        waiter.reset(new FiberWaiter("pool"));
+                        host->waiters.push_back(waiter);
+                    }
+                }
+            }
+            if (sock) {
+                ++m_reuses;
+                return wrap(host, sock);
+            }
+            if (create) {
+                sock = connect(host, std::min(m_connectTimeout, FiberDeadline::Remaining()));
+                if (!sock) {
+                    int error = errno;
+                    Mutex::Lock lock(m_mutex);
+                    --host->total;
+                    wakeOne(*host);
+                    errno = error;
+                    return nullptr;
+                }
+                return wrap(host, sock);
+            }
+            ++m_waits;
+            err = waiter->waitInterruptible();
+            if (err) {
+                Mutex::Lock lock(m_mutex);
+                host->waiters.remove(waiter);
+                errno = err;
+                return nullptr;
+            }
+        }
+    }
+
+    Socket::ptr ConnectionPool::connect(const HostPtr &host, uint64_t timeout_ms) {
+        Socket::ptr sock = Socket::CreateTCP(host->addr);
+        if (!sock->connect(host->addr, timeout_ms)) {
+            LOG_DEBUG(g_logger) << "pool connect " << host->addr->toString()
+                                << " fail errno=" << errno << " errstr=" << strerror(errno);
+            return nullptr;
+        }
+        ++m_connects;
+        return sock;
+    }
+
+    Socket::ptr ConnectionPool::wrap(const HostPtr &host, Socket::ptr sock) {
+        std::weak_ptr<ConnectionPool> weak(shared_from_this());
+        Socket* raw = sock.get();
+        // 内层 sock 随删除器持有，最后一个外部引用释放时归还
+        return Socket::ptr(raw, [weak, host, sock](Socket*) {
+            ConnectionPool::ptr self = weak.lock();
+            if (self) {
+                self->release(host, sock);
+            }
+        });
+    }
+
+    void ConnectionPool::release(const HostPtr &host, Socket::ptr sock) {
+        Mutex::Lock lock(m_mutex);
+        if (!m_closed && sock->isConnected() && host->idle.size() < m_maxIdle) {
+            host->idle.push_back({sock, GetCurrentMS()});
+            sock.reset();
+        } else {
+            --host->total;
+        }
+        wakeOne(*host);
+        lock.unlock();
+    }
+
+    void ConnectionPool::wakeOne(Host &host) {
+        while (!host.waiters.empty()) {
+            FiberWaiter::ptr waiter = host.waiters.front();
+            host.waiters.pop_front();
+            // 已超时放弃的等待者跳过
+            if (waiter->notify()) {
+                return;
+            }
+        }
+    }
+
+    void ConnectionPool::check() {
+        uint64_t now = GetCurrentMS();
+        std::vector<Socket::ptr> doomed;
+        std::vector<HostPtr> warms;
+        {
+            Mutex::Lock lock(m_mutex);
+            if (m_closed) {
+                return;
+            }
+            for (auto& i : m_hosts) {
+                Host& host = *i.second;
+                size_t before = host.idle.size();
+                // 队首是最久未用的
+                while (host.idle.size() > m_minIdle && now - host.idle.front().lastUsed >= m_idleTimeout) {
+                    doomed.push_back(host.idle.front().sock);
+                    host.idle.pop_front();
+                }
+                for (auto it = host.idle.begin(); it != host.idle.end();) {
+                    if (IsHealthy(it->sock)) {
+                        ++it;
+                        continue;
+                    }
+                    ++m_brokens;
+                    doomed.push_back(it->sock);
+                    it = host.idle.erase(it);
+                }
+                size_t freed = before - host.idle.size();
+                host.total -= freed;
+                while (freed--) {
+                    wakeOne(host);
+                }
+                while (host.idle.size() + host.warming < m_minIdle && host.total < m_maxPerHost) {
+                    ++host.total;
+                    ++host.warming;
+                    warms.push_back(i.second);
+                }
+            }
+        }
+        if (!doomed.empty()) {
+            LOG_DEBUG(g_logger) << "connection pool closed " << doomed.size() << " idle connections";
+        }
+        for (auto& host : warms) {
+            m_iom->schedule(std::bind(&ConnectionPool::warm, shared_from_this(), host));
+        }
+    }
+
+    void ConnectionPool::warm(const HostPtr &host) {
+        Socket::ptr sock = connect(host, m_connectTimeout);
+        Mutex::Lock lock(m_mutex);
+        --host->warming;
+        if (sock && !m_closed) {
+            host->idle.push_back({sock, GetCurrentMS()});
+        } else {
+            --host->total;
+        }
+        wakeOne(*host);
+        lock.unlock();
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <memory>
+#include <list>
+#include <unordered_map>
+#include <atomic>
+#include "socket.h"
+#include "iomanager.h"
+#include "fibersync.h"
+#include "thread.h"
+#include "util.h"
+
+namespace svher {
+
+    // 按地址复用的出站 TCP 连接池
+    // get 取出的 Socket 在最后一个引用释放时自动归还；用完前出错应先 close，归还时直接丢弃
+    // 每个地址的连接总数 (使用中 + 空闲) 不超过 maxPerHost，达到上限时 get 挂起当前协程直到有连接归还
+    // 定时器定期关闭空闲超时的连接 (保留 minIdle 个)，检查空闲连接是否已被对端关闭，并为用过的地址补足 minIdle
+    // 默认值来自配置 connection_pool.*
+    class ConnectionPool : public std::enable_shared_from_this<ConnectionPool>, Noncopyable {
+    public:
+        typedef std::shared_ptr<ConnectionPool> ptr;
+
+        // 空闲检查的定时器加在 iom 上，须为 IOManager 中调用
+        explicit ConnectionPool(IOManager* iom = IOManager::GetThis());
+        ~ConnectionPool();
+
+        // 优先取最近归还的空闲连接，取出前检查对端是否已关闭
+        // 失败返回 nullptr: 连接失败、等待超时 (errno 为 ETIMEDOUT) 或被取消 (ECANCELED)
+        // timeout_ms 为等待空闲名额和建立连接的总时间，同时受协程截止时间约束
+        Socket::ptr get(Address::ptr addr, uint64_t timeout_ms = -1);
+        // 关闭全部空闲连接，使用中的连接归还时关闭
+        void close();
+
+        void setMaxPerHost(size_t v) { m_maxPerHost = v; }
+        void setMaxIdle(size_t v) { m_maxIdle = v; }
+        void setMinIdle(size_t v) { m_minIdle = v; }
+        void setIdleTimeout(uint64_t ms) { m_idleTimeout = ms; }
+        void setConnectTimeout(uint64_t ms) { m_connectTimeout = ms; }
+        // 修改后从下一轮检查开始生效
+        void setCheckInterval(uint64_t ms);
+
+        size_t getIdleCount(Address::ptr addr);
+        // 使用中加空闲
+        size_t getTotalCount(Address::ptr addr);
+        uint64_t getConnectCount() const { return m_connects; }
+        uint64_t getReuseCount() const { return m_reuses; }
+        uint64_t getWaitCount() const { return m_waits; }
+        // 健康检查关闭的连接数
+        uint64_t getBrokenCount() const { return m_brokens; }
+    private:
+        struct IdleSocket {
+            Socket::ptr sock;
+            uint64_t lastUsed;
+        };
+        struct Host {
+            Address::ptr addr;
+            std::list<IdleSocket> idle;
+            size_t total = 0;
+            // 正在为 minIdle 预建的连接数
+            size_t warming = 0;
+            std::list<FiberWaiter::ptr> waiters;
+        };
+        typedef std::shared_ptr<Host> HostPtr;
+
+        HostPtr getHost(Address::ptr addr);
+        Socket::ptr connect(const HostPtr& host, uint64_t timeout_ms);
+        Socket::ptr wrap(const HostPtr& host, Socket::ptr sock);
+        void release(const HostPtr& host, Socket::ptr sock);
+        // 持有 m_mutex 时调用，唤醒一个仍在等待的协程
+        void wakeOne(Host& host);
+        void check();
+        void warm(const HostPtr& host);
+        static bool IsHealthy(const Socket::ptr& sock);
+
+        IOManager* m_iom;
+        Mutex m_mutex;
+        // 按地址的值比较，不经过 toString
+        std::unordered_map<SockAddr, HostPtr> m_hosts;
+        Timer::ptr m_timer;
+        uint64_t m_checkInterval;
+        bool m_closed = false;
+
+        size_t m_maxPerHost;
+        size_t m_maxIdle;
+        size_t m_minIdle;
+        uint64_t m_idleTimeout;
+        uint64_t m_connectTimeout;
+
+        std::atomic<uint64_t> m_connects{0};
+        std::atomic<uint64_t> m_reuses{0};
+        std::atomic<uint64_t> m_waits{0};
+        std::atomic<uint64_t> m_brokens{0};
+    };
+}
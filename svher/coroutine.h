@@ -0,0 +1,264 @@
+#pragma once
+
+// C++20 无栈协程，与 Fiber 共用 Scheduler/IOManager
+// 需以 -std=c++20 编译 (CMake 选项 ENABLE_COROUTINE)
+#if __cplusplus < 202002L
+#error "svher/coroutine.h requires C++20"
+#endif
+
+#include <coroutine>
+#include <optional>
+#include <exception>
+#include <atomic>
+#include <functional>
+#include <sys/socket.h>
+#include "scheduler.h"
+#include "iomanager.h"
+#include "socket.h"
+#include "fdmanager.h"
+#include "hook.h"
+
+namespace svher {
+
+    template<class T = void>
+    class Task;
+
+    namespace detail {
+        // 协程帧内存统计
+        struct FrameStats {
+            static inline std::atomic<uint64_t> s_bytes{0};
+            static inline std::atomic<uint64_t> s_count{0};
+        };
+
+        struct PromiseBase {
+            std::coroutine_handle<> continuation;
+            std::exception_ptr error;
+            // start() 后无人等待，结束时自行销毁
+            bool detached = false;
+
+            std::suspend_always initial_suspend() noexcept { return {}; }
+
+            struct FinalAwaiter {
+                bool await_ready() noexcept { return false; }
+                template<class P>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept {
+                    PromiseBase& promise = h.promise();
+                    if (promise.continuation) {
+                        // 对称转移，直接恢复等待者，不经过调度队列
+                        return promise.continuation;
+                    }
+                    if (promise.detached) {
+                        h.destroy();
+                    }
+                    return std::noop_coroutine();
+                }
+                void await_resume() noexcept {}
+            };
+
+            FinalAwaiter final_suspend() noexcept { return {}; }
+            void unhandled_exception() { error = std::current_exception(); }
+
+            static void* operator new(size_t size) {
+                FrameStats::s_bytes += size;
+                ++FrameStats::s_count;
+                return ::operator new(size);
+            }
+            static void operator delete(void* ptr, size_t size) {
+                FrameStats::s_bytes -= size;
+                --FrameStats::s_count;
+                ::operator delete(ptr);
+            }
+        };
+
+        template<class T>
+        struct Promise : PromiseBase {
+            std::optional<T> value;
+            Task<T> get_return_object();
+            void return_value(T v) { value.emplace(std::move(v)); }
+            T result() {
+                if (error) std::rethrow_exception(error);
+                return std::move(*value);
+            }
+        };
+
+        template<>
+        struct Promise<void> : PromiseBase {
+            Task<void> get_return_object();
+            void return_void() {}
+            void result() {
+                if (error) std::rethrow_exception(error);
+            }
+        };
+    }
+
+    // 惰性启动: co_await 时开始执行，或 start() 交给调度器分离执行
+    template<class T>
+    class Task {
+    public:
+        typedef detail::Promise<T> promise_type;
+        typedef std::coroutine_handle<promise_type> handle_type;
+
+        explicit Task(handle_type handle) : m_handle(handle) {}
+        Task(Task&& rhs) noexcept : m_handle(rhs.m_handle) { rhs.m_handle = nullptr; }
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+        ~Task() {
+            if (m_handle) m_handle.destroy();
+        }
+
+        bool await_ready() const noexcept { return false; }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept {
+            m_handle.promise().continuation = continuation;
+            return m_handle;
+        }
+        T await_resume() { return m_handle.promise().result(); }
+
+        // 在 scheduler 的运行队列中启动，结束后自动释放协程帧
+        void start(Scheduler* scheduler = Scheduler::GetThis()) {
+            handle_type handle = m_handle;
+            m_handle = nullptr;
+            handle.promise().detached = true;
+            scheduler->schedule(std::function<void()>([handle]() {
+                handle.resume();
+            }));
+        }
+    private:
+        handle_type m_handle;
+    };
+
+    namespace detail {
+        template<class T>
+        Task<T> Promise<T>::get_return_object() {
+            return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+        }
+
+        inline Task<void> Promise<void>::get_return_object() {
+            return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+        }
+    }
+
+    // 当前协程帧占用的总字节数与个数
+    inline uint64_t CoroutineFrameBytes() { return detail::FrameStats::s_bytes; }
+    inline uint64_t CoroutineFrameCount() { return detail::FrameStats::s_count; }
+
+    // 等待 fd 就绪，事件触发 (或被 cancelEvent) 后由 IOManager 调度恢复；注册失败返回 false
+    class IOAwaiter {
+    public:
+        IOAwaiter(int fd, IOManager::Event event, IOManager* iom = IOManager::GetThis())
+            : m_fd(fd), m_event(event), m_iom(iom) {}
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> handle) {
+            // 注册成功后可能立即在其它线程恢复，之后不能再访问成员
+            if (m_iom->addEvent(m_fd, m_event, [handle]() { handle.resume(); })) {
+                m_ok = false;
+                return false;
+            }
+            return true;
+        }
+        bool await_resume() const noexcept { return m_ok; }
+    private:
+        int m_fd;
+        IOManager::Event m_event;
+        IOManager* m_iom;
+        bool m_ok = true;
+    };
+
+    // 定时器到期后恢复
+    class SleepAwaiter {
+    public:
+        explicit SleepAwaiter(uint64_t ms, IOManager* iom = IOManager::GetThis())
+            : m_ms(ms), m_iom(iom) {}
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) {
+            m_iom->addTimer(m_ms, [handle]() { handle.resume(); });
+        }
+        void await_resume() const noexcept {}
+    private:
+        uint64_t m_ms;
+        IOManager* m_iom;
+    };
+
+    // 让出执行权，重新排到调度队列尾部
+    class YieldAwaiter {
+    public:
+        explicit YieldAwaiter(Scheduler* scheduler = Scheduler::GetThis()) : m_scheduler(scheduler) {}
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) {
+            m_scheduler->schedule(std::function<void()>([handle]() { handle.resume(); }));
+        }
+        void await_resume() const noexcept {}
+    private:
+        Scheduler* m_scheduler;
+    };
+
+    // 以下 socket 操作直接调用原始系统调用，EAGAIN 时挂起协程而不是挂起所在的 Fiber
+    inline Task<ssize_t> AsyncRecv(Socket::ptr sock, void* buffer, size_t length, int flags = 0) {
+        int fd = sock->getSocket();
+        while (true) {
+            ssize_t n = recv_f(fd, buffer, length, flags);
+            if (n >= 0) co_return n;
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN) co_return -1;
+            if (!co_await IOAwaiter(fd, IOManager::READ)) {
+                errno = ECANCELED;
+                co_return -1;
+            }
+        }
+    }
+
+    inline Task<ssize_t> AsyncSend(Socket::ptr sock, const void* buffer, size_t length, int flags = 0) {
+        int fd = sock->getSocket();
+        while (true) {
+            ssize_t n = send_f(fd, buffer, length, flags | MSG_NOSIGNAL);
+            if (n >= 0) co_return n;
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN) co_return -1;
+            if (!co_await IOAwaiter(fd, IOManager::WRITE)) {
+                errno = ECANCELED;
+                co_return -1;
+            }
+        }
+    }
+
+    inline Task<Socket::ptr> AsyncAccept(Socket::ptr sock) {
+        int fd = sock->getSocket();
+        while (true) {
+            int client = accept_f(fd, nullptr, nullptr);
+            if (client >= 0) {
+                // 创建 FdContext，同时把 socket 设为非阻塞
+                FdMgr::GetInstance()->get(client, true);
+                Socket::ptr rt(new Socket(sock->getFamily(), sock->getType(), sock->getProtocol()));
+                if (rt->init(client)) co_return rt;
+                co_return nullptr;
+            }
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN) co_return nullptr;
+            if (!co_await IOAwaiter(fd, IOManager::READ)) {
+                co_return nullptr;
+            }
+        }
+    }
+
+    inline Task<Socket::ptr> AsyncConnect(Address::ptr addr) {
+        int fd = socket_f(addr->getFamily(), SOCK_STREAM, 0);
+        if (fd < 0) co_return nullptr;
+        FdMgr::GetInstance()->get(fd, true);
+        int rt = connect_f(fd, addr->getAddr(), addr->getAddrLen());
+        if (rt && errno == EINPROGRESS) {
+            if (co_await IOAwaiter(fd, IOManager::WRITE)) {
+                int error = 0;
+                socklen_t len = sizeof(error);
+                rt = getsockopt_f(fd, SOL_SOCKET, SO_ERROR, &error, &len) || error ? -1 : 0;
+            }
+        }
+        if (rt) {
+            close(fd);
+            co_return nullptr;
+        }
+        Socket::ptr sock(new Socket(addr->getFamily(), SOCK_STREAM, 0));
+        if (!sock->init(fd)) {
+            co_return nullptr;
+        }
+        co_return sock;
+    }
+}
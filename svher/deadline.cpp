@@ -0,0 +1,111 @@
+#include "deadline.h"
+#include "fls.h"
+#include <cerrno>
+
+namespace svher {
+
+    struct DeadlineContext {
+        uint64_t deadline = FiberDeadline::NONE;
+        CancelToken::ptr token;
+    };
+
+    static FLS<DeadlineContext> s_context;
+
+    const uint64_t FiberDeadline::NONE;
+
+    void CancelToken::cancel() {
+        std::map<uint64_t, std::function<void()>> callbacks;
+        {
+            Spinlock::Lock lock(m_mutex);
+            if (m_cancelled) {
+                return;
+            }
+            m_cancelled = true;
+            callbacks.swap(m_callbacks);
+        }
+        for (auto& i : callbacks) {
+            i.second();
+        }
+    }
+
+    uint64_t CancelToken::addCallback(std::function<void()> cb) {
+        {
+            Spinlock::Lock lock(m_mutex);
+            if (!m_cancelled) {
+                m_callbacks[++m_nextId] = std::move(cb);
+                return m_nextId;
+            }
+        }
+        cb();
+        return 0;
+    }
+
+    void CancelToken::delCallback(uint64_t id) {
+        Spinlock::Lock lock(m_mutex);
+        m_callbacks.erase(id);
+    }
+
+    uint64_t FiberDeadline::Get() {
+        DeadlineContext* ctx = s_context.tryGet();
+        return ctx ? ctx->deadline : NONE;
+    }
+
+    void FiberDeadline::Set(uint64_t deadline_ms) {
+        s_context->deadline = deadline_ms;
+    }
+
+    uint64_t FiberDeadline::Remaining() {
+        uint64_t deadline = Get();
+        if (deadline == NONE) {
+            return NONE;
+        }
+        uint64_t now = GetCurrentMS();
+        return now >= deadline ? 0 : deadline - now;
+    }
+
+    CancelToken::ptr FiberDeadline::GetCancelToken() {
+        DeadlineContext* ctx = s_context.tryGet();
+        return ctx ? ctx->token : nullptr;
+    }
+
+    void FiberDeadline::SetCancelToken(CancelToken::ptr token) {
+        s_context->token = std::move(token);
+    }
+
+    int FiberDeadline::Check() {
+        DeadlineContext* ctx = s_context.tryGet();
+        if (!ctx) {
+            return 0;
+        }
+        if (ctx->token && ctx->token->isCancelled()) {
+            return ECANCELED;
+        }
+        if (ctx->deadline != NONE && GetCurrentMS() >= ctx->deadline) {
+            return ETIMEDOUT;
+        }
+        return 0;
+    }
+
+    DeadlineScope::DeadlineScope(uint64_t timeout_ms)
+        : m_old(FiberDeadline::Get()) {
+        uint64_t now = GetCurrentMS();
+        // timeout_ms 为 -1 等超大值时不设截止时间
+        uint64_t deadline = timeout_ms >= FiberDeadline::NONE - now ? FiberDeadline::NONE : now + timeout_ms;
+        if (deadline < m_old) {
+            FiberDeadline::Set(deadline);
+        }
+    }
+
+    DeadlineScope::~DeadlineScope() {
+        FiberDeadline::Set(m_old);
+    }
+
+    CancelScope::CancelScope(CancelToken::ptr token)
+        : m_old(FiberDeadline::GetCancelToken()) {
+        FiberDeadline::SetCancelToken(std::move(token));
+    }
+
+    CancelScope::~CancelScope() {
+        FiberDeadline::SetCancelToken(std::move(m_old));
+    }
+}
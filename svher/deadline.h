@@ -0,0 +1,61 @@
+#pragma once
+
+#include <memory>
+#include <map>
+#include <atomic>
+#include <functional>
+#include "thread.h"
+#include "util.h"
+
+namespace svher {
+
+    // 取消令牌，可被任意线程取消，取消时立即回调所有注册者
+    class CancelToken : Noncopyable {
+    public:
+        typedef std::shared_ptr<CancelToken> ptr;
+        void cancel();
+        bool isCancelled() const { return m_cancelled; }
+        // 已取消时立即调用 cb 并返回 0
+        uint64_t addCallback(std::function<void()> cb);
+        void delCallback(uint64_t id);
+    private:
+        Spinlock m_mutex;
+        std::atomic<bool> m_cancelled{false};
+        uint64_t m_nextId = 0;
+        std::map<uint64_t, std::function<void()>> m_callbacks;
+    };
+
+    // 当前协程的请求截止时间 (GetCurrentMS 的绝对时间) 与取消令牌
+    // hook 的 I/O、connect、sleep 以及协程同步原语在等待时都会检查，
+    // 预算用完返回 ETIMEDOUT，被取消返回 ECANCELED
+    class FiberDeadline {
+    public:
+        static const uint64_t NONE = (uint64_t)-1;
+        static uint64_t Get();
+        static void Set(uint64_t deadline_ms);
+        // 剩余毫秒，没有截止时间返回 NONE
+        static uint64_t Remaining();
+        static CancelToken::ptr GetCancelToken();
+        static void SetCancelToken(CancelToken::ptr token);
+        // 返回 0、ETIMEDOUT 或 ECANCELED
+        static int Check();
+    };
+
+    // 作用域内截止时间收紧到 timeout_ms 之后 (不会放宽外层)，退出时恢复
+    class DeadlineScope : Noncopyable {
+    public:
+        explicit DeadlineScope(uint64_t timeout_ms);
+        ~DeadlineScope();
+    private:
+        uint64_t m_old;
+    };
+
+    // 作用域内绑定取消令牌，退出时恢复
+    class CancelScope : Noncopyable {
+    public:
+        explicit CancelScope(CancelToken::ptr token);
+        ~CancelScope();
+    private:
+        CancelToken::ptr m_old;
+    };
+}
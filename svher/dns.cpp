@@ -0,0 +1,582 @@
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <arpa/inet.h>
+#include "dns.h"
+#include "socket.h"
+#include "scheduler.h"
+#include "fiber.h"
+#include "config.h"
+#include "log.h"
+#include "util.h"
+
+namespace svher {
+
+    static Logger::ptr g_logger = LOG_NAME("sys");
+
+    static ConfigVar<uint32_t>::ptr g_dns_negative_ttl =
+            Config::Lookup<uint32_t>("dns.negative_ttl", 30, "dns negative cache ttl (s) when no SOA");
+    static ConfigVar<uint32_t>::ptr g_dns_max_ttl =
+            Config::Lookup<uint32_t>("dns.max_ttl", 3600, "dns cache max ttl (s)");
+    static ConfigVar<uint32_t>::ptr g_dns_cache_size =
+            Config::Lookup<uint32_t>("dns.cache_size", 10000, "dns cache max entries");
+
+    static const uint16_t DNS_PORT = 53;
+    static const size_t DNS_HEADER_SIZE = 12;
+    // 标志位
+    static const uint16_t DNS_QR = 0x8000;
+    static const uint16_t DNS_TC = 0x0200;
+    static const uint16_t DNS_RD = 0x0100;
+    // RCODE
+    static const uint16_t DNS_NXDOMAIN = 3;
+
+    static std::string ToLower(const std::string& s) {
+        std::string rt = s;
+        std::transform(rt.begin(), rt.end(), rt.begin(), ::tolower);
+        return rt;
+    }
+
+    static IPAddress::ptr ParseLiteral(const std::string& host) {
+        sockaddr_in v4;
+        memset(&v4, 0, sizeof(v4));
+        if (inet_pton(AF_INET, host.c_str(), &v4.sin_addr) == 1) {
+            v4.sin_family = AF_INET;
+            return std::make_shared<IPv4Address>(v4);
+        }
+        sockaddr_in6 v6;
+        memset(&v6, 0, sizeof(v6));
+        if (inet_pton(AF_INET6, host.c_str(), &v6.sin6_addr) == 1) {
+            v6.sin6_family = AF_INET6;
+            return std::make_shared<IPv6Address>(v6);
+        }
+        return nullptr;
+    }
+
+    // 缓存中的地址是共享的，返回给调用方前复制一份，避免 setPort 互相影响
+    static void CopyAddrs(std::vector<IPAddress::ptr>& results, const std::vector<IPAddress::ptr>& addrs) {
+        for (auto& i : addrs) {
+            results.push_back(std::dynamic_pointer_cast<IPAddress>(
+                    Address::Create(i->getAddr(), i->getAddrLen())));
+        }
+    }
+
+    static uint16_t ReadUint16(const std::string& buf, size_t pos) {
+        return ((uint8_t)buf[pos] << 8) | (uint8_t)buf[pos + 1];
+    }
+
+    static uint32_t ReadUint32(const std::string& buf, size_t pos) {
+        return ((uint32_t)ReadUint16(buf, pos) << 16) | ReadUint16(buf, pos + 2);
+    }
+
+    static void WriteUint16(std::string& buf, uint16_t v) {
+        buf.push_back((char)(v >> 8));
+        buf.push_back((char)(v & 0xff));
+    }
+
+    // 跳过 (可能被压缩的) 域名，失败返回 false
+    static bool SkipName(const std::string& buf, size_t& pos) {
+        while (pos < buf.size()) {
+            uint8_t len = buf[pos];
+            if ((len & 0xc0) == 0xc0) {
+                pos += 2;
+                return pos <= buf.size();
+            }
+            ++pos;
+            if (len == 0) return true;
+            pos += len;
+        }
+        return false;
+    }
+
+    static bool EncodeName(std::string& buf, const std::string& name) {
+        size_t begin = 0;
+        while (begin < name.size()) {
+            size_t end = name.find('.', begin);
+            if (end == std::string::npos) end = name.size();
+            size_t len = end - begin;
+            if (len == 0 || len > 63) return false;
+            buf.push_back((char)len);
+            buf.append(name, begin, len);
+            begin = end + 1;
+        }
+        buf.push_back(0);
+        return buf.size() <= 255 + DNS_HEADER_SIZE;
+    }
+
+    static uint16_t NextQueryId() {
+        static std::atomic<uint32_t> s_seq{(uint32_t)GetCurrentUS()};
+        uint32_t v = ++s_seq;
+        return (uint16_t)((v * 2654435761u) >> 16);
+    }
+
+    DnsResolver::DnsResolver() {
+        loadResolvConf();
+        loadHosts();
+    }
+
+    bool DnsResolver::loadResolvConf(const std::string &path) {
+        std::ifstream ifs(path);
+        std::vector<Address::ptr> servers;
+        std::vector<std::string> search;
+        uint64_t timeout = 5000;
+        int attempts = 2;
+        int ndots = 1;
+        bool ok = (bool)ifs;
+        std::string line;
+        while (ok && std::getline(ifs, line)) {
+            std::stringstream ss(line);
+            std::string key;
+            ss >> key;
+            if (key.empty() || key[0] == '#' || key[0] == ';') continue;
+            if (key == "nameserver") {
+                std::string ip;
+                ss >> ip;
+                IPAddress::ptr addr = ParseLiteral(ip);
+                if (addr) {
+                    addr->setPort(DNS_PORT);
+                    servers.push_back(addr);
+                }
+            } else if (key == "search" || key == "domain") {
+                // 以最后出现的为准
+                search.clear();
+                std::string domain;
+                while (ss >> domain) {
+                    search.push_back(ToLower(domain));
+                }
+            } else if (key == "options") {
+                std::string opt;
+                while (ss >> opt) {
+                    if (opt.compare(0, 8, "timeout:") == 0) {
+                        timeout = std::max(1, atoi(opt.c_str() + 8)) * 1000;
+                    } else if (opt.compare(0, 9, "attempts:") == 0) {
+                        attempts = std::max(1, atoi(opt.c_str() + 9));
+                    } else if (opt.compare(0, 6, "ndots:") == 0) {
+                        ndots = std::max(0, atoi(opt.c_str() + 6));
+                    }
+                }
+            }
+        }
+        if (servers.empty()) {
+            // 与 glibc 一致，没有配置时使用本机
+            servers.push_back(IPv4Address::Create("127.0.0.1", DNS_PORT));
+        }
+        MutexType::Lock lock(m_mutex);
+        m_servers.swap(servers);
+        m_search.swap(search);
+        m_timeout = timeout;
+        m_attempts = attempts;
+        m_ndots = ndots;
+        return ok;
+    }
+
+    bool DnsResolver::loadHosts(const std::string &path) {
+        std::ifstream ifs(path);
+        if (!ifs) {
+            return false;
+        }
+        std::map<std::string, std::vector<IPAddress::ptr>> hosts;
+        std::string line;
+        while (std::getline(ifs, line)) {
+            size_t comment = line.find('#');
+            if (comment != std::string::npos) {
+                line.resize(comment);
+            }
+            std::stringstream ss(line);
+            std::string ip, name;
+            ss >> ip;
+            IPAddress::ptr addr = ParseLiteral(ip);
+            if (!addr) continue;
+            while (ss >> name) {
+                hosts[ToLower(name)].push_back(addr);
+            }
+        }
+        MutexType::Lock lock(m_mutex);
+        m_hosts.swap(hosts);
+        return true;
+    }
+
+    void DnsResolver::setServers(const std::vector<Address::ptr> &servers) {
+        MutexType::Lock lock(m_mutex);
+        m_servers = servers;
+    }
+
+    std::vector<Address::ptr> DnsResolver::getServers() {
+        MutexType::Lock lock(m_mutex);
+        return m_servers;
+    }
+
+    void DnsResolver::setSearch(const std::vector<std::string> &search) {
+        MutexType::Lock lock(m_mutex);
+        m_search = search;
+    }
+
+    void DnsResolver::clearCache() {
+        MutexType::Lock lock(m_mutex);
+        m_cache.clear();
+    }
+
+    size_t DnsResolver::getCacheSize() {
+        MutexType::Lock lock(m_mutex);
+        return m_cache.size();
+    }
+
+    bool DnsResolver::resolve(std::vector<IPAddress::ptr> &results, const std::string &host, int family) {
+        if (host.empty()) {
+            return false;
+        }
+        IPAddress::ptr literal = ParseLiteral(host);
+        if (literal) {
+            if (family != AF_UNSPEC && family != literal->getFamily()) {
+                return false;
+            }
+            results.push_back(literal);
+            return true;
+        }
+        std::string name = ToLower(host);
+        if (lookupHosts(results, name, family)) {
+            return true;
+        }
+        bool absolute = name.back() == '.';
+        if (absolute) {
+            name.pop_back();
+        }
+        std::vector<std::string> candidates;
+        if (absolute) {
+            candidates.push_back(name);
+        } else {
+            std::vector<std::string> search;
+            int ndots;
+            {
+                MutexType::Lock lock(m_mutex);
+                search = m_search;
+                ndots = m_ndots;
+            }
+            bool enough_dots = std::count(name.begin(), name.end(), '.') >= ndots;
+            if (enough_dots) candidates.push_back(name);
+            for (auto& i : search) {
+                candidates.push_back(name + "." + i);
+            }
+            if (!enough_dots) candidates.push_back(name);
+        }
+        for (auto& i : candidates) {
+            bool found = false;
+            if (family == AF_INET || family == AF_UNSPEC) {
+                found = lookupType(results, i, A) || found;
+            }
+            if (family == AF_INET6 || family == AF_UNSPEC) {
+                found = lookupType(results, i, AAAA) || found;
+            }
+            if (found) return true;
+        }
+        return false;
+    }
+
+    bool DnsResolver::lookupHosts(std::vector<IPAddress::ptr> &results, const std::string &name, int family) {
+        MutexType::Lock lock(m_mutex);
+        auto it = m_hosts.find(name);
+        if (it == m_hosts.end()) {
+            return false;
+        }
+        bool found = false;
+        for (auto& i : it->second) {
+            if (family == AF_UNSPEC || family == i->getFamily()) {
+                CopyAddrs(results, {i});
+                found = true;
+            }
+        }
+        return found;
+    }
+
+    bool DnsResolver::lookupType(std::vector<IPAddress::ptr> &results, const std::string &name, uint16_t qtype) {
+        std::string key = name + "#" + std::to_string(qtype);
+        Pending::ptr pending;
+        bool leader = false;
+        {
+            MutexType::Lock lock(m_mutex);
+            auto it = m_cache.find(key);
+            if (it != m_cache.end()) {
+                if (it->second.expire > GetCurrentMS()) {
+                    CopyAddrs(results, it->second.addrs);
+                    return !it->second.addrs.empty();
+                }
+                m_cache.erase(it);
+            }
+            auto pit = m_pendings.find(key);
+            if (pit != m_pendings.end()) {
+                pending = pit->second;
+            } else {
+                pending = std::make_shared<Pending>();
+                m_pendings[key] = pending;
+                leader = true;
+            }
+        }
+        if (leader) {
+            CacheEntry entry;
+            query(name, qtype, entry);
+            std::list<std::function<void()>> waiters;
+            {
+                MutexType::Lock lock(m_mutex);
+                pending->entry = entry;
+                pending->done = true;
+                waiters.swap(pending->waiters);
+                m_pendings.erase(key);
+                if (entry.expire) {
+                    insertCache(key, entry);
+                }
+            }
+            for (auto& i : waiters) {
+                i();
+            }
+            CopyAddrs(results, entry.addrs);
+            return !entry.addrs.empty();
+        }
+        // 已有相同的查询在进行，挂起等待其结果
+        Scheduler* scheduler = Scheduler::GetThis();
+        if (scheduler && Fiber::GetThisRaw() != Scheduler::GetMainFiber()) {
+            Fiber::ptr self = Fiber::GetThis();
+            bool wait = false;
+            {
+                MutexType::Lock lock(m_mutex);
+                if (!pending->done) {
+                    pending->waiters.push_back([scheduler, self]() {
+                        scheduler->schedule(self);
+                    });
+                    wait = true;
+                }
+            }
+            self.reset();
+            if (wait) {
+                FiberWaitScope scope("dns");
+                Fiber::YieldToHold();
+            }
+        } else {
+            Semaphore sem;
+            {
+                MutexType::Lock lock(m_mutex);
+                if (!pending->done) {
+                    pending->waiters.push_back([&sem]() {
+                        sem.notify();
+                    });
+                } else {
+                    sem.notify();
+                }
+            }
+            sem.wait();
+        }
+        MutexType::Lock lock(m_mutex);
+        CopyAddrs(results, pending->entry.addrs);
+        return !pending->entry.addrs.empty();
+    }
+
+    void DnsResolver::insertCache(const std::string &key, const CacheEntry &entry) {
+        if (m_cache.size() >= g_dns_cache_size->getValue()) {
+            uint64_t now = GetCurrentMS();
+            for (auto it = m_cache.begin(); it != m_cache.end();) {
+                if (it->second.expire <= now) {
+                    it = m_cache.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            if (m_cache.size() >= g_dns_cache_size->getValue()) {
+                m_cache.erase(m_cache.begin());
+            }
+        }
+        m_cache[key] = entry;
+    }
+
+    void DnsResolver::query(const std::string &name, uint16_t qtype, CacheEntry &entry) {
+        uint16_t id = NextQueryId();
+        std::string request;
+        WriteUint16(request, id);
+        WriteUint16(request, DNS_RD);
+        WriteUint16(request, 1);
+        WriteUint16(request, 0);
+        WriteUint16(request, 0);
+        WriteUint16(request, 0);
+        if (!EncodeName(request, name)) {
+            LOG_DEBUG(g_logger) << "dns invalid name=" << name;
+            return;
+        }
+        WriteUint16(request, qtype);
+        WriteUint16(request, 1);
+
+        std::vector<Address::ptr> servers;
+        int attempts;
+        {
+            MutexType::Lock lock(m_mutex);
+            servers = m_servers;
+            attempts = m_attempts;
+        }
+        for (int i = 0; i < attempts; ++i) {
+            for (auto& server : servers) {
+                std::string response;
+                bool retry = false;
+                if (!exchange(server, request, response, false)) {
+                    continue;
+                }
+                if (parse(response, id, qtype, entry, retry)) {
+                    return;
+                }
+                if (retry) {
+                    // 应答被截断，改用 TCP 重查
+                    response.clear();
+                    if (exchange(server, request, response, true)
+                        && parse(response, id, qtype, entry, retry)) {
+                        return;
+                    }
+                }
+            }
+        }
+        LOG_DEBUG(g_logger) << "dns query name=" << name << " type=" << qtype << " failed";
+    }
+
+    static bool RecvFull(Socket::ptr sock, std::string &response, size_t need) {
+        while (response.size() < need) {
+            char tmp[4096];
+            int rt = sock->recv(tmp, std::min(sizeof(tmp), need - response.size()));
+            if (rt <= 0) return false;
+            response.append(tmp, rt);
+        }
+        return true;
+    }
+
+    bool DnsResolver::exchange(Address::ptr server, const std::string &request, std::string &response, bool tcp) {
+        if (!tcp) {
+            return exchangeUdp(server, request, response);
+        }
+        Socket::ptr sock = Socket::CreateTCP(server);
+        if (!sock->connect(server, m_timeout)) {
+            return false;
+        }
+        sock->setRecvTimeout(m_timeout);
+        sock->setSendTimeout(m_timeout);
+        std::string buf;
+        WriteUint16(buf, request.size());
+        buf += request;
+        size_t offset = 0;
+        while (offset < buf.size()) {
+            int rt = sock->send(buf.c_str() + offset, buf.size() - offset);
+            if (rt <= 0) return false;
+            offset += rt;
+        }
+        // 先读 2 字节长度，再读报文
+        if (!RecvFull(sock, response, 2)) {
+            return false;
+        }
+        size_t length = ReadUint16(response, 0);
+        if (length == 0) {
+            LOG_DEBUG(g_logger) << "dns tcp response from " << server->toString() << " has zero length";
+            return false;
+        }
+        if (!RecvFull(sock, response, 2 + length)) {
+            return false;
+        }
+        response.erase(0, 2);
+        return true;
+    }
+
+    bool DnsResolver::exchangeUdp(Address::ptr server, const std::string &request, std::string &response) {
+        Socket::ptr sock = Socket::CreateUDP(server);
+        if (!sock->isValid()) {
+            return false;
+        }
+        sock->setSendTimeout(m_timeout);
+        if (sock->sendTo(request.c_str(), request.size(), server) != (int)request.size()) {
+            return false;
+        }
+        // 未连接的 socket 可能收到其它来源的报文，只接受发给的服务器的应答
+        SockAddr expect(*server);
+        SockAddr from;
+        uint64_t deadline = GetCurrentMS() + m_timeout;
+        response.resize(4096);
+        while (true) {
+            uint64_t now = GetCurrentMS();
+            if (now >= deadline) {
+                return false;
+            }
+            sock->setRecvTimeout(deadline - now);
+            int rt = sock->recvFrom(&response[0], response.size(), from);
+            if (rt < 0) {
+                LOG_DEBUG(g_logger) << "dns recv from " << server->toString() << " rt=" << rt
+                        << " errno=" << errno << " errstr=" << strerror(errno);
+                return false;
+            }
+            if (from == expect) {
+                response.resize(rt);
+                return true;
+            }
+            LOG_DEBUG(g_logger) << "dns drop response from " << from.toString()
+                    << " expect " << server->toString();
+        }
+    }
+
+    bool DnsResolver::parse(const std::string &response, uint16_t id, uint16_t qtype, CacheEntry &entry, bool &retry) {
+        retry = false;
+        if (response.size() < DNS_HEADER_SIZE || ReadUint16(response, 0) != id) {
+            return false;
+        }
+        uint16_t flags = ReadUint16(response, 2);
+        if (!(flags & DNS_QR)) return false;
+        if (flags & DNS_TC) {
+            retry = true;
+            return false;
+        }
+        uint16_t rcode = flags & 0x000f;
+        if (rcode != 0 && rcode != DNS_NXDOMAIN) {
+            // SERVFAIL/REFUSED 等，换下一个服务器
+            return false;
+        }
+        uint16_t qdcount = ReadUint16(response, 4);
+        uint16_t ancount = ReadUint16(response, 6);
+        uint16_t nscount = ReadUint16(response, 8);
+        size_t pos = DNS_HEADER_SIZE;
+        for (uint16_t i = 0; i < qdcount; ++i) {
+            if (!SkipName(response, pos) || pos + 4 > response.size()) return false;
+            pos += 4;
+        }
+        uint32_t ttl = g_dns_max_ttl->getValue();
+        uint32_t negative_ttl = g_dns_negative_ttl->getValue();
+        std::vector<IPAddress::ptr> addrs;
+        for (uint32_t i = 0; i < (uint32_t)ancount + nscount; ++i) {
+            if (!SkipName(response, pos) || pos + 10 > response.size()) return false;
+            uint16_t type = ReadUint16(response, pos);
+            uint32_t rttl = ReadUint32(response, pos + 4);
+            uint16_t rdlen = ReadUint16(response, pos + 8);
+            pos += 10;
+            if (pos + rdlen > response.size()) return false;
+            if (i < ancount && type == qtype) {
+                // CNAME 链由递归服务器展开，这里只取最终类型的记录
+                if (type == A && rdlen == 4) {
+                    sockaddr_in addr;
+                    memset(&addr, 0, sizeof(addr));
+                    addr.sin_family = AF_INET;
+                    memcpy(&addr.sin_addr, response.c_str() + pos, 4);
+                    addrs.push_back(std::make_shared<IPv4Address>(addr));
+                    ttl = std::min(ttl, rttl);
+                } else if (type == AAAA && rdlen == 16) {
+                    sockaddr_in6 addr;
+                    memset(&addr, 0, sizeof(addr));
+                    addr.sin6_family = AF_INET6;
+                    memcpy(&addr.sin6_addr, response.c_str() + pos, 16);
+                    addrs.push_back(std::make_shared<IPv6Address>(addr));
+                    ttl = std::min(ttl, rttl);
+                }
+            } else if (i >= ancount && type == SOA) {
+                // 否定缓存时间取 min(SOA TTL, SOA MINIMUM)
+                size_t p = pos;
+                if (SkipName(response, p) && SkipName(response, p) && p + 20 <= pos + rdlen) {
+                    negative_ttl = std::min(rttl, ReadUint32(response, p + 16));
+                }
+            }
+            pos += rdlen;
+        }
+        if (addrs.empty()) {
+            ttl = negative_ttl;
+        }
+        entry.addrs.swap(addrs);
+        entry.expire = GetCurrentMS() + (uint64_t)ttl * 1000;
+        return true;
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <functional>
+#include "address.h"
+#include "thread.h"
+#include "util.h"
+#include "singleton.h"
+
+namespace svher {
+
+    // 协程化的 DNS 解析器，走 hook 后的 UDP/TCP socket，不会阻塞 IOManager 线程
+    class DnsResolver : Noncopyable {
+    public:
+        typedef std::shared_ptr<DnsResolver> ptr;
+        typedef Mutex MutexType;
+
+        enum QueryType {
+            A = 1,
+            CNAME = 5,
+            SOA = 6,
+            AAAA = 28
+        };
+
+        // 默认加载 /etc/resolv.conf 与 /etc/hosts
+        DnsResolver();
+
+        bool loadResolvConf(const std::string& path = "/etc/resolv.conf");
+        bool loadHosts(const std::string& path = "/etc/hosts");
+
+        void setServers(const std::vector<Address::ptr>& servers);
+        std::vector<Address::ptr> getServers();
+        void setSearch(const std::vector<std::string>& search);
+        void setTimeout(uint64_t ms) { m_timeout = ms; }
+        uint64_t getTimeout() const { return m_timeout; }
+        void setAttempts(int v) { m_attempts = v; }
+        int getAttempts() const { return m_attempts; }
+        void setNdots(int v) { m_ndots = v; }
+
+        // 解析 host (不带端口)，结果追加到 results，端口为 0
+        // family 可为 AF_INET / AF_INET6 / AF_UNSPEC
+        bool resolve(std::vector<IPAddress::ptr>& results, const std::string& host, int family = AF_INET);
+
+        void clearCache();
+        size_t getCacheSize();
+    private:
+        struct CacheEntry {
+            std::vector<IPAddress::ptr> addrs;
+            // 过期时间 (ms)
+            uint64_t expire = 0;
+        };
+
+        // 同一 name/type 并发查询只发一次，其余等待者挂在这里
+        struct Pending {
+            typedef std::shared_ptr<Pending> ptr;
+            bool done = false;
+            CacheEntry entry;
+            std::list<std::function<void()>> waiters;
+        };
+
+        bool lookupHosts(std::vector<IPAddress::ptr>& results, const std::string& name, int family);
+        // 查缓存，未命中则合并查询，返回是否有结果
+        bool lookupType(std::vector<IPAddress::ptr>& results, const std::string& name, uint16_t qtype);
+        void query(const std::string& name, uint16_t qtype, CacheEntry& entry);
+        bool exchange(Address::ptr server, const std::string& request, std::string& response, bool tcp);
+        // 未连接的 UDP socket 收发，丢弃非该服务器发来的报文
+        bool exchangeUdp(Address::ptr server, const std::string& request, std::string& response);
+        bool parse(const std::string& response, uint16_t id, uint16_t qtype, CacheEntry& entry, bool& retry);
+        void insertCache(const std::string& key, const CacheEntry& entry);
+
+        MutexType m_mutex;
+        std::vector<Address::ptr> m_servers;
+        std::vector<std::string> m_search;
+        std::map<std::string, std::vector<IPAddress::ptr>> m_hosts;
+        std::unordered_map<std::string, CacheEntry> m_cache;
+        std::unordered_map<std::string, Pending::ptr> m_pendings;
+        uint64_t m_timeout = 5000;
+        int m_attempts = 2;
+        int m_ndots = 1;
+    };
+
+    typedef Singleton<DnsResolver> DnsMgr;
+}
@@ -0,0 +1,136 @@
+#include "fdhandoff.h"
+#include "deadline.h"
+#include "log.h"
+#include <unistd.h>
+
+namespace svher {
+
+    static Logger::ptr g_logger = LOG_NAME("sys");
+
+    const size_t FdHandoff::MAX_BATCH;
+
+    // 消息首字节: 一批 fd (其后为以 '\0' 结尾的名称)、结束 (其后为 fd 总数)、新进程的确认
+    static const char MSG_FDS = 'F';
+    static const char MSG_END = 'E';
+    static const char MSG_ACK = 'K';
+
+    static Socket::ptr CreateSeqPacket() {
+        return Socket::ptr(new Socket(Socket::Unix, SOCK_SEQPACKET, 0));
+    }
+
+    bool FdHandoff::Send(const std::string &path, const std::vector<Item> &items, uint64_t timeout_ms) {
+        DeadlineScope scope(timeout_ms);
+        Address::ptr addr(new UnixAddress(path));
+        Socket::ptr listener = CreateSeqPacket();
+        ::unlink(path.c_str());
+        if (!listener->bind(addr) || !listener->listen(1)) {
+            return false;
+        }
+        Socket::ptr peer = listener->accept();
+        bool ok = false;
+        do {
+            if (!peer) {
+                break;
+            }
+            size_t i = 0;
+            for (; i < items.size(); i += MAX_BATCH) {
+                std::string payload(1, MSG_FDS);
+                std::vector<int> fds;
+                for (size_t j = i; j < items.size() && j < i + MAX_BATCH; ++j) {
+                    payload.append(items[j].name).push_back('\0');
+                    fds.push_back(items[j].sock->getSocket());
+                }
+                if (peer->sendFds(&fds[0], fds.size(), payload.data(), payload.size()) != (int)payload.size()) {
+                    break;
+                }
+            }
+            if (i < items.size()) {
+                break;
+            }
+            char end[1 + sizeof(uint32_t)];
+            end[0] = MSG_END;
+            uint32_t count = items.size();
+            memcpy(end + 1, &count, sizeof(count));
+            if (peer->send(end, sizeof(end)) != sizeof(end)) {
+                break;
+            }
+            char ack = 0;
+            ok = peer->recv(&ack, 1) == 1 && ack == MSG_ACK;
+        } while (false);
+        if (!ok) {
+            LOG_ERROR(g_logger) << "fd handoff send to " << path << " fail errno=" << errno
+                                << " errstr=" << strerror(errno);
+        } else {
+            LOG_INFO(g_logger) << "fd handoff sent " << items.size() << " fds via " << path;
+        }
+        ::unlink(path.c_str());
+        return ok;
+    }
+
+    bool FdHandoff::Receive(const std::string &path, std::vector<Item> &items, uint64_t timeout_ms) {
+        DeadlineScope scope(timeout_ms);
+        Address::ptr addr(new UnixAddress(path));
+        Socket::ptr sock = CreateSeqPacket();
+        if (!sock->connect(addr)) {
+            return false;
+        }
+        std::vector<Item> received;
+        std::vector<char> buffer(64 * 1024);
+        while (true) {
+            std::vector<int> fds;
+            int n = sock->recvFds(&buffer[0], buffer.size(), fds);
+            // 先包装收到的 fd，出错返回时随 Socket 一起关闭
+            std::vector<Socket::ptr> socks;
+            for (int fd : fds) {
+                Socket::ptr s = Socket::FromFd(fd);
+                if (!s) {
+                    ::close(fd);
+                }
+                socks.push_back(s);
+            }
+            if (n <= 0) {
+                LOG_ERROR(g_logger) << "fd handoff receive from " << path << " fail n=" << n
+                                    << " errno=" << errno << " errstr=" << strerror(errno);
+                return false;
+            }
+            if (buffer[0] == MSG_END) {
+                uint32_t count = 0;
+                if (n != 1 + sizeof(count) || !fds.empty()) {
+                    return false;
+                }
+                memcpy(&count, &buffer[1], sizeof(count));
+                if (count != received.size()) {
+                    LOG_ERROR(g_logger) << "fd handoff expect " << count << " fds, received " << received.size();
+                    return false;
+                }
+                break;
+            }
+            if (buffer[0] != MSG_FDS) {
+                return false;
+            }
+            std::vector<std::string> names;
+            for (int begin = 1; begin < n;) {
+                const char* name = &buffer[begin];
+                size_t len = strnlen(name, n - begin);
+                names.emplace_back(name, len);
+                begin += len + 1;
+            }
+            if (names.size() != socks.size()) {
+                return false;
+            }
+            for (size_t i = 0; i < socks.size(); ++i) {
+                if (!socks[i]) {
+                    return false;
+                }
+                received.push_back({names[i], socks[i]});
+            }
+        }
+        char ack = MSG_ACK;
+        if (sock->send(&ack, 1) != 1) {
+            return false;
+        }
+        items.insert(items.end(), received.begin(), received.end());
+        LOG_INFO(g_logger) << "fd handoff received " << received.size() << " fds via " << path;
+        return true;
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "socket.h"
+
+namespace svher {
+
+    // 进程重启时把监听 socket 和空闲的长连接交给新进程，监听队列中的连接不会被拒绝
+    // 旧进程 Send 在 Unix 路径上等待新进程，新进程 Receive 连接该路径，
+    // 经 SOCK_SEQPACKET 按批用 SCM_RIGHTS 传递，每个 fd 附带名称供新进程认领
+    // 新进程确认收齐后 Send 返回 true，旧进程随后应 TcpServer::stopAccept 并处理完手上的请求后退出；
+    // 新进程用 TcpServer::addListener 接管收到的监听 socket
+    // 两端都在当前协程中挂起，受 timeout_ms 和协程截止时间约束
+    class FdHandoff {
+    public:
+        struct Item {
+            std::string name;
+            Socket::ptr sock;
+        };
+        // 每条消息最多携带的 fd 数
+        static const size_t MAX_BATCH = 64;
+
+        // path 已存在时先删除，返回前删除
+        static bool Send(const std::string& path, const std::vector<Item>& items, uint64_t timeout_ms = -1);
+        // 没有旧进程在等待时立即返回 false，收到的 socket 已注册到 FdManager
+        static bool Receive(const std::string& path, std::vector<Item>& items, uint64_t timeout_ms = -1);
+    };
+}
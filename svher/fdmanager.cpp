@@ -21,16 +21,20 @@ namespace svher {
         if (fstat(m_fd, &fd_stat) == -1) {
             m_isInit = false;
             m_isSocket = false;
+            m_isFifo = false;
+            m_isFile = false;
         } else {
             m_isInit = true;
             m_isSocket = S_ISSOCK(fd_stat.st_mode);
+            m_isFifo = S_ISFIFO(fd_stat.st_mode);
+            m_isFile = S_ISREG(fd_stat.st_mode);
         }
         if (m_isSocket) {
             int flags = fcntl_f(m_fd, F_GETFL, 0);
             if (!(flags & O_NONBLOCK)) {
-                m_sysNonblock = true;
+                fcntl_f(m_fd, F_SETFL, flags | O_NONBLOCK);
             }
-            fcntl_f(m_fd, F_SETFL, flags | O_NONBLOCK);
+            m_sysNonblock = true;
         } else m_sysNonblock = false;
         m_userNonblock = false;
         m_isClosed = false;
@@ -64,6 +68,9 @@ namespace svher {
     }
 
     FdContext::ptr FdManager::get(int fd, bool auto_create) {
+        if (fd < 0) {
+            return nullptr;
+        }
         RWMutexType::ReadLock lock(m_mutex);
         if ((int)m_datas.size() <= fd) {
             if (!auto_create) {
@@ -75,6 +82,9 @@ namespace svher {
         }
         lock.unlock();
         RWMutexType::WriteLock lock1(m_mutex);
+        if ((int)m_datas.size() <= fd) {
+            m_datas.resize(fd * 1.5);
+        }
         FdContext::ptr context(new FdContext(fd));
         m_datas[fd] = context;
         return context;
@@ -15,16 +15,24 @@ namespace svher {
         bool init();
         bool isInit() const { return m_isInit; }
         bool isSocket() const { return m_isSocket; }
+        bool isFifo() const { return m_isFifo; }
+        // 普通文件不能用 epoll 等待，可交给 Offload 线程池执行
+        bool isFile() const { return m_isFile; }
+        // socket 和经 hook 创建的 pipe 都已设为非阻塞，可以挂到 IOManager 上等待
+        bool isPollable() const { return m_isSocket || (m_isFifo && m_sysNonblock); }
         bool isClosed() const { return m_isClosed; }
         bool close();
         bool getUserNonblock() const { return m_userNonblock; }
         void setUserNonblock(bool v) { m_userNonblock = v; }
         bool getSysNonblock() const { return m_sysNonblock; }
+        void setSysNonblock(bool v) { m_sysNonblock = v; }
         void setTimeout(int type, uint64_t v);
         uint64_t getTimeout(int type);
     private:
         bool m_isInit = false;
         bool m_isSocket = false;
+        bool m_isFifo = false;
+        bool m_isFile = false;
         bool m_sysNonblock = false;
         bool m_userNonblock = false;
         bool m_isClosed = false;
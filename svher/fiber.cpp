@@ -2,10 +2,14 @@
 #include "config.h"
 #include "macro.h"
 #include "scheduler.h"
+#include "fibersync.h"
+#include "fiberregistry.h"
+#include "stackprofile.h"
 
 namespace svher {
     static std::atomic<uint64_t> s_fiber_id{0};
     static std::atomic<uint64_t> s_fiber_count{0};
+    static std::atomic<uint64_t> s_pooled_count{0};
 
     // 当前线程正在执行的协程
     static thread_local Fiber* t_fiber = nullptr;
@@ -29,11 +33,33 @@ namespace svher {
 
     using StackAlloc = MallocStackAllocator;
 
+    static ConfigVar<std::map<std::string, uint32_t> >::ptr g_fiber_stack_classes =
+            Config::Lookup("fiber.stack_classes",
+                           std::map<std::string, uint32_t>{{"small", 64 * 1024}, {"large", 8 * 1024 * 1024}},
+                           "named fiber stack sizes, default is fiber.stack_size");
+
+    static ConfigVar<uint32_t>::ptr g_fiber_pool_size =
+            Config::Lookup<uint32_t>("fiber.pool_size", 64, "idle fibers cached per thread");
+
+    // 每个线程缓存的空闲协程，协程归还到最后一个引用释放时所在线程的池
+    struct FiberPool {
+        std::vector<Fiber*> fibers;
+        ~FiberPool();
+    };
+
+    static thread_local FiberPool t_pool;
+    // 线程退出时池已析构，之后释放的协程直接删除
+    static thread_local bool t_poolClosed = false;
+
+    static std::atomic<size_t> s_local_slots{0};
+    static void (*s_local_destroys[FLS_MAX_SLOTS])(void*) = {};
+
     Fiber::Fiber(std::function<void()> cb, size_t stacksize, bool use_caller)
         : m_id(++s_fiber_id), m_useCaller(use_caller), m_cb(std::move(cb)) {
         ++s_fiber_count;
         m_stacksize = stacksize ? stacksize : g_fiber_stack_size->getValue();
         m_stack = StackAlloc::Alloc(m_stacksize);
+        paintStack();
         if (getcontext(&m_ctx)) {
             ASSERT2(false, "getcontext");
         }
@@ -46,9 +72,16 @@ namespace svher {
         else {
             makecontext(&m_ctx, &Fiber::MainFunc, 0);
         }
+        if (FiberRegistry::IsEnabled()) {
+            FiberRegistry::Add(this);
+        }
         LOG_DEBUG(g_logger) << "Fiber::Fiber id: " << m_id;
     }
 
+    Fiber::Fiber(std::function<void()> cb, const std::string& stack_class, bool use_caller)
+        : Fiber(std::move(cb), GetStackClassSize(stack_class), use_caller) {
+    }
+
     Fiber::Fiber() {
         m_state = EXEC;
         SetThis(this);
@@ -56,11 +89,18 @@ namespace svher {
             ASSERT2(false, "getcontext");
         }
         ++s_fiber_count;
+        if (FiberRegistry::IsEnabled()) {
+            FiberRegistry::Add(this);
+        }
         LOG_DEBUG(g_logger) << "Fiber::Fiber";
     }
 
     Fiber::~Fiber() {
         --s_fiber_count;
+        if (m_registered) {
+            FiberRegistry::Del(this);
+        }
+        clearLocals();
         if (m_stack) {
             ASSERT2(m_state == TERM || m_state == INIT || m_state == EXCEPT,
                    "id: " + std::to_string(m_id) + "state: " + std::to_string(m_state));
@@ -76,17 +116,132 @@ namespace svher {
         LOG_DEBUG(g_logger) << "Fiber::~Fiber id: " << m_id;
     }
 
+    FiberPool::~FiberPool() {
+        t_poolClosed = true;
+        for (auto f : fibers) {
+            // 入池时已从计数中扣除
+            ++s_fiber_count;
+            --s_pooled_count;
+            delete f;
+        }
+    }
+
+    void Fiber::Release(Fiber* fiber) {
+        State state = fiber->m_state;
+        // Offload 工作线程或普通线程上释放的协程入池后不会再被取用，直接删除
+        if (t_poolClosed
+            || (fiber->m_homePool != &t_pool && !Scheduler::GetThis())
+            || (state != TERM && state != INIT && state != EXCEPT)
+            || fiber->m_stacksize != g_fiber_stack_size->getValue()
+            || t_pool.fibers.size() >= g_fiber_pool_size->getValue()) {
+            delete fiber;
+            return;
+        }
+        fiber->recycle();
+        t_pool.fibers.push_back(fiber);
+        ++s_pooled_count;
+    }
+
+    Fiber::ptr Fiber::Create(std::function<void()> cb, size_t stacksize) {
+        if (!t_pool.fibers.empty()
+            && (!stacksize || stacksize == t_pool.fibers.back()->m_stacksize)) {
+            Fiber* fiber = t_pool.fibers.back();
+            t_pool.fibers.pop_back();
+            --s_pooled_count;
+            fiber->m_id = ++s_fiber_id;
+            ++s_fiber_count;
+            fiber->reset(std::move(cb));
+            if (FiberRegistry::IsEnabled()) {
+                FiberRegistry::Add(fiber);
+            }
+            fiber->m_homePool = &t_pool;
+            return Fiber::ptr(fiber, &Fiber::Release);
+        }
+        Fiber* fiber = new Fiber(std::move(cb), stacksize);
+        fiber->m_homePool = &t_pool;
+        return Fiber::ptr(fiber, &Fiber::Release);
+    }
+
+    Fiber::ptr Fiber::Create(std::function<void()> cb, const std::string& stack_class) {
+        return Create(std::move(cb), GetStackClassSize(stack_class));
+    }
+
+    uint32_t Fiber::GetStackClassSize(const std::string& name) {
+        if (name != "default") {
+            auto classes = g_fiber_stack_classes->getValue();
+            auto it = classes.find(name);
+            if (it != classes.end()) {
+                return it->second;
+            }
+        }
+        return g_fiber_stack_size->getValue();
+    }
+
+    std::map<std::string, uint32_t> Fiber::GetStackClasses() {
+        auto classes = g_fiber_stack_classes->getValue();
+        classes["default"] = g_fiber_stack_size->getValue();
+        return classes;
+    }
+
+    void Fiber::paintStack() {
+        if (!StackProfile::IsEnabled()) {
+            m_stackPainted = false;
+            m_stackUsed = 0;
+            return;
+        }
+        // 填充过的栈只需重填上次用过的部分
+        if (m_stackPainted) {
+            StackProfile::Paint((char*)m_stack + m_stacksize - m_stackUsed, m_stackUsed);
+        } else {
+            StackProfile::Paint(m_stack, m_stacksize);
+        }
+        m_stackPainted = true;
+        m_stackUsed = 0;
+        m_siteType = &m_cb.target_type();
+        auto fn = m_cb.target<void(*)()>();
+        m_siteFn = fn ? (void*)*fn : nullptr;
+    }
+
+    void Fiber::recordStack() {
+        if (!m_stackPainted) {
+            return;
+        }
+        m_stackUsed = StackProfile::Measure(m_stack, m_stacksize);
+        StackProfile::Record(m_siteType, m_siteFn, m_stackUsed, m_stacksize);
+    }
+
+    void Fiber::recycle() {
+        --s_fiber_count;
+        if (m_registered) {
+            FiberRegistry::Del(this);
+        }
+        clearLocals();
+        m_cb = nullptr;
+        m_state = TERM;
+    }
+
     void Fiber::reset(std::function<void()> cb) {
         ASSERT(m_stack);
-        ASSERT(m_state == TERM || m_state == INIT);
+        ASSERT(m_state == TERM || m_state == INIT || m_state == EXCEPT);
+        clearLocals();
+        m_cpuTime = 0;
+        m_switches = 0;
+        m_tag = 0;
+        m_lastRun = 0;
+        m_waitWhat = nullptr;
         m_cb = std::move(cb);
+        paintStack();
         if (getcontext(&m_ctx)) {
             ASSERT2(false, "getcontext");
         }
         m_ctx.uc_link = nullptr;
         m_ctx.uc_stack.ss_sp = m_stack;
         m_ctx.uc_stack.ss_size = m_stacksize;
-        makecontext(&m_ctx, &Fiber::MainFunc, 0);
+        if (m_useCaller)
+            makecontext(&m_ctx, &Fiber::CallerMainFunc, 0);
+        else {
+            makecontext(&m_ctx, &Fiber::MainFunc, 0);
+        }
         m_state = INIT;
     }
 
@@ -126,8 +281,15 @@ namespace svher {
         return t_fiber->shared_from_this();
     }
 
+    Fiber* Fiber::GetThisRaw() {
+        if (t_fiber) {
+            return t_fiber;
+        }
+        return GetThis().get();
+    }
+
     void Fiber::YieldToReady() {
-        Fiber::ptr cur = GetThis();
+        Fiber* cur = GetThisRaw();
         cur->m_state = READY;
         if (cur->m_useCaller)
             cur->callOut();
@@ -136,8 +298,10 @@ namespace svher {
     }
 
     void Fiber::YieldToHold() {
-        Fiber::ptr cur = GetThis();
-        cur->m_state = HOLD;
+        Fiber* cur = GetThisRaw();
+        // 保持 EXEC 直到真正切出，由调度器置为 HOLD，
+        // 避免其它线程在上下文保存前就把该协程 schedule 并 swapIn
+        ASSERT(cur->m_state == EXEC);
         if (cur->m_useCaller)
             cur->callOut();
         else
@@ -148,6 +312,10 @@ namespace svher {
         return s_fiber_count;
     }
 
+    uint64_t Fiber::PooledFibers() {
+        return s_pooled_count;
+    }
+
     void Fiber::MainFunc() {
         Fiber::ptr cur = GetThis();
         ASSERT(cur);
@@ -164,6 +332,9 @@ namespace svher {
             cur->m_state = EXCEPT;
             LOG_ERROR(g_logger) << "Fiber exception: ";
         }
+        cur->recordStack();
+        cur->clearLocals();
+        cur->notifyJoiners();
         // 销毁智能指针
         auto raw_ptr = cur.get();
         cur.reset();
@@ -174,10 +345,83 @@ namespace svher {
         ASSERT2(false, "execution should never reach here");
     }
 
+    bool Fiber::join() {
+        ASSERT(t_fiber != this);
+        FiberWaiter::ptr waiter;
+        {
+            Spinlock::Lock lock(m_joinMutex);
+            if (m_state == TERM || m_state == EXCEPT) {
+                return true;
+            }
+            waiter.reset(new FiberWaiter("join"));
+            m_joiners.push_back([waiter]() {
+                waiter->notify();
+            });
+        }
+        int err = waiter->waitInterruptible();
+        if (err) {
+            errno = err;
+            return false;
+        }
+        return true;
+    }
+
+    void Fiber::notifyJoiners() {
+        std::vector<std::function<void()>> joiners;
+        {
+            Spinlock::Lock lock(m_joinMutex);
+            joiners.swap(m_joiners);
+        }
+        for (auto& i : joiners) {
+            i();
+        }
+    }
+
+    size_t Fiber::AllocLocalSlot(void (*destroy)(void*)) {
+        size_t slot = s_local_slots++;
+        ASSERT2(slot < FLS_MAX_SLOTS, "too many fiber local slots");
+        s_local_destroys[slot] = destroy;
+        return slot;
+    }
+
+    void* Fiber::GetLocal(size_t slot) {
+        Fiber* cur = GetThisRaw();
+        return cur->m_locals[slot];
+    }
+
+    void Fiber::SetLocal(size_t slot, void* value) {
+        Fiber* cur = GetThisRaw();
+        void* old = cur->m_locals[slot];
+        cur->m_locals[slot] = value;
+        if (value) {
+            cur->m_localMask |= 1u << slot;
+        } else {
+            cur->m_localMask &= ~(1u << slot);
+        }
+        if (old && old != value) {
+            s_local_destroys[slot](old);
+        }
+    }
+
+    void Fiber::clearLocals() {
+        // 析构函数里可能再次设置槽位，循环直到清空
+        while (m_localMask) {
+            size_t slot = __builtin_ctz(m_localMask);
+            void* value = m_locals[slot];
+            m_locals[slot] = nullptr;
+            m_localMask &= ~(1u << slot);
+            s_local_destroys[slot](value);
+        }
+    }
+
     void Fiber::SetThis(Fiber *f) {
         t_fiber = f;
     }
 
+    void Fiber::SetTag(uint32_t tag) {
+        GetThisRaw()->m_tag = tag;
+    }
+
     uint64_t Fiber::GetFiberId() {
         if (t_fiber) {
             return t_fiber->getId();
@@ -185,6 +429,21 @@ namespace svher {
         return 0;
     }
 
+    FiberWaitScope::FiberWaitScope(const char* what, int fd, uint32_t event)
+        : m_fiber(t_fiber) {
+        if (m_fiber) {
+            m_fiber->m_waitWhat = what;
+            m_fiber->m_waitFd = fd;
+            m_fiber->m_waitEvent = event;
+        }
+    }
+
+    FiberWaitScope::~FiberWaitScope() {
+        if (m_fiber) {
+            m_fiber->m_waitWhat = nullptr;
+        }
+    }
+
     void Fiber::call() {
         SetThis(this);
         m_state = EXEC;
@@ -210,6 +469,9 @@ namespace svher {
             cur->m_state = EXCEPT;
             LOG_ERROR(g_logger) << "Fiber exception: ";
         }
+        cur->recordStack();
+        cur->clearLocals();
+        cur->notifyJoiners();
         // 销毁智能指针
         auto raw_ptr = cur.get();
         cur.reset();
@@ -2,12 +2,26 @@
 
 #include <ucontext.h>
 #include <memory>
+#include <map>
+#include <string>
+#include <typeinfo>
+#include <vector>
+#include <functional>
 #include "thread.h"
 
 namespace svher {
+    // 每个协程内联的局部存储槽位数
+    static const size_t FLS_MAX_SLOTS = 16;
+    // 登记表记录的创建位置帧数
+    static const int FIBER_SITE_DEPTH = 8;
+
+    class Scheduler;
+
     class Fiber : public std::enable_shared_from_this<Fiber> {
     public:
         friend class Scheduler;
+        friend class FiberRegistry;
+        friend class FiberWaitScope;
         typedef std::shared_ptr<Fiber> ptr;
         enum State {
             INIT,
@@ -18,28 +32,73 @@ namespace svher {
             EXCEPT
         };
         explicit Fiber(std::function<void()> cb, size_t stacksize = 0, bool use_caller = false);
+        // 按栈规格名 (small/default/large 等，见 GetStackClasses) 分配栈
+        Fiber(std::function<void()> cb, const std::string& stack_class, bool use_caller = false);
         ~Fiber();
-        // INIT TERM 可调用此函数
+        // 优先从当前线程的协程池复用已结束的协程及其栈，最后一个引用释放时归还到池中
+        // 只回收默认栈大小的协程，池容量由 fiber.pool_size 配置
+        // 只有调度线程或创建它的线程会回收，Offload 等其它线程释放时直接删除
+        static Fiber::ptr Create(std::function<void()> cb, size_t stacksize = 0);
+        static Fiber::ptr Create(std::function<void()> cb, const std::string& stack_class);
+        // 栈规格由 fiber.stack_classes 配置，default 即 fiber.stack_size，未知的名字按 default 处理
+        static uint32_t GetStackClassSize(const std::string& name);
+        static std::map<std::string, uint32_t> GetStackClasses();
+        // INIT TERM EXCEPT 可调用此函数
         void reset(std::function<void()> cb);
 
         void call();
         void callOut();
         uint64_t getId() const { return m_id; }
         State getState() const { return m_state; }
+        // 以下统计在开启 fiber.stats 时由调度器记录，reset 复用时清零
+        // 累计上 CPU 时间 (纳秒) 与被调度次数
+        uint64_t getCpuTime() const { return m_cpuTime; }
+        uint64_t getSwitches() const { return m_switches; }
+        uint32_t getTag() const { return m_tag; }
+        uint32_t getStackSize() const { return m_stacksize; }
+        // 开启 fiber.stack_profile 时为上次执行结束时的栈最高水位，否则为 0
+        uint32_t getStackUsed() const { return m_stackUsed; }
+        // 设置当前协程的统计标签 (FiberStats::RegisterTag 返回的 id)
+        static void SetTag(uint32_t tag);
+        // 挂起当前协程 (普通线程中则阻塞) 直到本协程执行结束
+        // 当前协程的截止时间到达或被取消时返回 false，errno 为原因
+        bool join();
         static Fiber::ptr GetThis();
+        // 同 GetThis，但不增加引用计数，用于不需要持有协程的地方
+        static Fiber* GetThisRaw();
         static void YieldToReady();
         static void YieldToHold();
+        // 存活的协程数，不含池中空闲的
         static uint64_t TotalFibers();
+        // 所有线程的池中空闲的协程数
+        static uint64_t PooledFibers();
         static void MainFunc();
         static void CallerMainFunc();
         static void SetThis(Fiber* f);
         static uint64_t GetFiberId();
+        // 分配协程局部存储槽位，destroy 用于协程结束或 reset 时释放值
+        static size_t AllocLocalSlot(void (*destroy)(void*));
+        // 读写当前协程的槽位，SetLocal 会先释放旧值
+        static void* GetLocal(size_t slot);
+        static void SetLocal(size_t slot, void* value);
 
         void swapOut();
 
     private:
         Fiber();
         void swapIn();
+        // 协程结束时唤醒 join 的等待者
+        void notifyJoiners();
+        // 释放所有已设置的局部存储
+        void clearLocals();
+        // Create 返回的协程的删除器，可回收且当前线程会再 Create 时放入当前线程的池
+        static void Release(Fiber* fiber);
+        // 入池前释放回调与局部存储
+        void recycle();
+        // 开启栈水位统计时填充栈并记录调度点，须在 makecontext 之前调用
+        void paintStack();
+        // 协程结束时测量栈水位
+        void recordStack();
 
         uint64_t m_id = 0;
         uint32_t m_stacksize = 0;
@@ -47,6 +106,46 @@ namespace svher {
         ucontext_t m_ctx;
         void* m_stack = nullptr;
         bool m_useCaller;
+        // Create 所在线程的协程池
+        const void* m_homePool = nullptr;
         std::function<void()> m_cb;
+        Spinlock m_joinMutex;
+        std::vector<std::function<void()>> m_joiners;
+        uint64_t m_cpuTime = 0;
+        uint64_t m_switches = 0;
+        uint32_t m_tag = 0;
+        // 栈水位统计: 栈是否已填充、上次测得的用量、调度点 (回调类型与函数地址)
+        bool m_stackPainted = false;
+        uint32_t m_stackUsed = 0;
+        const std::type_info* m_siteType = nullptr;
+        void* m_siteFn = nullptr;
+        // 已设置槽位的位图，为 0 时结束协程无需遍历
+        uint32_t m_localMask = 0;
+        void* m_locals[FLS_MAX_SLOTS] = {};
+        // 以下由 FiberRegistry 使用，开启 fiber.registry 后创建的协程才会登记
+        Fiber* m_regPrev = nullptr;
+        Fiber* m_regNext = nullptr;
+        bool m_registered = false;
+        int m_createDepth = 0;
+        void* m_createSite[FIBER_SITE_DEPTH];
+        // 最近一次执行所在的调度器与开始时间 (GetCurrentMS)
+        Scheduler* m_scheduler = nullptr;
+        uint64_t m_lastRun = 0;
+        // 挂起等待的对象，见 FiberWaitScope
+        const char* m_waitWhat = nullptr;
+        int m_waitFd = -1;
+        uint32_t m_waitEvent = 0;
+    };
+
+    // 作用域内记录当前协程在等待什么 (fd 与事件、定时器、channel 等)，
+    // 供 FiberRegistry 输出；what 须为字符串常量
+    class FiberWaitScope {
+    public:
+        explicit FiberWaitScope(const char* what, int fd = -1, uint32_t event = 0);
+        ~FiberWaitScope();
+        FiberWaitScope(const FiberWaitScope&) = delete;
+        FiberWaitScope& operator=(const FiberWaitScope&) = delete;
+    private:
+        Fiber* m_fiber;
     };
 }
\ No newline at end of file
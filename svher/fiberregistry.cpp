@@ -0,0 +1,275 @@
+#include "fiberregistry.h"
+#include "fiber.h"
+#include "scheduler.h"
+#include "iomanager.h"
+#include "hook.h"
+#include "config.h"
+#include "log.h"
+#include <execinfo.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <ucontext.h>
+#include <cstring>
+#include <set>
+#include <sstream>
+
+namespace svher {
+    static Logger::ptr g_logger = LOG_NAME("sys");
+
+    static ConfigVar<bool>::ptr g_fiber_registry =
+            Config::Lookup<bool>("fiber.registry", false, "track live fibers for diagnostics");
+
+    static const int MAX_UNWIND_FRAMES = 32;
+
+    std::atomic<bool> FiberRegistry::s_enabled{false};
+
+    struct RegistryData {
+        Mutex mutex;
+        Fiber* head = nullptr;
+        size_t count = 0;
+        std::set<Scheduler*> schedulers;
+        // 信号触发的转储
+        int pipe[2] = {-1, -1};
+        Thread::ptr dumpThread;
+        std::function<void(const std::string&)> out;
+    };
+
+    // 不析构，线程退出时主协程仍会从表中删除
+    static RegistryData& GetData() {
+        static RegistryData* s_data = new RegistryData;
+        return *s_data;
+    }
+
+    struct FiberRegistryIniter {
+        FiberRegistryIniter() {
+            FiberRegistry::SetEnabled(g_fiber_registry->getValue());
+            g_fiber_registry->addListener([](const bool& old_value, const bool& new_value) {
+                FiberRegistry::SetEnabled(new_value);
+            });
+        }
+    };
+
+    static FiberRegistryIniter s_initer;
+
+    static const char* StateToString(Fiber::State state) {
+        switch (state) {
+#define XX(name) \
+            case Fiber::name: \
+                return #name;
+            XX(INIT);
+            XX(HOLD);
+            XX(EXEC);
+            XX(TERM);
+            XX(READY);
+            XX(EXCEPT);
+#undef XX
+            default:
+                return "UNKNOWN";
+        }
+    }
+
+    static void AppendFrames(std::stringstream& ss, void** frames, int n) {
+        if (n <= 0) {
+            return;
+        }
+        char** symbols = backtrace_symbols(frames, n);
+        if (!symbols) {
+            return;
+        }
+        for (int i = 0; i < n; ++i) {
+            ss << "        " << symbols[i] << std::endl;
+        }
+        free(symbols);
+    }
+
+    void FiberRegistry::Add(Fiber* fiber) {
+        // 跳过 Add 与 Fiber 构造函数本身
+        void* frames[FIBER_SITE_DEPTH + 2];
+        int n = ::backtrace(frames, FIBER_SITE_DEPTH + 2);
+        fiber->m_createDepth = std::max(n - 2, 0);
+        if (fiber->m_createDepth) {
+            memcpy(fiber->m_createSite, frames + 2, fiber->m_createDepth * sizeof(void*));
+        }
+        RegistryData& data = GetData();
+        Mutex::Lock lock(data.mutex);
+        fiber->m_regPrev = nullptr;
+        fiber->m_regNext = data.head;
+        if (data.head) {
+            data.head->m_regPrev = fiber;
+        }
+        data.head = fiber;
+        fiber->m_registered = true;
+        ++data.count;
+    }
+
+    void FiberRegistry::Del(Fiber* fiber) {
+        RegistryData& data = GetData();
+        Mutex::Lock lock(data.mutex);
+        if (fiber->m_regPrev) {
+            fiber->m_regPrev->m_regNext = fiber->m_regNext;
+        } else {
+            data.head = fiber->m_regNext;
+        }
+        if (fiber->m_regNext) {
+            fiber->m_regNext->m_regPrev = fiber->m_regPrev;
+        }
+        fiber->m_regPrev = fiber->m_regNext = nullptr;
+        fiber->m_registered = false;
+        --data.count;
+    }
+
+    void FiberRegistry::AddScheduler(Scheduler* scheduler) {
+        RegistryData& data = GetData();
+        Mutex::Lock lock(data.mutex);
+        data.schedulers.insert(scheduler);
+    }
+
+    void FiberRegistry::DelScheduler(Scheduler* scheduler) {
+        RegistryData& data = GetData();
+        Mutex::Lock lock(data.mutex);
+        data.schedulers.erase(scheduler);
+    }
+
+    size_t FiberRegistry::GetCount() {
+        RegistryData& data = GetData();
+        Mutex::Lock lock(data.mutex);
+        return data.count;
+    }
+
+    int FiberRegistry::Unwind(Fiber* fiber, void** frames, int max) {
+#if defined(__x86_64__)
+        // 只有已切出的协程保存了有效的上下文，主协程没有独立的栈
+        Fiber::State state = fiber->m_state;
+        if (!fiber->m_stack || (state != Fiber::HOLD && state != Fiber::READY) || max <= 0) {
+            return 0;
+        }
+        // 协程可能正被其它线程切入，只在它自己的栈范围内读取
+        uintptr_t low = (uintptr_t)fiber->m_stack;
+        uintptr_t high = low + fiber->m_stacksize;
+        const greg_t* regs = fiber->m_ctx.uc_mcontext.gregs;
+        int n = 0;
+        frames[n++] = (void*)regs[REG_RIP];
+        uintptr_t fp = regs[REG_RBP];
+        while (n < max && fp >= low && fp + 2 * sizeof(uintptr_t) <= high
+               && fp % sizeof(uintptr_t) == 0) {
+            uintptr_t* frame = (uintptr_t*)fp;
+            if (!frame[1]) {
+                break;
+            }
+            frames[n++] = (void*)frame[1];
+            // 栈向低地址增长，外层帧一定在更高的地址
+            if (frame[0] <= fp) {
+                break;
+            }
+            fp = frame[0];
+        }
+        return n;
+#else
+        return 0;
+#endif
+    }
+
+    std::string FiberRegistry::Dump(bool backtrace) {
+        RegistryData& data = GetData();
+        uint64_t now = GetCurrentMS();
+        std::stringstream ss;
+        Mutex::Lock lock(data.mutex);
+        ss << "fibers: " << data.count << std::endl;
+        for (Fiber* f = data.head; f; f = f->m_regNext) {
+            ss << "fiber " << f->m_id << " state=" << StateToString(f->m_state);
+            if (!f->m_stack) {
+                ss << " main";
+            }
+            Scheduler* scheduler = f->m_scheduler;
+            if (scheduler && data.schedulers.count(scheduler)) {
+                ss << " scheduler=" << scheduler->getName();
+            }
+            uint64_t last_run = f->m_lastRun;
+            if (last_run) {
+                ss << " last_run=" << (now > last_run ? now - last_run : 0) << "ms ago";
+            }
+            const char* what = f->m_waitWhat;
+            if (what) {
+                ss << " wait=" << what;
+                if (f->m_waitFd != -1) {
+                    ss << "(fd=" << f->m_waitFd;
+                    if (f->m_waitEvent & IOManager::READ) {
+                        ss << " READ";
+                    }
+                    if (f->m_waitEvent & IOManager::WRITE) {
+                        ss << " WRITE";
+                    }
+                    ss << ")";
+                }
+            }
+            ss << std::endl;
+            if (!backtrace) {
+                continue;
+            }
+            if (f->m_createDepth) {
+                ss << "    created at:" << std::endl;
+                AppendFrames(ss, f->m_createSite, f->m_createDepth);
+            }
+            void* frames[MAX_UNWIND_FRAMES];
+            int n = Unwind(f, frames, MAX_UNWIND_FRAMES);
+            if (n) {
+                ss << "    parked at:" << std::endl;
+                AppendFrames(ss, frames, n);
+            }
+        }
+        return ss.str();
+    }
+
+    static void OnDumpSignal(int) {
+        int saved = errno;
+        RegistryData& data = GetData();
+        char c = 0;
+        // 信号可能落在开启 hook 的调度线程上，直接用原始 write
+        (void)write_f(data.pipe[1], &c, 1);
+        errno = saved;
+    }
+
+    static void DumpThreadRun() {
+        RegistryData& data = GetData();
+        char buf[16];
+        while (read_f(data.pipe[0], buf, sizeof(buf)) > 0 || errno == EINTR) {
+            std::function<void(const std::string&)> out;
+            {
+                Mutex::Lock lock(data.mutex);
+                out = data.out;
+            }
+            std::string dump = FiberRegistry::Dump(true);
+            if (out) {
+                out(dump);
+            } else {
+                LOG_INFO(g_logger) << "fiber dump" << std::endl << dump;
+            }
+        }
+    }
+
+    void FiberRegistry::InstallDumpSignal(int signo, std::function<void(const std::string&)> out) {
+        RegistryData& data = GetData();
+        {
+            Mutex::Lock lock(data.mutex);
+            data.out = std::move(out);
+            // 调度线程上 hook 的 pipe 会设为非阻塞，转储线程读到 EAGAIN 就会退出，这里用原始调用
+            if (data.pipe[0] == -1) {
+                if (pipe2_f(data.pipe, O_CLOEXEC)) {
+                    LOG_ERROR(g_logger) << "fiber dump pipe error errno=" << errno;
+                    data.pipe[0] = data.pipe[1] = -1;
+                    return;
+                }
+                // 只有写端非阻塞，信号处理函数不会因管道写满而卡住
+                fcntl_f(data.pipe[1], F_SETFL, fcntl_f(data.pipe[1], F_GETFL) | O_NONBLOCK);
+            }
+            if (!data.dumpThread) {
+                data.dumpThread.reset(new Thread(&DumpThreadRun, "fiber_dump"));
+            }
+        }
+        struct sigaction sa = {};
+        sa.sa_handler = OnDumpSignal;
+        sa.sa_flags = SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+        sigaction(signo, &sa, nullptr);
+    }
+}
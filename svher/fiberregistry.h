@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <functional>
+#include "util.h"
+
+namespace svher {
+
+    class Fiber;
+    class Scheduler;
+
+    // 存活协程登记表，由配置 fiber.registry 开启，开启后新建的协程挂入侵入式链表
+    // 记录创建位置、状态、所在调度器、最近一次执行时间与等待原因，
+    // 挂起的协程可从保存的上下文沿帧指针回溯调用栈
+    class FiberRegistry {
+    public:
+        static bool IsEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+        static void SetEnabled(bool v) { s_enabled = v; }
+
+        // 由 Fiber 构造、析构时调用
+        static void Add(Fiber* fiber);
+        static void Del(Fiber* fiber);
+        // 由 Scheduler 构造、析构时调用，用于输出调度器名称
+        static void AddScheduler(Scheduler* scheduler);
+        static void DelScheduler(Scheduler* scheduler);
+
+        static size_t GetCount();
+        // 所有已登记协程的诊断信息，backtrace 为 true 时附带挂起协程的调用栈
+        // 可直接作为管理接口的响应内容
+        static std::string Dump(bool backtrace = true);
+        // 从协程保存的上下文回溯调用栈 (需帧指针，仅 x86_64)，返回帧数
+        // 正在执行或尚未执行的协程返回 0
+        static int Unwind(Fiber* fiber, void** frames, int max);
+
+        // 收到 signo 时由后台线程执行 Dump，out 为空时写日志
+        static void InstallDumpSignal(int signo, std::function<void(const std::string&)> out = nullptr);
+    private:
+        static std::atomic<bool> s_enabled;
+    };
+}
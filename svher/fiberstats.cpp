@@ -0,0 +1,114 @@
+#include "fiberstats.h"
+#include "config.h"
+#include "thread.h"
+#include <sstream>
+
+namespace svher {
+
+    static ConfigVar<bool>::ptr g_fiber_stats =
+            Config::Lookup<bool>("fiber.stats", false, "record fiber cpu time and scheduling latency");
+
+    std::atomic<bool> FiberStats::s_enabled{false};
+    const uint32_t FiberStats::MAX_TAGS;
+
+    static SchedStats s_tag_stats[FiberStats::MAX_TAGS];
+    static std::string s_tag_names[FiberStats::MAX_TAGS] = {"default"};
+    static std::atomic<uint32_t> s_tag_count{1};
+
+    static Mutex& GetTagMutex() {
+        static Mutex s_mutex;
+        return s_mutex;
+    }
+
+    struct FiberStatsIniter {
+        FiberStatsIniter() {
+            FiberStats::SetEnabled(g_fiber_stats->getValue());
+            g_fiber_stats->addListener([](const bool& old_value, const bool& new_value) {
+                FiberStats::SetEnabled(new_value);
+            });
+        }
+    };
+
+    static FiberStatsIniter s_initer;
+
+    std::string SchedStatsSnapshot::toString() const {
+        std::stringstream ss;
+        ss << "switches=" << switches
+           << " cpu=" << cpuTime / 1000 << "us"
+           << " waits=" << waits
+           << " avg_wait=" << (waits ? waitTime / waits / 1000 : 0) << "us"
+           << " max_wait=" << maxWait / 1000 << "us";
+        return ss.str();
+    }
+
+    void SchedStats::addWait(uint64_t ns) {
+        m_waits.fetch_add(1, std::memory_order_relaxed);
+        m_waitTime.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t old = m_maxWait.load(std::memory_order_relaxed);
+        while (ns > old && !m_maxWait.compare_exchange_weak(old, ns, std::memory_order_relaxed));
+    }
+
+    SchedStatsSnapshot SchedStats::snapshot() const {
+        SchedStatsSnapshot rt;
+        rt.switches = m_switches.load(std::memory_order_relaxed);
+        rt.cpuTime = m_cpuTime.load(std::memory_order_relaxed);
+        rt.waits = m_waits.load(std::memory_order_relaxed);
+        rt.waitTime = m_waitTime.load(std::memory_order_relaxed);
+        rt.maxWait = m_maxWait.load(std::memory_order_relaxed);
+        return rt;
+    }
+
+    void SchedStats::clear() {
+        m_switches = 0;
+        m_cpuTime = 0;
+        m_waits = 0;
+        m_waitTime = 0;
+        m_maxWait = 0;
+    }
+
+    uint32_t FiberStats::RegisterTag(const std::string& name) {
+        Mutex::Lock lock(GetTagMutex());
+        uint32_t count = s_tag_count;
+        for (uint32_t i = 0; i < count; ++i) {
+            if (s_tag_names[i] == name) {
+                return i;
+            }
+        }
+        if (count >= MAX_TAGS) {
+            return 0;
+        }
+        s_tag_names[count] = name;
+        s_tag_count = count + 1;
+        return count;
+    }
+
+    std::string FiberStats::GetTagName(uint32_t tag) {
+        Mutex::Lock lock(GetTagMutex());
+        return tag < s_tag_count ? s_tag_names[tag] : "";
+    }
+
+    uint32_t FiberStats::GetTagCount() {
+        return s_tag_count;
+    }
+
+    SchedStatsSnapshot FiberStats::GetTagStats(uint32_t tag) {
+        return tag < MAX_TAGS ? s_tag_stats[tag].snapshot() : SchedStatsSnapshot();
+    }
+
+    void FiberStats::AddSlice(uint32_t tag, uint64_t ns) {
+        s_tag_stats[tag < MAX_TAGS ? tag : 0].addSlice(ns);
+    }
+
+    void FiberStats::AddWait(uint32_t tag, uint64_t ns) {
+        s_tag_stats[tag < MAX_TAGS ? tag : 0].addWait(ns);
+    }
+
+    std::string FiberStats::Dump() {
+        std::stringstream ss;
+        uint32_t count = GetTagCount();
+        for (uint32_t i = 0; i < count; ++i) {
+            ss << GetTagName(i) << ": " << GetTagStats(i).toString() << std::endl;
+        }
+        return ss.str();
+    }
+}
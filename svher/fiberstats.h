@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include "util.h"
+
+namespace svher {
+
+    // 调度统计的一次快照，时间单位为纳秒
+    struct SchedStatsSnapshot {
+        uint64_t switches = 0;
+        uint64_t cpuTime = 0;
+        uint64_t waits = 0;
+        uint64_t waitTime = 0;
+        uint64_t maxWait = 0;
+        std::string toString() const;
+    };
+
+    // 累计的调度统计: 上 CPU 次数与时长、入队到开始执行的等待时长
+    class SchedStats {
+    public:
+        void addSlice(uint64_t ns) {
+            m_switches.fetch_add(1, std::memory_order_relaxed);
+            m_cpuTime.fetch_add(ns, std::memory_order_relaxed);
+        }
+        void addWait(uint64_t ns);
+        SchedStatsSnapshot snapshot() const;
+        void clear();
+    private:
+        std::atomic<uint64_t> m_switches{0};
+        std::atomic<uint64_t> m_cpuTime{0};
+        std::atomic<uint64_t> m_waits{0};
+        std::atomic<uint64_t> m_waitTime{0};
+        std::atomic<uint64_t> m_maxWait{0};
+    };
+
+    // 协程调度统计，由配置 fiber.stats 开启
+    // 按调度器汇总见 Scheduler::getStats，按用户标签汇总见 GetTagStats
+    class FiberStats {
+    public:
+        // 标签数量上限，0 号为默认标签
+        static const uint32_t MAX_TAGS = 32;
+        static bool IsEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+        static void SetEnabled(bool v) { s_enabled = v; }
+        // 同名标签返回同一个 id，超过上限时返回 0
+        static uint32_t RegisterTag(const std::string& name);
+        static std::string GetTagName(uint32_t tag);
+        static uint32_t GetTagCount();
+        static SchedStatsSnapshot GetTagStats(uint32_t tag);
+        static void AddSlice(uint32_t tag, uint64_t ns);
+        static void AddWait(uint32_t tag, uint64_t ns);
+        // 所有标签的统计，每行一个
+        static std::string Dump();
+    private:
+        static std::atomic<bool> s_enabled;
+    };
+}
@@ -0,0 +1,311 @@
+#include "fibersync.h"
+#include "scheduler.h"
+#include "iomanager.h"
+#include "deadline.h"
+
+namespace svher {
+
+    FiberWaiter::FiberWaiter(const char* what)
+        : m_what(what) {
+        Scheduler* scheduler = Scheduler::GetThis();
+        if (scheduler && Fiber::GetThisRaw() != Scheduler::GetMainFiber()) {
+            m_scheduler = scheduler;
+            m_fiber = Fiber::GetThis();
+            // 挂起期间调度器不能退出
+            m_scheduler->addExternalWait();
+        }
+    }
+
+    void FiberWaiter::wait() {
+        FiberWaitScope scope(m_what);
+        if (m_scheduler) {
+            Fiber::YieldToHold();
+        } else {
+            m_sem.wait();
+        }
+    }
+
+    int FiberWaiter::waitInterruptible() {
+        FiberWaitScope scope(m_what);
+        int err = FiberDeadline::Check();
+        if (!m_scheduler) {
+            int expected = 0;
+            if (err && m_state.compare_exchange_strong(expected, 2)) {
+                return err;
+            }
+            m_sem.wait();
+            return 0;
+        }
+        if (err) {
+            int expected = 0;
+            if (m_state.compare_exchange_strong(expected, 2)) {
+                m_fiber.reset();
+                m_scheduler->delExternalWait();
+                return err;
+            }
+            // 已经被 notify 调度，让出一次把这次调度消耗掉
+            Fiber::YieldToHold();
+            return 0;
+        }
+        uint64_t remain = FiberDeadline::Remaining();
+        CancelToken::ptr token = FiberDeadline::GetCancelToken();
+        IOManager* iom = IOManager::GetThis();
+        Timer::ptr timer;
+        uint64_t cb_id = 0;
+        FiberWaiter::ptr self = shared_from_this();
+        if (remain != FiberDeadline::NONE && iom) {
+            timer = iom->addTimer(remain, [self]() {
+                self->wake(2, ETIMEDOUT);
+            });
+        }
+        if (token) {
+            cb_id = token->addCallback([self]() {
+                self->wake(2, ECANCELED);
+            });
+        }
+        Fiber::YieldToHold();
+        if (timer) {
+            timer->cancel();
+        }
+        if (token) {
+            token->delCallback(cb_id);
+        }
+        return m_state == 1 ? 0 : m_error;
+    }
+
+    bool FiberWaiter::notify() {
+        if (m_scheduler) {
+            return wake(1);
+        }
+        int expected = 0;
+        if (!m_state.compare_exchange_strong(expected, 1)) {
+            return false;
+        }
+        m_sem.notify();
+        return true;
+    }
+
+    bool FiberWaiter::cancel() {
+        int expected = 0;
+        if (m_state.compare_exchange_strong(expected, 2)) {
+            if (m_scheduler) {
+                m_fiber.reset();
+                m_scheduler->delExternalWait();
+            }
+            return true;
+        }
+        // 唤醒方已经 schedule 了当前协程，让出一次把这次调度消耗掉
+        if (m_scheduler) {
+            Fiber::YieldToHold();
+        } else {
+            m_sem.wait();
+        }
+        return false;
+    }
+
+    bool FiberWaiter::wake(int state, int error) {
+        int expected = 0;
+        if (!m_state.compare_exchange_strong(expected, state)) {
+            return false;
+        }
+        m_error = error;
+        Fiber::ptr fiber;
+        fiber.swap(m_fiber);
+        m_scheduler->schedule(fiber);
+        m_scheduler->delExternalWait();
+        return true;
+    }
+
+    void FiberMutex::lock() {
+        int expected = 0;
+        if (m_state.compare_exchange_strong(expected, 1, std::memory_order_acquire)) {
+            return;
+        }
+        FiberWaiter::ptr waiter;
+        {
+            Spinlock::Lock lock(m_lock);
+            if (m_state.exchange(2, std::memory_order_acquire) == 0) {
+                return;
+            }
+            waiter.reset(new FiberWaiter("mutex"));
+            m_waiters.push_back(waiter);
+        }
+        // 被唤醒时锁已经交到手上
+        waiter->wait();
+    }
+
+    bool FiberMutex::tryLock() {
+        int expected = 0;
+        return m_state.compare_exchange_strong(expected, 1, std::memory_order_acquire);
+    }
+
+    void FiberMutex::unlock() {
+        int expected = 1;
+        if (m_state.compare_exchange_strong(expected, 0, std::memory_order_release)) {
+            return;
+        }
+        FiberWaiter::ptr waiter;
+        {
+            Spinlock::Lock lock(m_lock);
+            if (m_waiters.empty()) {
+                m_state.store(0, std::memory_order_release);
+                return;
+            }
+            waiter = m_waiters.front();
+            m_waiters.pop_front();
+            if (m_waiters.empty()) {
+                m_state.store(1, std::memory_order_release);
+            }
+        }
+        waiter->notify();
+    }
+
+    void FiberRWMutex::rdlock() {
+        FiberWaiter::ptr waiter;
+        {
+            Spinlock::Lock lock(m_lock);
+            if (!m_writer && m_writeWaiters.empty()) {
+                ++m_readers;
+                return;
+            }
+            waiter.reset(new FiberWaiter("rwmutex"));
+            m_readWaiters.push_back(waiter);
+        }
+        waiter->wait();
+    }
+
+    void FiberRWMutex::wrlock() {
+        FiberWaiter::ptr waiter;
+        {
+            Spinlock::Lock lock(m_lock);
+            if (!m_writer && m_readers == 0) {
+                m_writer = true;
+                return;
+            }
+            waiter.reset(new FiberWaiter("rwmutex"));
+            m_writeWaiters.push_back(waiter);
+        }
+        waiter->wait();
+    }
+
+    void FiberRWMutex::unlock() {
+        std::list<FiberWaiter::ptr> waiters;
+        {
+            Spinlock::Lock lock(m_lock);
+            bool was_writer = m_writer;
+            if (m_writer) {
+                m_writer = false;
+            } else {
+                --m_readers;
+            }
+            if (m_readers) {
+                return;
+            }
+            // 写者释放时先放行排队的读者，读者释放完后放行写者
+            if (!m_readWaiters.empty() && (was_writer || m_writeWaiters.empty())) {
+                m_readers = m_readWaiters.size();
+                waiters.swap(m_readWaiters);
+            } else if (!m_writeWaiters.empty()) {
+                m_writer = true;
+                waiters.push_back(m_writeWaiters.front());
+                m_writeWaiters.pop_front();
+            }
+        }
+        for (auto& i : waiters) {
+            i->notify();
+        }
+    }
+
+    bool FiberSemaphore::wait() {
+        if (tryWait()) {
+            return true;
+        }
+        FiberWaiter::ptr waiter;
+        {
+            Spinlock::Lock lock(m_lock);
+            if (tryWait()) {
+                return true;
+            }
+            waiter.reset(new FiberWaiter("semaphore"));
+            m_waiters.push_back(waiter);
+        }
+        // 被唤醒时名额已经交到手上
+        int err = waiter->waitInterruptible();
+        if (err) {
+            Spinlock::Lock lock(m_lock);
+            m_waiters.remove(waiter);
+            errno = err;
+            return false;
+        }
+        return true;
+    }
+
+    bool FiberSemaphore::tryWait() {
+        uint32_t count = m_count.load(std::memory_order_relaxed);
+        while (count > 0) {
+            if (m_count.compare_exchange_weak(count, count - 1, std::memory_order_acquire)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void FiberSemaphore::notify() {
+        while (true) {
+            FiberWaiter::ptr waiter;
+            {
+                Spinlock::Lock lock(m_lock);
+                if (m_waiters.empty()) {
+                    m_count.fetch_add(1, std::memory_order_release);
+                    return;
+                }
+                waiter = m_waiters.front();
+                m_waiters.pop_front();
+            }
+            // 等待者已超时放弃则把名额交给下一个
+            if (waiter->notify()) {
+                return;
+            }
+        }
+    }
+
+    FiberWaiter::ptr FiberCondVar::enqueue() {
+        FiberWaiter::ptr waiter(new FiberWaiter("condvar"));
+        Spinlock::Lock lock(m_lock);
+        m_waiters.push_back(waiter);
+        return waiter;
+    }
+
+    void FiberCondVar::dequeue(const FiberWaiter::ptr& waiter) {
+        Spinlock::Lock lock(m_lock);
+        m_waiters.remove(waiter);
+    }
+
+    void FiberCondVar::notify() {
+        while (true) {
+            FiberWaiter::ptr waiter;
+            {
+                Spinlock::Lock lock(m_lock);
+                if (m_waiters.empty()) {
+                    return;
+                }
+                waiter = m_waiters.front();
+                m_waiters.pop_front();
+            }
+            if (waiter->notify()) {
+                return;
+            }
+        }
+    }
+
+    void FiberCondVar::notifyAll() {
+        std::list<FiberWaiter::ptr> waiters;
+        {
+            Spinlock::Lock lock(m_lock);
+            waiters.swap(m_waiters);
+        }
+        for (auto& i : waiters) {
+            i->notify();
+        }
+    }
+}
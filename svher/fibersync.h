@@ -0,0 +1,116 @@
+#pragma once
+
+#include <memory>
+#include <list>
+#include <atomic>
+#include <cerrno>
+#include "thread.h"
+#include "fiber.h"
+#include "util.h"
+
+namespace svher {
+
+    class Scheduler;
+
+    // 一个被挂起的执行者: 协程挂起后由 Scheduler 重新调度，普通线程阻塞在信号量上
+    class FiberWaiter : public std::enable_shared_from_this<FiberWaiter>, Noncopyable {
+    public:
+        typedef std::shared_ptr<FiberWaiter> ptr;
+        // 记录当前执行者，必须在将要等待的协程/线程中构造
+        // what 为等待原因，见 FiberWaitScope
+        explicit FiberWaiter(const char* what = "sync");
+        void wait();
+        // 同 wait，但协程的截止时间到达或被取消时放弃等待，返回 ETIMEDOUT/ECANCELED，
+        // 被 notify 唤醒返回 0；普通线程中只在等待前检查
+        int waitInterruptible();
+        // 等待者已放弃时返回 false，调用方应改为唤醒下一个
+        bool notify();
+        // 放弃尚未开始的等待，返回 true；已被 notify 时消耗掉那次唤醒并返回 false
+        bool cancel();
+    private:
+        // 抢到唤醒权的一方负责重新调度协程
+        bool wake(int state, int error = 0);
+
+        const char* m_what;
+        Scheduler* m_scheduler = nullptr;
+        Fiber::ptr m_fiber;
+        Semaphore m_sem;
+        // 0 等待中, 1 已被 notify, 2 已放弃
+        std::atomic<int> m_state{0};
+        int m_error = 0;
+    };
+
+    // 以下同步原语只挂起当前协程，不阻塞线程；在普通线程中调用则退化为阻塞线程
+    // 内部队列由 Spinlock 保护，无竞争时不进入内核
+    // 锁不响应截止时间；信号量、条件变量的等待在截止时间到达或被取消时返回 false，errno 为原因
+
+    class FiberMutex : Noncopyable {
+    public:
+        typedef ScopedLockImpl<FiberMutex> Lock;
+        void lock();
+        bool tryLock();
+        // 有等待者时直接把锁交给队首，保证 FIFO
+        void unlock();
+    private:
+        // 0 未加锁, 1 已加锁且无等待者, 2 已加锁且可能有等待者
+        std::atomic<int> m_state{0};
+        Spinlock m_lock;
+        std::list<FiberWaiter::ptr> m_waiters;
+    };
+
+    // 写优先: 有写者等待时新的读者排队；写者释放时优先唤醒全部等待的读者，避免读者饿死
+    class FiberRWMutex : Noncopyable {
+    public:
+        typedef ReadScopedLockImpl<FiberRWMutex> ReadLock;
+        typedef WriteScopedLockImpl<FiberRWMutex> WriteLock;
+        void rdlock();
+        void wrlock();
+        void unlock();
+    private:
+        Spinlock m_lock;
+        uint32_t m_readers = 0;
+        bool m_writer = false;
+        std::list<FiberWaiter::ptr> m_readWaiters;
+        std::list<FiberWaiter::ptr> m_writeWaiters;
+    };
+
+    class FiberSemaphore : Noncopyable {
+    public:
+        explicit FiberSemaphore(uint32_t count = 0) : m_count(count) {}
+        bool wait();
+        bool tryWait();
+        void notify();
+        uint32_t getCount() const { return m_count; }
+    private:
+        std::atomic<uint32_t> m_count;
+        Spinlock m_lock;
+        std::list<FiberWaiter::ptr> m_waiters;
+    };
+
+    class FiberCondVar : Noncopyable {
+    public:
+        // lock 为持有 FiberMutex 的 ScopedLockImpl，返回时重新持有
+        template<class LockType>
+        bool wait(LockType& lock) {
+            FiberWaiter::ptr waiter = enqueue();
+            lock.unlock();
+            int err = waiter->waitInterruptible();
+            if (err) {
+                dequeue(waiter);
+            }
+            lock.lock();
+            if (err) {
+                errno = err;
+                return false;
+            }
+            return true;
+        }
+        void notify();
+        void notifyAll();
+    private:
+        FiberWaiter::ptr enqueue();
+        void dequeue(const FiberWaiter::ptr& waiter);
+        Spinlock m_lock;
+        std::list<FiberWaiter::ptr> m_waiters;
+    };
+}
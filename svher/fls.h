@@ -0,0 +1,39 @@
+#pragma once
+
+#include <utility>
+#include "fiber.h"
+#include "util.h"
+
+namespace svher {
+
+    // 协程局部存储，值保存在 Fiber 内联的槽位中，访问无需查表
+    // 槽位在构造时分配且不回收，应定义为静态或全局对象
+    // 协程结束或被 reset 复用时自动析构；在普通线程中使用时绑定到线程主协程
+    template<class T>
+    class FLS : Noncopyable {
+    public:
+        FLS() : m_slot(Fiber::AllocLocalSlot(&FLS::Destroy)) {}
+
+        // 首次访问时默认构造
+        T& get() {
+            void* p = Fiber::GetLocal(m_slot);
+            if (!p) {
+                p = new T();
+                Fiber::SetLocal(m_slot, p);
+            }
+            return *(T*)p;
+        }
+        // 未设置时返回 nullptr
+        T* tryGet() const { return (T*)Fiber::GetLocal(m_slot); }
+        void set(T v) { Fiber::SetLocal(m_slot, new T(std::move(v))); }
+        void reset() { Fiber::SetLocal(m_slot, nullptr); }
+
+        T& operator*() { return get(); }
+        T* operator->() { return &get(); }
+        size_t getSlot() const { return m_slot; }
+    private:
+        static void Destroy(void* p) { delete (T*)p; }
+    private:
+        size_t m_slot;
+    };
+}
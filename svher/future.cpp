@@ -0,0 +1,75 @@
+#include "future.h"
+
+namespace svher {
+
+    bool FutureStateBase::isReady() {
+        Spinlock::Lock lock(m_mutex);
+        return m_ready;
+    }
+
+    bool FutureStateBase::wait() {
+        FiberWaiter::ptr waiter;
+        {
+            Spinlock::Lock lock(m_mutex);
+            if (m_ready) {
+                return true;
+            }
+            waiter.reset(new FiberWaiter("future"));
+            m_waiters.push_back(waiter);
+        }
+        int err = waiter->waitInterruptible();
+        if (err) {
+            Spinlock::Lock lock(m_mutex);
+            m_waiters.remove(waiter);
+            errno = err;
+            return false;
+        }
+        return true;
+    }
+
+    void FutureStateBase::waitOrThrow() {
+        if (!wait()) {
+            throw std::system_error(errno, std::generic_category(), "future wait");
+        }
+    }
+
+    void FutureStateBase::onReady(std::function<void()> cb) {
+        {
+            Spinlock::Lock lock(m_mutex);
+            if (!m_ready) {
+                m_callbacks.push_back(std::move(cb));
+                return;
+            }
+        }
+        cb();
+    }
+
+    void FutureStateBase::setException(std::exception_ptr error) {
+        Spinlock::Lock lock(m_mutex);
+        if (m_ready) {
+            throw std::logic_error("promise already satisfied");
+        }
+        m_error = error;
+        markReady(lock);
+    }
+
+    std::exception_ptr FutureStateBase::getException() {
+        Spinlock::Lock lock(m_mutex);
+        return m_error;
+    }
+
+    void FutureStateBase::markReady(Spinlock::Lock &lock) {
+        m_ready = true;
+        std::list<FiberWaiter::ptr> waiters;
+        std::list<std::function<void()>> callbacks;
+        waiters.swap(m_waiters);
+        callbacks.swap(m_callbacks);
+        lock.unlock();
+        for (auto& i : waiters) {
+            i->notify();
+        }
+        for (auto& i : callbacks) {
+            i();
+        }
+    }
+}
@@ -0,0 +1,271 @@
+#pragma once
+
+#include <memory>
+#include <list>
+#include <vector>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+#include <system_error>
+#include <cerrno>
+#include <functional>
+#include "fibersync.h"
+#include "deadline.h"
+#include "scheduler.h"
+#include "thread.h"
+
+namespace svher {
+
+    // Future/Promise 共享状态中与值类型无关的部分
+    class FutureStateBase : Noncopyable {
+    public:
+        bool isReady();
+        // 挂起当前协程 (普通线程中则阻塞) 直到结果就绪
+        // 协程截止时间到达或被取消时返回 false，errno 为 ETIMEDOUT/ECANCELED
+        bool wait();
+        // 同 wait，被打断时抛出 std::system_error
+        void waitOrThrow();
+        // 结果就绪后调用 cb (已就绪则立即在当前上下文调用)
+        void onReady(std::function<void()> cb);
+        void setException(std::exception_ptr error);
+        std::exception_ptr getException();
+    protected:
+        // 在 m_mutex 保护下写入结果后调用，唤醒等待者与回调
+        void markReady(Spinlock::Lock& lock);
+        Spinlock m_mutex;
+        bool m_ready = false;
+        std::exception_ptr m_error;
+        std::list<FiberWaiter::ptr> m_waiters;
+        std::list<std::function<void()>> m_callbacks;
+    };
+
+    template<class T>
+    class FutureState : public FutureStateBase {
+    public:
+        typedef std::shared_ptr<FutureState> ptr;
+        void setValue(T v) {
+            Spinlock::Lock lock(m_mutex);
+            if (m_ready) {
+                throw std::logic_error("promise already satisfied");
+            }
+            m_value.reset(new T(std::move(v)));
+            markReady(lock);
+        }
+        T get() {
+            waitOrThrow();
+            if (m_error) std::rethrow_exception(m_error);
+            return *m_value;
+        }
+    private:
+        std::unique_ptr<T> m_value;
+    };
+
+    template<>
+    class FutureState<void> : public FutureStateBase {
+    public:
+        typedef std::shared_ptr<FutureState> ptr;
+        void setValue() {
+            Spinlock::Lock lock(m_mutex);
+            if (m_ready) {
+                throw std::logic_error("promise already satisfied");
+            }
+            markReady(lock);
+        }
+        void get() {
+            waitOrThrow();
+            if (m_error) std::rethrow_exception(m_error);
+        }
+    };
+
+    // 可拷贝，多个持有者可以同时 get
+    template<class T>
+    class Future {
+    public:
+        typedef typename FutureState<T>::ptr StatePtr;
+        Future() = default;
+        explicit Future(StatePtr state) : m_state(std::move(state)) {}
+
+        bool valid() const { return (bool)m_state; }
+        bool isReady() const { return m_state->isReady(); }
+        bool wait() const { return m_state->wait(); }
+        // 等待结果，异常在调用方重新抛出；等待被截止时间/取消打断时抛出 std::system_error
+        T get() const { return m_state->get(); }
+        void onReady(std::function<void()> cb) const { m_state->onReady(std::move(cb)); }
+        std::exception_ptr getException() const { return m_state->getException(); }
+        const StatePtr& getState() const { return m_state; }
+    private:
+        StatePtr m_state;
+    };
+
+    template<class T>
+    class Promise {
+    public:
+        Promise() : m_state(std::make_shared<FutureState<T>>()) {}
+        Future<T> getFuture() const { return Future<T>(m_state); }
+        void setValue(T v) const { m_state->setValue(std::move(v)); }
+        void setException(std::exception_ptr error) const { m_state->setException(error); }
+    private:
+        typename FutureState<T>::ptr m_state;
+    };
+
+    template<>
+    class Promise<void> {
+    public:
+        Promise() : m_state(std::make_shared<FutureState<void>>()) {}
+        Future<void> getFuture() const { return Future<void>(m_state); }
+        void setValue() const { m_state->setValue(); }
+        void setException(std::exception_ptr error) const { m_state->setException(error); }
+    private:
+        FutureState<void>::ptr m_state;
+    };
+
+    namespace detail {
+        template<class R>
+        struct PromiseSetter {
+            template<class F>
+            static void Set(const Promise<R>& promise, F& fn) {
+                promise.setValue(fn());
+            }
+        };
+
+        template<>
+        struct PromiseSetter<void> {
+            template<class F>
+            static void Set(const Promise<void>& promise, F& fn) {
+                fn();
+                promise.setValue();
+            }
+        };
+    }
+
+    // 在 scheduler 上以新协程执行 fn，返回其结果的 Future
+    template<class F>
+    auto async(Scheduler* scheduler, F fn) -> Future<decltype(fn())> {
+        typedef decltype(fn()) R;
+        Promise<R> promise;
+        Future<R> future = promise.getFuture();
+        // 子任务继承发起者的截止时间与取消令牌
+        uint64_t deadline = FiberDeadline::Get();
+        CancelToken::ptr token = FiberDeadline::GetCancelToken();
+        scheduler->schedule(std::function<void()>([promise, fn, deadline, token]() mutable {
+            if (deadline != FiberDeadline::NONE || token) {
+                FiberDeadline::Set(deadline);
+                FiberDeadline::SetCancelToken(token);
+            }
+            try {
+                detail::PromiseSetter<R>::Set(promise, fn);
+            } catch (...) {
+                promise.setException(std::current_exception());
+            }
+        }));
+        return future;
+    }
+
+    namespace detail {
+        // when_all 的汇总状态，只由各输入的回调持有
+        // 回调对输入只持弱引用，某个输入永不完成时不会经回调列表形成循环引用
+        template<class T>
+        struct WhenAllContext {
+            explicit WhenAllContext(size_t n) : left(n), values(n), errors(n) {}
+            Promise<std::vector<T>> promise;
+            std::atomic<size_t> left;
+            // 每个回调只写自己的下标，最后一个完成的回调汇总
+            std::vector<std::unique_ptr<T>> values;
+            std::vector<std::exception_ptr> errors;
+        };
+
+        template<>
+        struct WhenAllContext<void> {
+            explicit WhenAllContext(size_t n) : left(n), errors(n) {}
+            Promise<void> promise;
+            std::atomic<size_t> left;
+            std::vector<std::exception_ptr> errors;
+        };
+
+        // 按输入顺序返回第一个异常
+        inline std::exception_ptr FirstError(const std::vector<std::exception_ptr>& errors) {
+            for (auto& i : errors) {
+                if (i) return i;
+            }
+            return nullptr;
+        }
+    }
+
+    // 全部完成后就绪，结果按输入顺序排列；任一失败则以第一个异常结束
+    template<class T>
+    Future<std::vector<T>> when_all(const std::vector<Future<T>>& futures) {
+        auto ctx = std::make_shared<detail::WhenAllContext<T>>(futures.size());
+        Future<std::vector<T>> future = ctx->promise.getFuture();
+        if (futures.empty()) {
+            ctx->promise.setValue(std::vector<T>());
+            return future;
+        }
+        for (size_t i = 0; i < futures.size(); ++i) {
+            std::weak_ptr<FutureState<T>> weak(futures[i].getState());
+            futures[i].onReady([ctx, weak, i]() {
+                // 回调由该输入的状态触发，此时必然存活
+                auto state = weak.lock();
+                ctx->errors[i] = state->getException();
+                if (!ctx->errors[i]) {
+                    ctx->values[i].reset(new T(state->get()));
+                }
+                if (--ctx->left) return;
+                std::exception_ptr error = detail::FirstError(ctx->errors);
+                if (error) {
+                    ctx->promise.setException(error);
+                    return;
+                }
+                std::vector<T> values;
+                values.reserve(ctx->values.size());
+                for (auto& v : ctx->values) {
+                    values.push_back(std::move(*v));
+                }
+                ctx->promise.setValue(std::move(values));
+            });
+        }
+        return future;
+    }
+
+    inline Future<void> when_all(const std::vector<Future<void>>& futures) {
+        auto ctx = std::make_shared<detail::WhenAllContext<void>>(futures.size());
+        Future<void> future = ctx->promise.getFuture();
+        if (futures.empty()) {
+            ctx->promise.setValue();
+            return future;
+        }
+        for (size_t i = 0; i < futures.size(); ++i) {
+            std::weak_ptr<FutureState<void>> weak(futures[i].getState());
+            futures[i].onReady([ctx, weak, i]() {
+                ctx->errors[i] = weak.lock()->getException();
+                if (--ctx->left) return;
+                std::exception_ptr error = detail::FirstError(ctx->errors);
+                if (error) {
+                    ctx->promise.setException(error);
+                    return;
+                }
+                ctx->promise.setValue();
+            });
+        }
+        return future;
+    }
+
+    // 任一完成 (包括失败) 即就绪，值为其下标
+    template<class T>
+    Future<size_t> when_any(const std::vector<Future<T>>& futures) {
+        Promise<size_t> promise;
+        Future<size_t> future = promise.getFuture();
+        if (futures.empty()) {
+            promise.setException(std::make_exception_ptr(std::invalid_argument("when_any of nothing")));
+            return future;
+        }
+        auto fired = std::make_shared<std::atomic<bool>>(false);
+        for (size_t i = 0; i < futures.size(); ++i) {
+            futures[i].onReady([promise, fired, i]() {
+                if (!fired->exchange(true)) {
+                    promise.setValue(i);
+                }
+            });
+        }
+        return future;
+    }
+}
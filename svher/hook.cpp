@@ -1,13 +1,20 @@
 #include <dlfcn.h>
 #include <cerrno>
 #include <fcntl.h>
+#include <climits>
+#include <map>
+#include <algorithm>
 #include <sys/ioctl.h>
+#include <sys/sendfile.h>
 #include "hook.h"
 #include "fdmanager.h"
 #include "iomanager.h"
 #include "fiber.h"
 #include "log.h"
 #include "config.h"
+#include "offload.h"
+#include "deadline.h"
+#include "watchdog.h"
 
 namespace svher {
 
@@ -20,16 +27,34 @@ namespace svher {
     XX(socket) \
     XX(connect) \
     XX(accept) \
+    XX(accept4) \
+    XX(socketpair) \
+    XX(pipe) \
+    XX(pipe2) \
+    XX(dup) \
+    XX(dup2) \
+    XX(dup3) \
     XX(read) \
     XX(readv) \
+    XX(pread) \
     XX(recv) \
     XX(recvfrom) \
     XX(recvmsg) \
+    XX(recvmmsg) \
     XX(write) \
     XX(writev) \
+    XX(pwrite) \
     XX(send) \
     XX(sendto) \
     XX(sendmsg) \
+    XX(sendmmsg) \
+    XX(sendfile) \
+    XX(splice) \
+    XX(tee) \
+    XX(poll) \
+    XX(ppoll) \
+    XX(select) \
+    XX(epoll_wait) \
     XX(close) \
     XX(fcntl) \
     XX(ioctl) \
@@ -74,11 +99,106 @@ namespace svher {
     };
 
     struct timer_info {
-        int cancelled = 0;
+        std::atomic<int> cancelled{0};
+        // 只有第一个原因生效
+        bool cancel(int err) {
+            int expected = 0;
+            return cancelled.compare_exchange_strong(expected, err);
+        }
     };
     // 全局变量在 Hook 前被初始化
     static HookIniter s_hook_initer;
 
+    // 挂起当前协程等待 fd 事件，timeout_ms 与协程截止时间取较早者，取消令牌可随时打断
+    // 返回 0 表示事件就绪，ETIMEDOUT/ECANCELED 表示被打断，-1 表示注册事件失败
+    static int wait_fd_event(int fd, IOManager::Event event, uint64_t timeout_ms) {
+        int err = FiberDeadline::Check();
+        if (err) {
+            return err;
+        }
+        timeout_ms = std::min(timeout_ms, FiberDeadline::Remaining());
+        IOManager* ioManager = IOManager::GetThis();
+        std::shared_ptr<timer_info> tinfo(new timer_info);
+        std::weak_ptr<timer_info> winfo(tinfo);
+        Timer::ptr timer;
+        if (timeout_ms != (uint64_t)-1) {
+            timer = ioManager->addConditionalTimer(timeout_ms, [winfo, fd, ioManager, event]() {
+                auto t = winfo.lock();
+                if (!t || !t->cancel(ETIMEDOUT)) return;
+                ioManager->cancelEvent(fd, event);
+            }, winfo);
+        }
+        if (ioManager->addEvent(fd, event)) {
+            if (timer) {
+                timer->cancel();
+            }
+            return -1;
+        }
+        // 事件注册后再挂取消回调，已取消时回调立即撤销刚注册的事件
+        CancelToken::ptr token = FiberDeadline::GetCancelToken();
+        uint64_t cb_id = 0;
+        if (token) {
+            cb_id = token->addCallback([winfo, fd, ioManager, event]() {
+                auto t = winfo.lock();
+                if (!t || !t->cancel(ECANCELED)) return;
+                ioManager->cancelEvent(fd, event);
+            });
+        }
+        {
+            FiberWaitScope scope("fd", fd, event);
+            Fiber::YieldToHold();
+        }
+        if (timer) {
+            timer->cancel();
+        }
+        if (token) {
+            token->delCallback(cb_id);
+        }
+        return tinfo->cancelled;
+    }
+
+    struct sleep_info {
+        std::atomic<bool> fired{false};
+        int error = 0;
+    };
+
+    // 可被协程截止时间与取消打断的睡眠，返回 0、ETIMEDOUT 或 ECANCELED
+    static int sleep_ms(uint64_t ms) {
+        int err = FiberDeadline::Check();
+        if (err) {
+            return err;
+        }
+        uint64_t remain = FiberDeadline::Remaining();
+        Fiber::ptr fiber = Fiber::GetThis();
+        IOManager* iomanager = IOManager::GetThis();
+        std::shared_ptr<sleep_info> info(new sleep_info);
+        // 睡眠时间超过剩余预算时，在截止时间醒来并报告超时
+        int timeout_error = remain < ms ? ETIMEDOUT : 0;
+        Timer::ptr timer = iomanager->addTimer(std::min(ms, remain), [info, iomanager, fiber, timeout_error]() {
+            if (info->fired.exchange(true)) return;
+            info->error = timeout_error;
+            iomanager->schedule(fiber);
+        });
+        CancelToken::ptr token = FiberDeadline::GetCancelToken();
+        uint64_t cb_id = 0;
+        if (token) {
+            cb_id = token->addCallback([info, iomanager, fiber]() {
+                if (info->fired.exchange(true)) return;
+                info->error = ECANCELED;
+                iomanager->schedule(fiber);
+            });
+        }
+        {
+            FiberWaitScope scope("sleep");
+            Fiber::YieldToHold();
+        }
+        timer->cancel();
+        if (token) {
+            token->delCallback(cb_id);
+        }
+        return info->error;
+    }
+
     template<typename OriginFunc, typename ... Args>
     static size_t do_io(int fd, OriginFunc func, const char* hook_func_name,
                         uint32_t event, int timeout_so,
@@ -86,6 +206,8 @@ namespace svher {
         if (!svher::t_hook_enable) {
             return func(fd, std::forward<Args>(args)...);
         }
+        // 看门狗请求抢占时在这里让出
+        svher::PreemptPoint();
 
         FdContext::ptr ctx = svher::FdMgr::GetInstance()->get(fd);
         if (!ctx) {
@@ -95,13 +217,23 @@ namespace svher {
             errno = EBADF;
             return -1;
         }
+        // 普通文件 epoll 等不了，按配置交给线程池执行，当前协程挂起
+        if (ctx->isFile() && Offload::IsFileIOEnabled()) {
+            int err = 0;
+            ssize_t n = Offload::GetInstance()->run([&]() {
+                ssize_t rt = func(fd, std::forward<Args>(args)...);
+                err = errno;
+                return rt;
+            });
+            errno = err;
+            return n;
+        }
         // 由于我们是把同步转异步，所以如果用户主动设置了非阻塞
         // 和我们默认设置的 Nonblock 行为一致，不需要处理
-        if (!ctx->isSocket() || ctx->getUserNonblock()) {
+        if (!ctx->isPollable() || ctx->getUserNonblock()) {
             return func(fd, std::forward<Args>(args)...);
         }
         uint64_t to = ctx->getTimeout(timeout_so);
-        std::shared_ptr<timer_info> tinfo(new timer_info);
         retry:
         // TODO ssize_t?
         ssize_t n = func(fd, std::forward<Args>(args)...);
@@ -110,40 +242,245 @@ namespace svher {
         }
         if (n == -1 && errno == EAGAIN) {
             LOG_DEBUG(g_logger) << "do_io<" << hook_func_name << ">";
-            IOManager* ioManager = IOManager::GetThis();
+            int err = wait_fd_event(fd, (IOManager::Event)event, to);
+            if (err == -1) {
+                LOG_ERROR(g_logger) << hook_func_name << " addEvent("
+                                    << fd << ", " << event << ")";
+                return -1;
+            } else if (err) {
+                errno = err;
+                return -1;
+            }
+            goto retry;
+        }
+        return n;
+    }
+
+    // 换算出的毫秒数超出 int 时截断，避免溢出成负数 (无限等待)
+    static int clamp_timeout_ms(int64_t ms) {
+        return ms > INT_MAX ? INT_MAX : (int)ms;
+    }
+
+    // 无法注册 epoll 事件时的轮询间隔
+    static const uint64_t POLL_RETRY_MS = 10;
+
+    struct poll_info {
+        std::atomic<bool> fired{false};
+        bool timedout = false;
+        bool cancelled = false;
+    };
+
+    // 把 pollfd 上的事件挂到 IOManager 上，任意一个事件就绪或超时后唤醒当前协程，
+    // 唤醒后再用 0 超时的 poll 收集 revents
+    static int do_poll(struct pollfd* fds, nfds_t nfds, int timeout_ms) {
+        int n = poll_f(fds, nfds, 0);
+        if (n != 0 || timeout_ms == 0) {
+            return n;
+        }
+        IOManager* ioManager = IOManager::GetThis();
+        if (!ioManager) {
+            return poll_f(fds, nfds, timeout_ms);
+        }
+        int err = FiberDeadline::Check();
+        if (err) {
+            errno = err;
+            return -1;
+        }
+        uint64_t deadline = timeout_ms < 0 ? -1 : GetCurrentMS() + timeout_ms;
+        // 协程截止时间更早时，到期返回 -1/ETIMEDOUT 而不是 0
+        bool by_context = false;
+        if (FiberDeadline::Get() < deadline) {
+            deadline = FiberDeadline::Get();
+            by_context = true;
+        }
+        CancelToken::ptr token = FiberDeadline::GetCancelToken();
+        // 同一个 fd 可能在数组中出现多次，合并后只注册一次
+        std::map<int, int> events;
+        for (nfds_t i = 0; i < nfds; ++i) {
+            if (fds[i].fd < 0) continue;
+            int ev = IOManager::NONE;
+            if (fds[i].events & (POLLIN | POLLPRI | POLLRDHUP)) ev |= IOManager::READ;
+            if (fds[i].events & POLLOUT) ev |= IOManager::WRITE;
+            events[fds[i].fd] |= ev;
+        }
+        while (true) {
+            uint64_t now = GetCurrentMS();
+            if (deadline != (uint64_t)-1 && now >= deadline) {
+                if (by_context) {
+                    errno = ETIMEDOUT;
+                    return -1;
+                }
+                return 0;
+            }
+            std::shared_ptr<poll_info> info(new poll_info);
+            std::weak_ptr<poll_info> winfo(info);
+            Scheduler* scheduler = Scheduler::GetThis();
+            Fiber::ptr fiber = Fiber::GetThis();
+            auto wakeup = [info, scheduler, fiber]() {
+                if (!info->fired.exchange(true)) {
+                    scheduler->schedule(fiber);
+                }
+            };
+            std::vector<std::pair<int, IOManager::Event>> added;
+            // 其它协程已在同一 fd 的同一事件上等待时 tryAddEvent 失败，不能重复注册
+            bool failed = false;
+            for (auto& i : events) {
+                if (failed) break;
+                for (auto ev : {IOManager::READ, IOManager::WRITE}) {
+                    if (!(i.second & ev)) continue;
+                    if (ioManager->tryAddEvent(i.first, ev, wakeup, info.get())) {
+                        failed = true;
+                        break;
+                    }
+                    added.emplace_back(i.first, ev);
+                }
+            }
+            if (failed) {
+                for (auto& i : added) {
+                    ioManager->delEvent(i.first, i.second, info.get());
+                }
+                added.clear();
+            }
+            // 无法挂到 epoll 上（如事件已被占用或普通文件）时，由定时器驱动短间隔轮询，不阻塞线程
+            bool polling = added.empty();
+            uint64_t wait = deadline == (uint64_t)-1 ? -1 : deadline - now;
+            if (polling && wait > POLL_RETRY_MS) {
+                wait = POLL_RETRY_MS;
+            }
             Timer::ptr timer;
-            std::weak_ptr<timer_info> winfo(tinfo);
-            // 有设置超时
-            if (to != (uint64_t)-1) {
-                timer = ioManager->addConditionalTimer(to, [winfo, fd, ioManager, event]() {
+            if (wait != (uint64_t)-1) {
+                timer = ioManager->addConditionalTimer(wait, [winfo, scheduler, fiber]() {
                     auto t = winfo.lock();
-                    if (!t || t->cancelled) return;
-                    t->cancelled = ETIMEDOUT;
-                    ioManager->cancelEvent(fd, (IOManager::Event)event);
+                    if (!t || t->fired.exchange(true)) return;
+                    t->timedout = true;
+                    scheduler->schedule(fiber);
                 }, winfo);
             }
+            uint64_t cb_id = 0;
+            if (token) {
+                cb_id = token->addCallback([winfo, scheduler, fiber]() {
+                    auto t = winfo.lock();
+                    if (!t || t->fired.exchange(true)) return;
+                    t->cancelled = true;
+                    scheduler->schedule(fiber);
+                });
+            }
+            {
+                FiberWaitScope scope("poll", fds[0].fd, fds[0].events);
+                Fiber::YieldToHold();
+            }
+            if (timer) {
+                timer->cancel();
+            }
+            if (token) {
+                token->delCallback(cb_id);
+            }
+            // 已触发的事件可能已被其它协程重新注册，只撤销仍属于本次 poll 的
+            for (auto& i : added) {
+                ioManager->delEvent(i.first, i.second, info.get());
+            }
+            if (info->cancelled) {
+                errno = ECANCELED;
+                return -1;
+            }
+            n = poll_f(fds, nfds, 0);
+            if (n != 0) {
+                return n;
+            }
+            if (polling) {
+                // 由循环开头判断是否已到截止时间
+                continue;
+            }
+            if (info->timedout && by_context) {
+                errno = ETIMEDOUT;
+                return -1;
+            }
+            if (info->timedout) {
+                return 0;
+            }
+        }
+    }
 
-            int ret = ioManager->addEvent(fd, (IOManager::Event)event);
-            if (ret == -1) {
-                LOG_ERROR(g_logger) << hook_func_name << " addEvent("
-                                    << fd << ", " << event << ")";
-                if (timer) {
-                    timer->cancel();
-                }
+    // splice/tee 两端都可能返回 EAGAIN，只在尚未就绪的一端上等待
+    template<typename OriginFunc, typename ... Args>
+    static ssize_t do_io_pair(int fd_in, int fd_out, OriginFunc func,
+                              const char* hook_func_name, Args&& ... args) {
+        if (!svher::t_hook_enable) {
+            return func(std::forward<Args>(args)...);
+        }
+        FdContext::ptr in = FdMgr::GetInstance()->get(fd_in);
+        FdContext::ptr out = FdMgr::GetInstance()->get(fd_out);
+        if ((in && in->isClosed()) || (out && out->isClosed())) {
+            errno = EBADF;
+            return -1;
+        }
+        bool hook_in = in && in->isPollable() && !in->getUserNonblock();
+        bool hook_out = out && out->isPollable() && !out->getUserNonblock();
+        if (!hook_in && !hook_out) {
+            return func(std::forward<Args>(args)...);
+        }
+        uint64_t to = std::min(hook_in ? in->getTimeout(SO_RCVTIMEO) : (uint64_t)-1,
+                               hook_out ? out->getTimeout(SO_SNDTIMEO) : (uint64_t)-1);
+        uint64_t deadline = to == (uint64_t)-1 ? -1 : GetCurrentMS() + to;
+        while (true) {
+            ssize_t n = func(std::forward<Args>(args)...);
+            while (n == -1 && errno == EINTR) {
+                n = func(std::forward<Args>(args)...);
+            }
+            if (n != -1 || errno != EAGAIN) {
+                return n;
+            }
+            LOG_DEBUG(g_logger) << "do_io_pair<" << hook_func_name << ">";
+            struct pollfd pfds[2];
+            nfds_t nfds = 0;
+            if (hook_in) pfds[nfds++] = {fd_in, POLLIN, 0};
+            if (hook_out) pfds[nfds++] = {fd_out, POLLOUT, 0};
+            poll_f(pfds, nfds, 0);
+            nfds_t waits = 0;
+            for (nfds_t i = 0; i < nfds; ++i) {
+                if (!pfds[i].revents) pfds[waits++] = pfds[i];
+            }
+            if (!waits) {
+                // 两端看起来都就绪但仍 EAGAIN，让出一次再重试
+                Fiber::YieldToReady();
+                continue;
+            }
+            int timeout = -1;
+            if (deadline != (uint64_t)-1) {
+                uint64_t now = GetCurrentMS();
+                timeout = now >= deadline ? 0 : (int)(deadline - now);
+            }
+            int ret = do_poll(pfds, waits, timeout);
+            if (ret == 0) {
+                errno = ETIMEDOUT;
+                return -1;
+            } else if (ret < 0) {
                 return -1;
-            } else {
-                Fiber::YieldToHold();
-                if (timer) {
-                    timer->cancel();
-                }
-                if (tinfo->cancelled) {
-                    errno = tinfo->cancelled;
-                    return -1;
-                }
-                goto retry;
             }
         }
-        return n;
+    }
+
+    // dup 出来的 fd 和原 fd 共享文件描述，沿用原 fd 的 hook 状态
+    static void dup_context(int oldfd, int newfd) {
+        FdContext::ptr old_ctx = FdMgr::GetInstance()->get(oldfd);
+        if (!old_ctx || old_ctx->isClosed()) return;
+        FdContext::ptr ctx = FdMgr::GetInstance()->get(newfd, true);
+        ctx->setSysNonblock(old_ctx->getSysNonblock());
+        ctx->setUserNonblock(old_ctx->getUserNonblock());
+        ctx->setTimeout(SO_RCVTIMEO, old_ctx->getTimeout(SO_RCVTIMEO));
+        ctx->setTimeout(SO_SNDTIMEO, old_ctx->getTimeout(SO_SNDTIMEO));
+    }
+
+    // dup2/dup3 会隐式关闭 newfd，先清理它上面挂着的事件
+    static void release_context(int fd) {
+        FdContext::ptr ctx = FdMgr::GetInstance()->get(fd);
+        if (ctx) {
+            IOManager* iomanager = IOManager::GetThis();
+            if (iomanager) {
+                iomanager->cancelAll(fd);
+            }
+            FdMgr::GetInstance()->del(fd);
+        }
     }
 }
 
@@ -152,37 +489,44 @@ extern "C" {
     HOOK_FUN(XX)
 #undef XX
 
+    // 被截止时间或取消打断时 errno 为 ETIMEDOUT/ECANCELED
     unsigned int sleep(unsigned int seconds) {
         if (!svher::t_hook_enable) return sleep_f(seconds);
-        svher::Fiber::ptr fiber = svher::Fiber::GetThis();
-        svher::IOManager* iomanager = svher::IOManager::GetThis();
-        iomanager->addTimer(seconds * 1000, [iomanager, fiber]() {
-            iomanager->schedule(fiber);
-        });
-        svher::Fiber::YieldToHold();
+        uint64_t begin = svher::GetCurrentMS();
+        int err = svher::sleep_ms(seconds * 1000);
+        if (err) {
+            errno = err;
+            uint64_t used = (svher::GetCurrentMS() - begin) / 1000;
+            return used < seconds ? seconds - used : 0;
+        }
         return 0;
     }
 
     int usleep(useconds_t usec){
         if (!svher::t_hook_enable) return usleep_f(usec);
-        svher::Fiber::ptr fiber = svher::Fiber::GetThis();
-        svher::IOManager* iomanager = svher::IOManager::GetThis();
-        iomanager->addTimer(usec / 1000, [iomanager, fiber]() {
-            iomanager->schedule(fiber);
-        });
-        svher::Fiber::YieldToHold();
+        int err = svher::sleep_ms(usec / 1000);
+        if (err) {
+            errno = err;
+            return -1;
+        }
         return 0;
     }
 
     int nanosleep(const struct timespec *req, struct timespec *rem) {
         if (!svher::t_hook_enable) return nanosleep_f(req, rem);
         uint64_t timeout_ms = req->tv_sec * 1000 + req->tv_nsec / 1000 / 1000;
-        svher::Fiber::ptr fiber = svher::Fiber::GetThis();
-        svher::IOManager* iomanager = svher::IOManager::GetThis();
-        iomanager->addTimer(timeout_ms, [iomanager, fiber]() {
-            iomanager->schedule(fiber);
-        });
-        svher::Fiber::YieldToHold();
+        uint64_t begin = svher::GetCurrentMS();
+        int err = svher::sleep_ms(timeout_ms);
+        if (err) {
+            errno = err;
+            if (rem) {
+                uint64_t used = svher::GetCurrentMS() - begin;
+                uint64_t left = used < timeout_ms ? timeout_ms - used : 0;
+                rem->tv_sec = left / 1000;
+                rem->tv_nsec = left % 1000 * 1000 * 1000;
+            }
+            return -1;
+        }
         return 0;
     }
 
@@ -206,7 +550,7 @@ extern "C" {
             errno = EBADF;
             return -1;
         }
-        if (!ctx->isSocket() || ctx->getUserNonblock()) {
+        if (!ctx->isPollable() || ctx->getUserNonblock()) {
             return connect_f(sockfd, addr, addrlen);
         }
         int n = connect_f(sockfd, addr, addrlen);
@@ -214,33 +558,12 @@ extern "C" {
         else if (n != -1 || errno != EINPROGRESS) {
             return n;
         }
-        svher::IOManager* ioManager = svher::IOManager::GetThis();
-        svher::Timer::ptr timer;
-        std::shared_ptr<svher::timer_info> tinfo(new svher::timer_info);
-        std::weak_ptr<svher::timer_info> winfo(tinfo);
-        if (timeout_ms != (uint64_t)-1) {
-            timer = ioManager->addConditionalTimer(timeout_ms, [winfo, sockfd, ioManager]() {
-                auto t = winfo.lock();
-                if (!t || t->cancelled) return;
-                t->cancelled = ETIMEDOUT;
-                ioManager->cancelEvent(sockfd, svher::IOManager::WRITE);
-            }, winfo);
-        }
-        int ret = ioManager->addEvent(sockfd, svher::IOManager::WRITE);
-        if (ret == 0) {
-            svher::Fiber::YieldToHold();
-            if (timer) {
-                timer->cancel();
-            }
-            if (tinfo->cancelled) {
-                errno = tinfo->cancelled;
-                return -1;
-            }
-        } else {
-            if (timer) {
-                timer->cancel();
-            }
+        int err = svher::wait_fd_event(sockfd, svher::IOManager::WRITE, timeout_ms);
+        if (err == -1) {
             LOG_ERROR(svher::g_logger) << "connect addEvent(" << sockfd <<", WRITE) error";
+        } else if (err) {
+            errno = err;
+            return -1;
         }
         int error = 0;
         socklen_t len = sizeof(len);
@@ -267,6 +590,86 @@ extern "C" {
         return fd;
     }
 
+    int accept4(int sockfd, struct sockaddr *addr, socklen_t *addrlen, int flags) {
+        int fd = svher::do_io(sockfd, accept4_f, "accept4",
+                              svher::IOManager::READ, SO_RCVTIMEO, addr, addrlen, flags);
+        if (fd >= 0) {
+            svher::FdContext::ptr ctx = svher::FdMgr::GetInstance()->get(fd, true);
+            ctx->setUserNonblock(flags & SOCK_NONBLOCK);
+        }
+        return fd;
+    }
+
+    int socketpair(int domain, int type, int protocol, int sv[2]) {
+        if (!svher::t_hook_enable) {
+            return socketpair_f(domain, type, protocol, sv);
+        }
+        int ret = socketpair_f(domain, type, protocol, sv);
+        if (ret == -1) return ret;
+        for (int i = 0; i < 2; ++i) {
+            svher::FdContext::ptr ctx = svher::FdMgr::GetInstance()->get(sv[i], true);
+            ctx->setUserNonblock(type & SOCK_NONBLOCK);
+        }
+        return ret;
+    }
+
+    int pipe2(int pipefd[2], int flags) {
+        if (!svher::t_hook_enable) {
+            return pipe2_f(pipefd, flags);
+        }
+        // 内部总是非阻塞，用户要求的阻塞语义由 do_io 模拟
+        int ret = pipe2_f(pipefd, flags | O_NONBLOCK);
+        if (ret == -1) return ret;
+        for (int i = 0; i < 2; ++i) {
+            svher::FdContext::ptr ctx = svher::FdMgr::GetInstance()->get(pipefd[i], true);
+            ctx->setSysNonblock(true);
+            ctx->setUserNonblock(flags & O_NONBLOCK);
+        }
+        return ret;
+    }
+
+    int pipe(int pipefd[2]) {
+        if (!svher::t_hook_enable) {
+            return pipe_f(pipefd);
+        }
+        return pipe2(pipefd, 0);
+    }
+
+    int dup(int oldfd) {
+        if (!svher::t_hook_enable) {
+            return dup_f(oldfd);
+        }
+        int fd = dup_f(oldfd);
+        if (fd >= 0) {
+            svher::dup_context(oldfd, fd);
+        }
+        return fd;
+    }
+
+    int dup2(int oldfd, int newfd) {
+        if (!svher::t_hook_enable || oldfd == newfd) {
+            return dup2_f(oldfd, newfd);
+        }
+        svher::release_context(newfd);
+        int fd = dup2_f(oldfd, newfd);
+        if (fd >= 0) {
+            svher::dup_context(oldfd, fd);
+        }
+        return fd;
+    }
+
+    int dup3(int oldfd, int newfd, int flags) {
+        if (!svher::t_hook_enable || oldfd == newfd) {
+            return dup3_f(oldfd, newfd, flags);
+        }
+        svher::release_context(newfd);
+        int fd = dup3_f(oldfd, newfd, flags);
+        if (fd >= 0) {
+            svher::dup_context(oldfd, fd);
+        }
+        return fd;
+    }
+
     ssize_t read(int fd, void *buf, size_t count) {
         return svher::do_io(fd, read_f, "read",
                             svher::IOManager::READ, SO_RCVTIMEO, buf, count);
@@ -277,6 +680,11 @@ extern "C" {
                             SO_RCVTIMEO, iov, iovcnt);
     }
 
+    ssize_t pread(int fd, void *buf, size_t count, off_t offset) {
+        return svher::do_io(fd, pread_f, "pread", svher::IOManager::READ,
+                            SO_RCVTIMEO, buf, count, offset);
+    }
+
     ssize_t recv(int sockfd, void *buf, size_t len, int flags) {
         return svher::do_io(sockfd, recv_f, "recv", svher::IOManager::READ,
                             SO_RCVTIMEO, buf, len, flags);
@@ -293,6 +701,11 @@ extern "C" {
                             SO_RCVTIMEO, msg, flags);
     }
 
+    int recvmmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen, int flags, struct timespec *timeout) {
+        return svher::do_io(sockfd, recvmmsg_f, "recvmmsg", svher::IOManager::READ,
+                            SO_RCVTIMEO, msgvec, vlen, flags, timeout);
+    }
+
 
     ssize_t write(int fd, const void *buf, size_t count) {
         return svher::do_io(fd, write_f, "write", svher::IOManager::WRITE,
@@ -304,6 +717,11 @@ extern "C" {
                             SO_SNDTIMEO, iov, iovcnt);
     }
 
+    ssize_t pwrite(int fd, const void *buf, size_t count, off_t offset) {
+        return svher::do_io(fd, pwrite_f, "pwrite", svher::IOManager::WRITE,
+                            SO_SNDTIMEO, buf, count, offset);
+    }
+
     ssize_t send(int sockfd, const void *buf, size_t len, int flags) {
         return svher::do_io(sockfd, send_f, "send", svher::IOManager::WRITE,
                             SO_SNDTIMEO, buf, len, flags);
@@ -319,6 +737,117 @@ extern "C" {
                             SO_SNDTIMEO, msg, flags);
     }
 
+    int sendmmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen, int flags) {
+        return svher::do_io(sockfd, sendmmsg_f, "sendmmsg", svher::IOManager::WRITE,
+                            SO_SNDTIMEO, msgvec, vlen, flags);
+    }
+
+    ssize_t sendfile(int out_fd, int in_fd, off_t *offset, size_t count) {
+        return svher::do_io(out_fd, sendfile_f, "sendfile", svher::IOManager::WRITE,
+                            SO_SNDTIMEO, in_fd, offset, count);
+    }
+
+    ssize_t splice(int fd_in, loff_t *off_in, int fd_out, loff_t *off_out, size_t len, unsigned int flags) {
+        return svher::do_io_pair(fd_in, fd_out, splice_f, "splice",
+                                 fd_in, off_in, fd_out, off_out, len, flags);
+    }
+
+    ssize_t tee(int fd_in, int fd_out, size_t len, unsigned int flags) {
+        return svher::do_io_pair(fd_in, fd_out, tee_f, "tee",
+                                 fd_in, fd_out, len, flags);
+    }
+
+    int poll(struct pollfd *fds, nfds_t nfds, int timeout) {
+        if (!svher::t_hook_enable) {
+            return poll_f(fds, nfds, timeout);
+        }
+        return svher::do_poll(fds, nfds, timeout);
+    }
+
+    int ppoll(struct pollfd *fds, nfds_t nfds, const struct timespec *tmo_p, const sigset_t *sigmask) {
+        // 协程无法原子地切换信号掩码，带 sigmask 时保持原语义
+        if (!svher::t_hook_enable || sigmask) {
+            return ppoll_f(fds, nfds, tmo_p, sigmask);
+        }
+        int timeout = -1;
+        if (tmo_p) {
+            timeout = svher::clamp_timeout_ms((int64_t)tmo_p->tv_sec * 1000 + (tmo_p->tv_nsec + 999999) / 1000000);
+        }
+        return svher::do_poll(fds, nfds, timeout);
+    }
+
+    int select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, struct timeval *timeout) {
+        if (!svher::t_hook_enable) {
+            return select_f(nfds, readfds, writefds, exceptfds, timeout);
+        }
+        std::vector<struct pollfd> pfds;
+        for (int fd = 0; fd < nfds; ++fd) {
+            short events = 0;
+            if (readfds && FD_ISSET(fd, readfds)) events |= POLLIN;
+            if (writefds && FD_ISSET(fd, writefds)) events |= POLLOUT;
+            if (exceptfds && FD_ISSET(fd, exceptfds)) events |= POLLPRI;
+            if (events) pfds.push_back({fd, events, 0});
+        }
+        int timeout_ms = -1;
+        uint64_t start = svher::GetCurrentMS();
+        if (timeout) {
+            timeout_ms = svher::clamp_timeout_ms((int64_t)timeout->tv_sec * 1000 + (timeout->tv_usec + 999) / 1000);
+        }
+        int ret = svher::do_poll(pfds.data(), pfds.size(), timeout_ms);
+        if (ret < 0) return ret;
+        if (readfds) FD_ZERO(readfds);
+        if (writefds) FD_ZERO(writefds);
+        if (exceptfds) FD_ZERO(exceptfds);
+        int count = 0;
+        for (auto& p : pfds) {
+            if (p.revents & POLLNVAL) {
+                errno = EBADF;
+                return -1;
+            }
+            if (readfds && (p.events & POLLIN) && (p.revents & (POLLIN | POLLHUP | POLLERR))) {
+                FD_SET(p.fd, readfds);
+                ++count;
+            }
+            if (writefds && (p.events & POLLOUT) && (p.revents & (POLLOUT | POLLERR))) {
+                FD_SET(p.fd, writefds);
+                ++count;
+            }
+            if (exceptfds && (p.events & POLLPRI) && (p.revents & POLLPRI)) {
+                FD_SET(p.fd, exceptfds);
+                ++count;
+            }
+        }
+        if (timeout) {
+            // 与 Linux 一致，返回时写回剩余时间
+            uint64_t used = svher::GetCurrentMS() - start;
+            uint64_t left = (uint64_t)timeout_ms > used ? timeout_ms - used : 0;
+            timeout->tv_sec = left / 1000;
+            timeout->tv_usec = left % 1000 * 1000;
+        }
+        return count;
+    }
+
+    int epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout) {
+        if (!svher::t_hook_enable || timeout == 0) {
+            return epoll_wait_f(epfd, events, maxevents, timeout);
+        }
+        // epoll fd 本身可读即代表有就绪事件，等它可读后再非阻塞地取事件
+        uint64_t deadline = timeout < 0 ? -1 : svher::GetCurrentMS() + timeout;
+        while (true) {
+            int n = epoll_wait_f(epfd, events, maxevents, 0);
+            if (n != 0) return n;
+            int to = -1;
+            if (deadline != (uint64_t)-1) {
+                uint64_t now = svher::GetCurrentMS();
+                if (now >= deadline) return 0;
+                to = deadline - now;
+            }
+            struct pollfd pfd = {epfd, POLLIN, 0};
+            int ret = svher::do_poll(&pfd, 1, to);
+            if (ret <= 0) return ret;
+        }
+    }
+
     int close(int fd) {
         if (!svher::t_hook_enable) return close_f(fd);
         svher::FdContext::ptr ctx = svher::FdMgr::GetInstance()->get(fd);
@@ -341,7 +870,7 @@ extern "C" {
                 int arg = va_arg(va, int);
                 va_end(va);
                 svher::FdContext::ptr ctx = svher::FdMgr::GetInstance()->get(fd);
-                if (!ctx || ctx->isClosed() || !ctx->isSocket()) {
+                if (!ctx || ctx->isClosed() || !ctx->isPollable()) {
                     return fcntl_f(fd, cmd, arg);
                 }
                 ctx->setUserNonblock(arg & O_NONBLOCK);
@@ -357,7 +886,7 @@ extern "C" {
                 va_end(va);
                 int ret = fcntl_f(fd, cmd);
                 svher::FdContext::ptr ctx = svher::FdMgr::GetInstance()->get(fd);
-                if (!ctx || ctx->isClosed() || ctx->isSocket()) {
+                if (!ctx || ctx->isClosed() || !ctx->isPollable()) {
                     return ret;
                 }
                 if (ctx->getUserNonblock()) {
@@ -417,7 +946,7 @@ extern "C" {
             // true: 允许非阻塞
             bool user_nonblock = !!*(int*)arg;
             svher::FdContext::ptr ctx = svher::FdMgr::GetInstance()->get(fd);
-            if (!ctx || ctx->isClosed() || ctx->isSocket()) {
+            if (!ctx || ctx->isClosed() || !ctx->isPollable()) {
                 return ioctl_f(fd, request, arg);
             }
             ctx->setUserNonblock(user_nonblock);
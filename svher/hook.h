@@ -2,6 +2,10 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/epoll.h>
+#include <poll.h>
+#include <signal.h>
 #include <ctime>
 #include <cstdint>
 
@@ -29,12 +33,36 @@ extern "C" {
     typedef int (*accept_fun)(int sockfd, struct sockaddr *addr, socklen_t *addrlen);
     extern accept_fun accept_f;
 
+    typedef int (*accept4_fun)(int sockfd, struct sockaddr *addr, socklen_t *addrlen, int flags);
+    extern accept4_fun accept4_f;
+
+    typedef int (*socketpair_fun)(int domain, int type, int protocol, int sv[2]);
+    extern socketpair_fun socketpair_f;
+
+    typedef int (*pipe_fun)(int pipefd[2]);
+    extern pipe_fun pipe_f;
+
+    typedef int (*pipe2_fun)(int pipefd[2], int flags);
+    extern pipe2_fun pipe2_f;
+
+    typedef int (*dup_fun)(int oldfd);
+    extern dup_fun dup_f;
+
+    typedef int (*dup2_fun)(int oldfd, int newfd);
+    extern dup2_fun dup2_f;
+
+    typedef int (*dup3_fun)(int oldfd, int newfd, int flags);
+    extern dup3_fun dup3_f;
+
     typedef ssize_t (*read_fun)(int fd, void *buf, size_t count);
     extern read_fun read_f;
 
     typedef ssize_t (*readv_fun)(int fd, const struct iovec *iov, int iovcnt);
     extern readv_fun readv_f;
 
+    typedef ssize_t (*pread_fun)(int fd, void *buf, size_t count, off_t offset);
+    extern pread_fun pread_f;
+
     typedef ssize_t (*recv_fun)(int sockfd, void *buf, size_t len, int flags);
     extern recv_fun recv_f;
 
@@ -44,12 +72,18 @@ extern "C" {
     typedef ssize_t (*recvmsg_fun)(int sockfd, struct msghdr *msg, int flags);
     extern recvmsg_fun recvmsg_f;
 
+    typedef int (*recvmmsg_fun)(int sockfd, struct mmsghdr *msgvec, unsigned int vlen, int flags, struct timespec *timeout);
+    extern recvmmsg_fun recvmmsg_f;
+
     typedef ssize_t (*write_fun)(int fd, const void *buf, size_t count);
     extern write_fun write_f;
 
     typedef ssize_t (*writev_fun)(int fd, const struct iovec *iov, int iovcnt);
     extern writev_fun writev_f;
 
+    typedef ssize_t (*pwrite_fun)(int fd, const void *buf, size_t count, off_t offset);
+    extern pwrite_fun pwrite_f;
+
     typedef ssize_t (*send_fun)(int sockfd, const void *buf, size_t len, int flags);
     extern send_fun send_f;
 
@@ -59,6 +93,30 @@ extern "C" {
     typedef ssize_t (*sendmsg_fun)(int sockfd, const struct msghdr *msg, int flags);
     extern sendmsg_fun sendmsg_f;
 
+    typedef int (*sendmmsg_fun)(int sockfd, struct mmsghdr *msgvec, unsigned int vlen, int flags);
+    extern sendmmsg_fun sendmmsg_f;
+
+    typedef ssize_t (*sendfile_fun)(int out_fd, int in_fd, off_t *offset, size_t count);
+    extern sendfile_fun sendfile_f;
+
+    typedef ssize_t (*splice_fun)(int fd_in, loff_t *off_in, int fd_out, loff_t *off_out, size_t len, unsigned int flags);
+    extern splice_fun splice_f;
+
+    typedef ssize_t (*tee_fun)(int fd_in, int fd_out, size_t len, unsigned int flags);
+    extern tee_fun tee_f;
+
+    typedef int (*poll_fun)(struct pollfd *fds, nfds_t nfds, int timeout);
+    extern poll_fun poll_f;
+
+    typedef int (*ppoll_fun)(struct pollfd *fds, nfds_t nfds, const struct timespec *tmo_p, const sigset_t *sigmask);
+    extern ppoll_fun ppoll_f;
+
+    typedef int (*select_fun)(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, struct timeval *timeout);
+    extern select_fun select_f;
+
+    typedef int (*epoll_wait_fun)(int epfd, struct epoll_event *events, int maxevents, int timeout);
+    extern epoll_wait_fun epoll_wait_f;
+
     typedef int (*close_fun)(int fd);
     extern close_fun close_f;
 
@@ -1,6 +1,7 @@
 #include "iomanager.h"
 #include "macro.h"
 #include "log.h"
+#include "hook.h"
 #include <memory.h>
 #include <unistd.h>
 #include <sys/epoll.h>
@@ -41,7 +42,16 @@ namespace svher {
         }
     }
 
-    int IOManager::addEvent(int fd, IOManager::Event event, std::function<void()> cb) {
+    int IOManager::addEvent(int fd, IOManager::Event event, std::function<void()> cb, bool exclusive) {
+        return doAddEvent(fd, event, std::move(cb), exclusive, nullptr, true);
+    }
+
+    int IOManager::tryAddEvent(int fd, IOManager::Event event, std::function<void()> cb, const void* owner) {
+        return doAddEvent(fd, event, std::move(cb), false, owner, false);
+    }
+
+    int IOManager::doAddEvent(int fd, IOManager::Event event, std::function<void()> cb, bool exclusive,
+                              const void* owner, bool strict) {
         IOContext* ioCtx = nullptr;
         RWMutexType::ReadLock lock(m_mutex);
         if ((int)m_ioContexts.size() > fd) {
@@ -54,14 +64,26 @@ namespace svher {
         }
         IOContext::MutexType::Lock lock2(ioCtx->mutex);
         if (ioCtx->events & event) {
+            if (!strict) {
+                return -1;
+            }
             LOG_ERROR(g_logger) << "add duplicate event fd="
                                 << fd << " event=" << event
                                 << " ioCtx.events=" << ioCtx->events;
             ASSERT(false);
         }
         int op = ioCtx->events ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+        if (op == EPOLL_CTL_MOD && (ioCtx->exclusive || exclusive)) {
+            // EPOLLEXCLUSIVE 的注册不能再 MOD
+            LOG_ERROR(g_logger) << "addEvent fd=" << fd << " event=" << event
+                                << " conflicts with exclusive ioCtx.events=" << ioCtx->events;
+            return -1;
+        }
         epoll_event epollEvent;
         epollEvent.events = EPOLLET | ioCtx->events | event;
+        if (exclusive) {
+            epollEvent.events |= EPOLLEXCLUSIVE;
+        }
         epollEvent.data.ptr = ioCtx;
 
         int ret = epoll_ctl(m_epfd, op, fd, &epollEvent);
@@ -74,9 +96,11 @@ namespace svher {
         }
         ++m_pendingEventCount;
         ioCtx->events = (Event)(ioCtx->events | event);
+        ioCtx->exclusive = exclusive;
         IOContext::EventContext& event_ctx = ioCtx->getContext(event);
         ASSERT(!event_ctx.scheduler && !event_ctx.fiber && !event_ctx.cb);
         event_ctx.scheduler = Scheduler::GetThis();
+        event_ctx.owner = owner;
         if (cb) {
             event_ctx.cb.swap(cb);
         } else {
@@ -87,8 +111,12 @@ namespace svher {
     }
 
     bool IOManager::delEvent(int fd, IOManager::Event event) {
+        return delEvent(fd, event, nullptr);
+    }
+
+    bool IOManager::delEvent(int fd, IOManager::Event event, const void* owner) {
         RWMutexType::ReadLock lock(m_mutex);
-        if ((int)m_ioContexts.size() < fd) {
+        if ((int)m_ioContexts.size() <= fd) {
             return false;
         }
         IOContext* ioCtx = m_ioContexts[fd];
@@ -97,6 +125,10 @@ namespace svher {
         if (!(ioCtx->events & event)) {
             return false;
         }
+        // owner 非空时只撤销自己的注册
+        if (owner && ioCtx->getContext(event).owner != owner) {
+            return false;
+        }
         Event new_events = (Event)(ioCtx->events & ~event);
         int op = new_events ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
         epoll_event epevent;
@@ -155,7 +187,7 @@ namespace svher {
 
     bool IOManager::cancelAll(int fd) {
         RWMutexType::ReadLock lock(m_mutex);
-        if ((int)m_ioContexts.size() < fd) {
+        if ((int)m_ioContexts.size() <= fd) {
             return false;
         }
         IOContext* ioCtx = m_ioContexts[fd];
@@ -180,7 +212,8 @@ namespace svher {
         if (ioCtx->events & READ) {
             ioCtx->triggerEvent(READ);
             --m_pendingEventCount;
-        } else {
+        }
+        if (ioCtx->events & WRITE) {
             ioCtx->triggerEvent(WRITE);
             --m_pendingEventCount;
         }
@@ -212,7 +245,8 @@ namespace svher {
                 } else {
                     next_timeout = MAX_TIMEOUT;
                 }
-                ret = epoll_wait(m_epfd, events, 64, (int)next_timeout);
+                // idle 协程里 hook 是开启的，直接调用原始的 epoll_wait
+                ret = epoll_wait_f(m_epfd, events, 64, (int)next_timeout);
                 if (!(ret < 0 && errno == EINTR)) {
                     break;
                 }
@@ -237,7 +271,8 @@ namespace svher {
                 auto* ioCtx = (IOContext*)event.data.ptr;
                 IOContext::MutexType::Lock lock(ioCtx->mutex);
                 if (event.events & (EPOLLERR | EPOLLHUP)) {
-                    event.events |= EPOLLIN | EPOLLOUT;
+                    // 只唤醒实际注册过的事件
+                    event.events |= (EPOLLIN | EPOLLOUT) & ioCtx->events;
                 }
                 int real_events = NONE;
                 if (event.events & EPOLLIN) {
@@ -269,19 +304,18 @@ namespace svher {
                     --m_pendingEventCount;
                 }
             }
-            Fiber::ptr cur = Fiber::GetThis();
-            auto raw_ptr = cur.get();
-            cur.reset();
-            raw_ptr->swapOut();
+            Fiber::GetThisRaw()->swapOut();
         }
     }
 
     bool IOManager::stopping() {
-        return false;
+        uint64_t timeout = 0;
+        return stopping(timeout);
     }
 
     void IOManager::tickle() {
-        if (hasIdleThreads()) return;
+        // 只有存在 idle 线程 (阻塞在 epoll_wait) 时才需要唤醒
+        if (!hasIdleThreads()) return;
         int ret = write(m_tickleFds[1], "T", 1);
         ASSERT(ret == 1);
 
@@ -318,6 +352,7 @@ namespace svher {
             ctx.scheduler->schedule(&ctx.fiber);
         }
         ctx.scheduler = nullptr;
+        ctx.owner = nullptr;
         return;
     }
 
@@ -336,5 +371,6 @@ namespace svher {
         ctx.scheduler = nullptr;
         ctx.fiber.reset();
         ctx.cb = nullptr;
+        ctx.owner = nullptr;
     }
 }
\ No newline at end of file
@@ -15,8 +15,15 @@ namespace svher {
         };
         IOManager(size_t threads = 1, bool use_caller = true, const std::string& name = "io_routine");
         ~IOManager();
-        int addEvent(int fd, Event event, std::function<void()> cb = nullptr);
+        // exclusive 以 EPOLLEXCLUSIVE 注册，多个 IOManager 等待同一 fd 时只唤醒其中一个
+        // 只能用于 fd 上唯一的事件，之后再添加其它事件会失败
+        int addEvent(int fd, Event event, std::function<void()> cb = nullptr, bool exclusive = false);
         bool delEvent(int fd, Event event);
+        // 同 addEvent，但事件已被注册时返回 -1 而不是断言失败
+        // owner 标记这次注册，配合 delEvent(fd, event, owner) 只撤销自己的注册
+        int tryAddEvent(int fd, Event event, std::function<void()> cb, const void* owner);
+        // owner 非空时，事件仍是 owner 注册的 (未触发也未被他人重新注册) 才撤销；不触发回调
+        bool delEvent(int fd, Event event, const void* owner);
         bool cancelEvent(int fd, Event event);
         bool cancelAll(int fd);
         static IOManager* GetThis();
@@ -26,6 +33,9 @@ namespace svher {
         bool stopping(uint64_t timeout);
         void tickle() override;
         void contextResize(size_t size);
+        // strict 为 true 时重复注册断言失败
+        int doAddEvent(int fd, Event event, std::function<void()> cb, bool exclusive,
+                       const void* owner, bool strict);
         int m_tickleFds[2]{};
         void onTimerInsertedAtFront() override;
     private:
@@ -39,6 +49,8 @@ namespace svher {
                 Scheduler* scheduler = nullptr; // 事件执行的 scheduler
                 std::shared_ptr<Fiber> fiber;
                 std::function<void()> cb;
+                // tryAddEvent 的注册者，触发或撤销后清空
+                const void* owner = nullptr;
             };
             void triggerEvent(Event event);
             EventContext& getContext(Event event);
@@ -47,6 +59,7 @@ namespace svher {
             EventContext read;
             EventContext write;
             Event events = NONE;
+            bool exclusive = false;
             MutexType mutex;
         };
     };
@@ -0,0 +1,129 @@
+#include "offload.h"
+#include "scheduler.h"
+#include "fiber.h"
+#include "config.h"
+#include "log.h"
+#include "macro.h"
+
+namespace svher {
+
+    static Logger::ptr g_logger = LOG_NAME("sys");
+
+    static ConfigVar<uint32_t>::ptr g_offload_threads =
+            Config::Lookup<uint32_t>("offload.threads", 4, "offload thread pool size");
+    static ConfigVar<uint32_t>::ptr g_offload_queue_size =
+            Config::Lookup<uint32_t>("offload.queue_size", 1024, "offload max pending tasks");
+    static ConfigVar<bool>::ptr g_offload_file_io =
+            Config::Lookup("offload.file_io", false, "route hooked regular file io to offload pool");
+
+    static bool s_file_io = false;
+
+    struct OffloadIniter {
+        OffloadIniter() {
+            s_file_io = g_offload_file_io->getValue();
+            g_offload_file_io->addListener([](const bool& old_value, const bool& new_value) {
+                LOG_INFO(g_logger) << "offload file io changed from " << old_value
+                                   << " to " << new_value;
+                s_file_io = new_value;
+            });
+        }
+    };
+
+    static OffloadIniter s_offload_initer;
+
+    Offload::Offload(size_t threads, size_t queue_size, const std::string &name)
+        : m_queueSize(queue_size) {
+        ASSERT(threads > 0);
+        for (size_t i = 0; i < threads; ++i) {
+            m_threads.emplace_back(new Thread(std::bind(&Offload::work, this),
+                                              name + "_" + std::to_string(i)));
+        }
+    }
+
+    Offload::~Offload() {
+        stop();
+    }
+
+    void Offload::stop() {
+        {
+            MutexType::Lock lock(m_mutex);
+            if (m_stopping) return;
+            m_stopping = true;
+        }
+        for (size_t i = 0; i < m_threads.size(); ++i) {
+            m_sem.notify();
+        }
+        for (auto& i : m_threads) {
+            i->join();
+        }
+    }
+
+    size_t Offload::getQueueSize() {
+        MutexType::Lock lock(m_mutex);
+        return m_tasks.size();
+    }
+
+    Offload* Offload::GetInstance() {
+        static Offload s_offload(g_offload_threads->getValue(),
+                                 g_offload_queue_size->getValue());
+        return &s_offload;
+    }
+
+    bool Offload::IsFileIOEnabled() {
+        return s_file_io;
+    }
+
+    void Offload::execute(std::function<void()> task) {
+        Scheduler* scheduler = Scheduler::GetThis();
+        if (!scheduler || Fiber::GetThisRaw() == Scheduler::GetMainFiber()) {
+            task();
+            return;
+        }
+        Fiber::ptr self = Fiber::GetThis();
+        std::function<void()> wrapped = [task, scheduler, self]() {
+            task();
+            scheduler->schedule(self);
+            scheduler->delExternalWait();
+        };
+        scheduler->addExternalWait();
+        if (!post(wrapped)) {
+            // 队列已满，由调用方执行，起到背压的作用
+            scheduler->delExternalWait();
+            ++m_rejects;
+            task();
+            return;
+        }
+        self.reset();
+        FiberWaitScope scope("offload");
+        Fiber::YieldToHold();
+    }
+
+    bool Offload::post(std::function<void()>& task) {
+        {
+            MutexType::Lock lock(m_mutex);
+            if (m_stopping || m_tasks.size() >= m_queueSize) {
+                return false;
+            }
+            m_tasks.push_back(std::move(task));
+        }
+        m_sem.notify();
+        return true;
+    }
+
+    void Offload::work() {
+        while (true) {
+            m_sem.wait();
+            std::function<void()> task;
+            {
+                MutexType::Lock lock(m_mutex);
+                if (m_tasks.empty()) {
+                    if (m_stopping) return;
+                    continue;
+                }
+                task.swap(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            task();
+        }
+    }
+}
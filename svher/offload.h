@@ -0,0 +1,92 @@
+#pragma once
+
+#include <memory>
+#include <functional>
+#include <exception>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include "thread.h"
+#include "util.h"
+
+namespace svher {
+
+    // 阻塞的文件 IO / CPU 密集任务交给独立线程池执行，
+    // 调用协程挂起，完成后回到原调度器继续运行
+    class Offload : Noncopyable {
+    public:
+        typedef std::shared_ptr<Offload> ptr;
+        typedef Mutex MutexType;
+
+        Offload(size_t threads, size_t queue_size, const std::string& name = "offload");
+        ~Offload();
+
+        // 在线程池执行 fn 并返回其结果，fn 抛出的异常在调用方重新抛出
+        // 不在协程中、线程池已停止或队列已满时直接在当前线程执行
+        template<class F>
+        auto run(F fn) -> decltype(fn()) {
+            Result<decltype(fn())> result;
+            execute([&result, &fn]() {
+                result.set(fn);
+            });
+            return result.get();
+        }
+
+        void stop();
+        size_t getThreadCount() const { return m_threads.size(); }
+        size_t getQueueSize();
+        // 因队列满而在调用方执行的次数
+        uint64_t getRejectCount() const { return m_rejects; }
+
+        // 全局实例，由 offload.threads / offload.queue_size 配置
+        static Offload* GetInstance();
+        // offload.file_io 为 true 时，hook 的普通文件读写走线程池
+        static bool IsFileIOEnabled();
+    private:
+        template<class T>
+        struct Result {
+            std::unique_ptr<T> value;
+            std::exception_ptr error;
+            template<class F>
+            void set(F& fn) {
+                try {
+                    value.reset(new T(fn()));
+                } catch (...) {
+                    error = std::current_exception();
+                }
+            }
+            T get() {
+                if (error) std::rethrow_exception(error);
+                return std::move(*value);
+            }
+        };
+
+        void execute(std::function<void()> task);
+        bool post(std::function<void()>& task);
+        void work();
+
+        MutexType m_mutex;
+        Semaphore m_sem;
+        std::deque<std::function<void()>> m_tasks;
+        std::vector<Thread::ptr> m_threads;
+        size_t m_queueSize;
+        bool m_stopping = false;
+        std::atomic<uint64_t> m_rejects{0};
+    };
+
+    template<>
+    struct Offload::Result<void> {
+        std::exception_ptr error;
+        template<class F>
+        void set(F& fn) {
+            try {
+                fn();
+            } catch (...) {
+                error = std::current_exception();
+            }
+        }
+        void get() {
+            if (error) std::rethrow_exception(error);
+        }
+    };
+}
@@ -0,0 +1,222 @@
+#include "relay.h"
+#include "config.h"
+#include "fdmanager.h"
+#include "fibersync.h"
+#include "hook.h"
+#include "log.h"
+#include "selector.h"
+#include <fcntl.h>
+#include <signal.h>
+
+namespace svher {
+
+    static Logger::ptr g_logger = LOG_NAME("sys");
+
+    static ConfigVar<uint64_t>::ptr g_relay_idle_timeout =
+            Config::Lookup<uint64_t>("relay.idle_timeout", 5 * 60 * 1000, "relay idle timeout (ms)");
+    static ConfigVar<uint32_t>::ptr g_relay_chunk_size =
+            Config::Lookup<uint32_t>("relay.chunk_size", 64 * 1024, "relay splice/copy chunk size");
+    static ConfigVar<bool>::ptr g_relay_splice =
+            Config::Lookup<bool>("relay.splice", true, "relay with splice");
+
+    static ConfigVar<bool>::ptr g_relay_ignore_sigpipe =
+            Config::Lookup<bool>("relay.ignore_sigpipe", true, "ignore SIGPIPE on first splice relay");
+
+    // 对端复位时 splice 写 socket 会触发 SIGPIPE，且不能像 send 一样带 MSG_NOSIGNAL
+    // 首次用 splice 转发时才忽略，且只在仍是默认处理时修改，不覆盖程序自己安装的处理函数
+    static void ignore_sigpipe() {
+        static bool s_done = []() {
+            struct sigaction old;
+            if (sigaction(SIGPIPE, nullptr, &old) == 0
+                    && !(old.sa_flags & SA_SIGINFO) && old.sa_handler == SIG_DFL) {
+                signal(SIGPIPE, SIG_IGN);
+            }
+            return true;
+        }();
+        (void)s_done;
+    }
+
+    Relay::Relay(Socket::ptr a, Socket::ptr b)
+        : m_a(a),
+          m_b(b),
+          m_idleTimeout(g_relay_idle_timeout->getValue()),
+          m_useSplice(g_relay_splice->getValue()),
+          m_chunkSize(g_relay_chunk_size->getValue()),
+          m_token(new CancelToken) {
+    }
+
+    bool Relay::run() {
+        IOManager* iom = IOManager::GetThis();
+        if (!iom || !m_a || !m_b) {
+            m_error = EINVAL;
+            return false;
+        }
+        // 确保两个 fd 都已设为非阻塞，splice 和拷贝都在 EAGAIN 时挂到 IOManager 上等待
+        for (auto& sock : {m_a, m_b}) {
+            FdContext::ptr ctx = FdMgr::GetInstance()->get(sock->getSocket(), true);
+            if (!ctx || !ctx->isSocket() || ctx->isClosed()) {
+                m_error = EBADF;
+                return false;
+            }
+        }
+        if (m_useSplice && g_relay_ignore_sigpipe->getValue()) {
+            ignore_sigpipe();
+        }
+        m_lastActive = GetCurrentMS();
+        FiberSemaphore finished;
+        iom->schedule([this, &finished]() {
+            CancelScope scope(m_token);
+            fail(pump(m_b->getSocket(), m_a->getSocket(), m_bytesBToA));
+            finished.notify();
+        });
+        {
+            CancelScope scope(m_token);
+            fail(pump(m_a->getSocket(), m_b->getSocket(), m_bytesAToB));
+        }
+        finished.wait();
+        return m_error == 0;
+    }
+
+    void Relay::stop() {
+        fail(ECANCELED);
+    }
+
+    void Relay::fail(int err) {
+        if (!err) {
+            return;
+        }
+        int expected = 0;
+        m_error.compare_exchange_strong(expected, err);
+        m_token->cancel();
+    }
+
+    int Relay::pump(int from, int to, std::atomic<uint64_t>& bytes) {
+        if (m_useSplice) {
+            bool fallback = false;
+            int rt = pumpSplice(from, to, bytes, fallback);
+            if (!fallback) {
+                return rt;
+            }
+            LOG_DEBUG(g_logger) << "relay fd=" << from << " -> fd=" << to << " splice unsupported, copy instead";
+        }
+        return pumpCopy(from, to, bytes);
+    }
+
+    int Relay::pumpSplice(int from, int to, std::atomic<uint64_t>& bytes, bool& fallback) {
+        int fds[2];
+        if (pipe2_f(fds, O_NONBLOCK | O_CLOEXEC)) {
+            fallback = true;
+            return 0;
+        }
+        // 失败时保持默认容量
+        fcntl_f(fds[1], F_SETPIPE_SZ, (int)m_chunkSize);
+        ++m_spliced;
+        bool first = true;
+        size_t pending = 0;
+        int err = 0;
+        while (!err) {
+            if ((err = FiberDeadline::Check())) {
+                break;
+            }
+            if (pending == 0) {
+                ssize_t n = splice_f(from, nullptr, fds[1], nullptr, m_chunkSize, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+                if (n > 0) {
+                    first = false;
+                    pending = n;
+                    m_lastActive = GetCurrentMS();
+                } else if (n == 0) {
+                    ::shutdown(to, SHUT_WR);
+                    break;
+                } else if (errno == EAGAIN) {
+                    err = waitFor(from, true);
+                    continue;
+                } else if (errno == EINTR) {
+                    continue;
+                } else if (first && (errno == EINVAL || errno == ENOSYS)) {
+                    --m_spliced;
+                    fallback = true;
+                    break;
+                } else {
+                    err = errno;
+                    break;
+                }
+            }
+            ssize_t n = splice_f(fds[0], nullptr, to, nullptr, pending, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (n > 0) {
+                pending -= n;
+                bytes += n;
+                m_lastActive = GetCurrentMS();
+            } else if (n < 0 && errno == EAGAIN) {
+                err = waitFor(to, false);
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else {
+                err = n < 0 ? errno : EPIPE;
+            }
+        }
+        ::close(fds[0]);
+        ::close(fds[1]);
+        return err;
+    }
+
+    int Relay::pumpCopy(int from, int to, std::atomic<uint64_t>& bytes) {
+        std::vector<char> buffer(m_chunkSize);
+        int err = 0;
+        while (!err) {
+            if ((err = FiberDeadline::Check())) {
+                break;
+            }
+            ssize_t n = recv_f(from, &buffer[0], buffer.size(), 0);
+            if (n == 0) {
+                ::shutdown(to, SHUT_WR);
+                break;
+            } else if (n < 0) {
+                if (errno == EAGAIN) {
+                    err = waitFor(from, true);
+                } else if (errno != EINTR) {
+                    err = errno;
+                }
+                continue;
+            }
+            m_lastActive = GetCurrentMS();
+            size_t offset = 0;
+            while (offset < (size_t)n && !err) {
+                ssize_t rt = send_f(to, &buffer[offset], n - offset, MSG_NOSIGNAL);
+                if (rt > 0) {
+                    offset += rt;
+                    bytes += rt;
+                    m_lastActive = GetCurrentMS();
+                } else if (rt < 0 && errno == EAGAIN) {
+                    err = waitFor(to, false);
+                } else if (rt < 0 && errno != EINTR) {
+                    err = errno;
+                }
+            }
+        }
+        return err;
+    }
+
+    int Relay::waitFor(int fd, bool read) {
+        Selector sel;
+        while (true) {
+            sel.clear();
+            int io = read ? sel.addRead(fd) : sel.addWrite(fd);
+            if (m_idleTimeout != (uint64_t)-1) {
+                // 按两个方向中最近一次收发计算空闲时间
+                uint64_t last = m_lastActive;
+                uint64_t now = GetCurrentMS();
+                uint64_t idle = now > last ? now - last : 0;
+                if (idle >= m_idleTimeout) {
+                    return ETIMEDOUT;
+                }
+                sel.addTimeout(m_idleTimeout - idle);
+            }
+            int rt = sel.wait();
+            if (rt == io) {
+                return 0;
+            } else if (rt < 0) {
+                return errno;
+            }
+        }
+    }
+}
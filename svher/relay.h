@@ -0,0 +1,62 @@
+#pragma once
+
+#include <memory>
+#include <atomic>
+#include "socket.h"
+#include "deadline.h"
+#include "util.h"
+
+namespace svher {
+
+    // 两个已连接 Socket 之间的双向转发 (四层代理)
+    // 每个方向经一对 pipe 用 splice 在内核中搬运数据，不经过用户态缓冲；
+    // 首次 splice 返回 EINVAL 等不支持的错误或 setUseSplice(false) 时退回 recv/send 拷贝
+    // 一端读到 EOF 后对另一端 shutdown(SHUT_WR)，两个方向都结束后 run 返回 (支持半关闭)
+    // 双向都没有数据超过 idleTimeout 或一个方向出错时两个方向都停止
+    // 只能在 IOManager 的协程中使用，不负责关闭两个 Socket
+    // splice 写 socket 无法带 MSG_NOSIGNAL，首次以 splice 运行时若 SIGPIPE 仍为默认处理则改为忽略，
+    // 由配置 relay.ignore_sigpipe 控制，关闭后需由程序自己处理 SIGPIPE
+    class Relay : Noncopyable {
+    public:
+        typedef std::shared_ptr<Relay> ptr;
+        Relay(Socket::ptr a, Socket::ptr b);
+
+        // 挂起当前协程直到两个方向都结束，另一个方向在新协程中运行
+        // 两个方向都正常结束返回 true，否则返回 false，getError 为 ETIMEDOUT、ECANCELED 或 socket 错误
+        bool run();
+        // 可在任意线程调用
+        void stop();
+
+        void setIdleTimeout(uint64_t ms) { m_idleTimeout = ms; }
+        void setUseSplice(bool v) { m_useSplice = v; }
+        // 单次 splice/recv 的最大字节数，splice 时同时用作 pipe 容量
+        void setChunkSize(size_t v) { m_chunkSize = v; }
+
+        int getError() const { return m_error; }
+        // a 读出写入 b 的字节数
+        uint64_t getBytesAToB() const { return m_bytesAToB; }
+        uint64_t getBytesBToA() const { return m_bytesBToA; }
+        // 各方向实际使用了 splice 的个数
+        int getSplicedCount() const { return m_spliced; }
+    private:
+        // 返回 0 表示读到 EOF 后正常结束
+        int pump(int from, int to, std::atomic<uint64_t>& bytes);
+        int pumpSplice(int from, int to, std::atomic<uint64_t>& bytes, bool& fallback);
+        int pumpCopy(int from, int to, std::atomic<uint64_t>& bytes);
+        // 等待 fd 可读/可写，超过空闲时间返回 ETIMEDOUT
+        int waitFor(int fd, bool read);
+        void fail(int err);
+
+        Socket::ptr m_a;
+        Socket::ptr m_b;
+        uint64_t m_idleTimeout;
+        bool m_useSplice;
+        size_t m_chunkSize;
+        CancelToken::ptr m_token;
+        std::atomic<int> m_error{0};
+        std::atomic<uint64_t> m_bytesAToB{0};
+        std::atomic<uint64_t> m_bytesBToA{0};
+        std::atomic<uint64_t> m_lastActive{0};
+        std::atomic<int> m_spliced{0};
+    };
+}
@@ -1,5 +1,7 @@
 #include "scheduler.h"
 #include "hook.h"
+#include "watchdog.h"
+#include "fiberregistry.h"
 #include "log.h"
 #include "macro.h"
 
@@ -28,10 +30,12 @@ namespace svher {
             m_rootThread = -1;
         }
         m_threadCount = threads;
+        FiberRegistry::AddScheduler(this);
     }
 
     Scheduler::~Scheduler() {
         ASSERT(m_stopping);
+        FiberRegistry::DelScheduler(this);
         if (GetThis() == this) {
             t_scheduler = nullptr;
         }
@@ -106,8 +110,9 @@ namespace svher {
         LOG_DEBUG(g_logger) << "run";
         set_hook_enable(true);
         setThis();
+        Watchdog::RegisterThread();
         if (GetThreadId() != m_rootThread) {
-            t_fiber = Fiber::GetThis().get();
+            t_fiber = Fiber::GetThisRaw();
         }
         Fiber::ptr idle_fiber(new Fiber(std::bind(&Scheduler::idle, this)));
         Fiber::ptr cb_fiber;
@@ -132,8 +137,8 @@ namespace svher {
                         ++it;
                         continue;
                     }
-                    // 取出一个需要执行的任务
-                    ft = *it;
+                    // 取出一个需要执行的任务，移动避免引用计数与回调的拷贝
+                    ft = std::move(*it);
                     m_fibers.erase(it);
                     ++m_activeThreadCount;
                     is_activate = true;
@@ -145,27 +150,28 @@ namespace svher {
             }
             if (ft.fiber && ft.fiber->getState() != Fiber::TERM
                     && ft.fiber->getState() != Fiber::EXCEPT) {
-                ft.fiber->swapIn();
+                runFiber(ft.fiber.get(), ft.enqueueTime);
                 --m_activeThreadCount;
                 if (ft.fiber->getState() == Fiber::READY) {
-                    schedule(ft.fiber);
+                    schedule(&ft.fiber);
                 } else if (ft.fiber->getState() != Fiber::TERM
                     && ft.fiber->getState() != Fiber::EXCEPT) {
                     ft.fiber->m_state = Fiber::HOLD;
                 }
                 ft.reset();
             } else if (ft.cb) {
+                // 回调协程挂起后由等待方持有，这里从协程池取一个新的
                 if (cb_fiber) {
-                    cb_fiber->reset(ft.cb);
+                    cb_fiber->reset(std::move(ft.cb));
                 } else {
-                    cb_fiber.reset(new Fiber(ft.cb));
+                    cb_fiber = Fiber::Create(std::move(ft.cb));
                 }
+                uint64_t enqueue_time = ft.enqueueTime;
                 ft.reset();
-                cb_fiber->swapIn();
+                runFiber(cb_fiber.get(), enqueue_time);
                 --m_activeThreadCount;
                 if (cb_fiber->getState() == Fiber::READY) {
-                    schedule(ft.fiber);
-                    cb_fiber.reset();
+                    schedule(&cb_fiber);
                 } else if (cb_fiber->getState() == Fiber::TERM
                            || cb_fiber->getState() == Fiber::EXCEPT) {
                     cb_fiber->reset(nullptr);
@@ -181,6 +187,7 @@ namespace svher {
                 }
                 if (idle_fiber->getState() == Fiber::TERM) {
                     LOG_INFO(g_logger) << "idle fiber term";
+                    Watchdog::UnregisterThread();
                     break;
                 }
                 ++m_idleThreadCount;
@@ -194,10 +201,39 @@ namespace svher {
         }
     }
 
+    void Scheduler::runFiber(Fiber* fiber, uint64_t enqueue_time) {
+        if (FiberRegistry::IsEnabled()) {
+            fiber->m_scheduler = this;
+            fiber->m_lastRun = GetCurrentMS();
+        }
+        if (!FiberStats::IsEnabled()) {
+            Watchdog::EnterFiber(fiber);
+            fiber->swapIn();
+            Watchdog::LeaveFiber();
+            return;
+        }
+        uint64_t start = GetMonotonicNS();
+        Watchdog::EnterFiber(fiber);
+        fiber->swapIn();
+        Watchdog::LeaveFiber();
+        uint64_t used = GetMonotonicNS() - start;
+        // 协程可能在执行中设置了标签，结束后再按标签归类
+        uint32_t tag = fiber->getTag();
+        ++fiber->m_switches;
+        fiber->m_cpuTime += used;
+        m_stats.addSlice(used);
+        FiberStats::AddSlice(tag, used);
+        if (enqueue_time && start > enqueue_time) {
+            m_stats.addWait(start - enqueue_time);
+            FiberStats::AddWait(tag, start - enqueue_time);
+        }
+    }
+
     bool Scheduler::stopping() {
         MutexType::Lock lock(m_mutex);
         return m_autoStop && m_stopping
-            && m_fibers.empty() && m_activeThreadCount == 0;
+            && m_fibers.empty() && m_activeThreadCount == 0
+            && m_externalWaitCount == 0;
     }
 
     void Scheduler::setThis() {
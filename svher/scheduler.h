@@ -4,6 +4,7 @@
 #include <list>
 #include "fiber.h"
 #include "thread.h"
+#include "fiberstats.h"
 
 namespace svher {
 
@@ -39,6 +40,12 @@ namespace svher {
             }
             if (need_tickle) tickle();
         }
+        // 协程挂起等待调度器之外的事件 (如 Offload 线程池) 时计数，
+        // 计数非零时调度器不会退出，唤醒方应先 schedule 再 del
+        void addExternalWait() { ++m_externalWaitCount; }
+        void delExternalWait() { --m_externalWaitCount; }
+        // 本调度器上所有协程的上 CPU 时间与排队延迟 (需开启 fiber.stats)
+        SchedStatsSnapshot getStats() const { return m_stats.snapshot(); }
 
     protected:
         virtual void tickle();
@@ -46,12 +53,17 @@ namespace svher {
         virtual bool stopping();
         virtual void idle();
         void setThis();
+        // 切入协程执行，开启统计时记录排队延迟与本次上 CPU 时间
+        void runFiber(Fiber* fiber, uint64_t enqueue_time);
         bool hasIdleThreads() { return m_idleThreadCount > 0; }
     private:
         template<class T>
         bool scheduleNoLock(T callback, int thread) {
             bool need_tickle = m_fibers.empty();
             FiberAndThread ft(callback, thread);
+            if (FiberStats::IsEnabled()) {
+                ft.enqueueTime = GetMonotonicNS();
+            }
             if (ft.fiber || ft.cb) {
                 m_fibers.push_back(ft);
             }
@@ -62,6 +74,8 @@ namespace svher {
             std::function<void()> cb;
             // 在这个线程上执行
             int thread;
+            // 入队时间，用于统计排队延迟
+            uint64_t enqueueTime = 0;
 
             FiberAndThread(Fiber::ptr f, int thr)
                 : fiber(std::move(f)), thread(thr) {}
@@ -82,6 +96,7 @@ namespace svher {
                 fiber = nullptr;
                 cb = nullptr;
                 thread = -1;
+                enqueueTime = 0;
             }
         };
         MutexType m_mutex;
@@ -89,11 +104,13 @@ namespace svher {
         std::list<FiberAndThread> m_fibers;
         Fiber::ptr m_rootFiber;
         std::string m_name;
+        SchedStats m_stats;
     protected:
         std::vector<int> m_threadIds;
         size_t m_threadCount = 0;
         std::atomic_size_t m_activeThreadCount{0};
         std::atomic_size_t m_idleThreadCount{0};
+        std::atomic_size_t m_externalWaitCount{0};
         bool m_stopping = true;
         bool m_autoStop = false;
         int m_rootThread = 0;
@@ -0,0 +1,123 @@
+#include "selector.h"
+#include "deadline.h"
+#include "log.h"
+
+namespace svher {
+    static Logger::ptr g_logger = LOG_NAME("sys");
+
+    struct SelectState {
+        // 第一个触发的 fd/定时器分支
+        std::atomic<int> fired{-1};
+        FiberWaiter::ptr waiter;
+    };
+
+    int Selector::addRead(int fd) {
+        Branch branch;
+        branch.type = FD;
+        branch.fd = fd;
+        branch.event = IOManager::READ;
+        m_branches.push_back(std::move(branch));
+        return m_branches.size() - 1;
+    }
+
+    int Selector::addWrite(int fd) {
+        Branch branch;
+        branch.type = FD;
+        branch.fd = fd;
+        branch.event = IOManager::WRITE;
+        m_branches.push_back(std::move(branch));
+        return m_branches.size() - 1;
+    }
+
+    int Selector::addTimeout(uint64_t ms) {
+        Branch branch;
+        branch.type = TIMER;
+        branch.timeout = ms;
+        m_branches.push_back(std::move(branch));
+        return m_branches.size() - 1;
+    }
+
+    int Selector::addChannel(std::function<bool(const FiberWaiter::ptr&)> watch,
+                             std::function<void(const FiberWaiter::ptr&, bool)> unwatch) {
+        Branch branch;
+        branch.type = CHANNEL;
+        branch.watch = std::move(watch);
+        branch.unwatch = std::move(unwatch);
+        m_branches.push_back(std::move(branch));
+        return m_branches.size() - 1;
+    }
+
+    int Selector::wait() {
+        IOManager* iom = IOManager::GetThis();
+        if (m_branches.empty() || !iom || Fiber::GetThisRaw() == Scheduler::GetMainFiber()) {
+            errno = EINVAL;
+            return -1;
+        }
+        uint64_t start = GetCurrentMS();
+        while (true) {
+            std::shared_ptr<SelectState> state(new SelectState);
+            state->waiter.reset(new FiberWaiter("select"));
+            std::vector<Timer::ptr> timers(m_branches.size());
+            int result = -1;
+            int error = 0;
+            size_t armed = 0;
+            for (; armed < m_branches.size(); ++armed) {
+                Branch& branch = m_branches[armed];
+                int index = armed;
+                auto cb = [state, index]() {
+                    int expected = -1;
+                    if (state->fired.compare_exchange_strong(expected, index)) {
+                        state->waiter->notify();
+                    }
+                };
+                if (branch.type == FD) {
+                    if (iom->tryAddEvent(branch.fd, branch.event, cb, state.get())) {
+                        LOG_ERROR(g_logger) << "select addEvent(" << branch.fd << ", "
+                                            << branch.event << ") error";
+                        error = EINVAL;
+                        break;
+                    }
+                } else if (branch.type == TIMER) {
+                    uint64_t used = GetCurrentMS() - start;
+                    timers[armed] = iom->addTimer(branch.timeout > used ? branch.timeout - used : 0, cb);
+                } else if (branch.watch(state->waiter)) {
+                    result = armed;
+                    break;
+                }
+            }
+            if (result != -1 || error) {
+                // 没有挂起，已注册的分支可能已经触发过
+                state->waiter->cancel();
+            } else {
+                error = state->waiter->waitInterruptible();
+            }
+            if (!error && result == -1) {
+                result = state->fired;
+            }
+            // 被通道唤醒时找出就绪的通道，可能已被其它协程抢先取走
+            for (size_t i = 0; i < armed && !error && result == -1; ++i) {
+                if (m_branches[i].type == CHANNEL && m_branches[i].watch(nullptr)) {
+                    result = i;
+                }
+            }
+            for (size_t i = 0; i < armed; ++i) {
+                Branch& branch = m_branches[i];
+                if (branch.type == FD) {
+                    // 已触发的事件可能已被其它协程重新注册，只撤销仍属于本次 select 的
+                    iom->delEvent(branch.fd, branch.event, state.get());
+                } else if (branch.type == TIMER) {
+                    timers[i]->cancel();
+                } else {
+                    branch.unwatch(state->waiter, (int)i != result);
+                }
+            }
+            if (error) {
+                errno = error;
+                return -1;
+            }
+            if (result != -1) {
+                return result;
+            }
+        }
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <functional>
+#include "fibersync.h"
+#include "channel.h"
+#include "iomanager.h"
+#include "util.h"
+
+namespace svher {
+
+    // 同时等待多个 fd 事件、定时器与通道，任意一个就绪即唤醒当前协程并返回其下标，
+    // 其余分支在返回前撤销；每个分支的回调只会有一个生效，无需为每个来源单独起协程
+    // 同一 fd 的同一事件已有其它协程在等待时 wait 失败 (EINVAL)；返回时只撤销本次 select 仍持有的注册
+    // 通道分支只报告可收/可发，不取走数据，选中后应随即 tryRecv/trySend (被抢走时重新 select)
+    // 只能在 IOManager 的协程中使用
+    class Selector : Noncopyable {
+    public:
+        // 以下返回分支下标，从 0 开始按添加顺序递增
+        int addRead(int fd);
+        int addWrite(int fd);
+        // 每次 wait 从调用时刻起计时
+        int addTimeout(uint64_t ms);
+
+        template<class T>
+        int addRecv(Channel<T>& ch) {
+            return addChannel([&ch](const FiberWaiter::ptr& waiter) {
+                return ch.watchRecv(waiter);
+            }, [&ch](const FiberWaiter::ptr& waiter, bool pass) {
+                ch.unwatch(waiter, pass);
+            });
+        }
+
+        template<class T>
+        int addSend(Channel<T>& ch) {
+            return addChannel([&ch](const FiberWaiter::ptr& waiter) {
+                return ch.watchSend(waiter);
+            }, [&ch](const FiberWaiter::ptr& waiter, bool pass) {
+                ch.unwatch(waiter, pass);
+            });
+        }
+
+        // 挂起直到某个分支就绪，返回其下标
+        // 失败返回 -1: 截止时间到达或被取消时 errno 为 ETIMEDOUT/ECANCELED，
+        // 没有分支、不在 IOManager 中或注册 fd 事件失败时为 EINVAL
+        int wait();
+        void clear() { m_branches.clear(); }
+        size_t size() const { return m_branches.size(); }
+    private:
+        enum Type {
+            FD,
+            TIMER,
+            CHANNEL
+        };
+        struct Branch {
+            Type type;
+            int fd = -1;
+            IOManager::Event event = IOManager::NONE;
+            uint64_t timeout = 0;
+            // 就绪返回 true，否则挂入等待队列
+            std::function<bool(const FiberWaiter::ptr&)> watch;
+            std::function<void(const FiberWaiter::ptr&, bool)> unwatch;
+        };
+        int addChannel(std::function<bool(const FiberWaiter::ptr&)> watch,
+                       std::function<void(const FiberWaiter::ptr&, bool)> unwatch);
+        std::vector<Branch> m_branches;
+    };
+}
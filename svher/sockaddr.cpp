@@ -0,0 +1,197 @@
+#include "sockaddr.h"
+#include <arpa/inet.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+namespace svher {
+
+    const size_t SockAddr::MAX_STRING;
+
+    SockAddr::SockAddr(const sockaddr *addr, socklen_t len) {
+        if (!addr || len > sizeof(m_addr)) {
+            clear();
+            return;
+        }
+        memcpy(&m_addr, addr, len);
+        m_len = len;
+        // 填充字节不参与比较
+        if (m_addr.sa.sa_family == AF_INET && m_len >= sizeof(sockaddr_in)) {
+            memset(m_addr.v4.sin_zero, 0, sizeof(m_addr.v4.sin_zero));
+        }
+    }
+
+    SockAddr SockAddr::IPv4(uint32_t ip, uint16_t port) {
+        SockAddr rt;
+        memset(&rt.m_addr.v4, 0, sizeof(sockaddr_in));
+        rt.m_addr.v4.sin_family = AF_INET;
+        rt.m_addr.v4.sin_addr.s_addr = htonl(ip);
+        rt.m_addr.v4.sin_port = htons(port);
+        rt.m_len = sizeof(sockaddr_in);
+        return rt;
+    }
+
+    bool SockAddr::Parse(const char *ip, uint16_t port, SockAddr &out) {
+        SockAddr rt;
+        if (strchr(ip, ':')) {
+            memset(&rt.m_addr.v6, 0, sizeof(sockaddr_in6));
+            if (inet_pton(AF_INET6, ip, &rt.m_addr.v6.sin6_addr) != 1) {
+                return false;
+            }
+            rt.m_addr.v6.sin6_family = AF_INET6;
+            rt.m_addr.v6.sin6_port = htons(port);
+            rt.m_len = sizeof(sockaddr_in6);
+        } else {
+            memset(&rt.m_addr.v4, 0, sizeof(sockaddr_in));
+            if (inet_pton(AF_INET, ip, &rt.m_addr.v4.sin_addr) != 1) {
+                return false;
+            }
+            rt.m_addr.v4.sin_family = AF_INET;
+            rt.m_addr.v4.sin_port = htons(port);
+            rt.m_len = sizeof(sockaddr_in);
+        }
+        out = rt;
+        return true;
+    }
+
+    uint16_t SockAddr::getPort() const {
+        switch (getFamily()) {
+            case AF_INET:
+                return ntohs(m_addr.v4.sin_port);
+            case AF_INET6:
+                return ntohs(m_addr.v6.sin6_port);
+            default:
+                return 0;
+        }
+    }
+
+    void SockAddr::setPort(uint16_t v) {
+        switch (getFamily()) {
+            case AF_INET:
+                m_addr.v4.sin_port = htons(v);
+                break;
+            case AF_INET6:
+                m_addr.v6.sin6_port = htons(v);
+                break;
+            default:
+                break;
+        }
+    }
+
+    // 十进制写入 p，返回写入后的位置
+    static char* AppendUint(char* p, uint32_t v) {
+        char tmp[10];
+        int n = 0;
+        do {
+            tmp[n++] = '0' + v % 10;
+            v /= 10;
+        } while (v);
+        while (n) {
+            *p++ = tmp[--n];
+        }
+        return p;
+    }
+
+    size_t SockAddr::format(char *buf, size_t size) const {
+        if (!size) {
+            return 0;
+        }
+        // 先写到足够大的临时区再按 size 截断，IP 地址的常见路径没有任何库函数调用
+        char tmp[MAX_STRING];
+        char* p = tmp;
+        switch (getFamily()) {
+            case AF_INET: {
+                const uint8_t* b = (const uint8_t*)&m_addr.v4.sin_addr.s_addr;
+                for (int i = 0; i < 4; ++i) {
+                    if (i) {
+                        *p++ = '.';
+                    }
+                    p = AppendUint(p, b[i]);
+                }
+                break;
+            }
+            case AF_INET6:
+                *p++ = '[';
+                if (inet_ntop(AF_INET6, &m_addr.v6.sin6_addr, p, INET6_ADDRSTRLEN)) {
+                    p += strlen(p);
+                }
+                *p++ = ']';
+                break;
+            case AF_UNIX: {
+                size_t len = m_len > offsetof(sockaddr_un, sun_path) ? m_len - offsetof(sockaddr_un, sun_path) : 0;
+                const char* path = m_addr.un.sun_path;
+                // 抽象命名空间以 "\0" 开头
+                if (len && path[0] == '\0') {
+                    *p++ = '\\';
+                    *p++ = '0';
+                    ++path;
+                    --len;
+                } else {
+                    len = strnlen(path, len);
+                }
+                len = std::min(len, (size_t)(tmp + sizeof(tmp) - p - 1));
+                memcpy(p, path, len);
+                p += len;
+                break;
+            }
+            default: {
+                const char prefix[] = "[UnknownAddress family=";
+                memcpy(p, prefix, sizeof(prefix) - 1);
+                p = AppendUint(p + sizeof(prefix) - 1, getFamily());
+                *p++ = ']';
+                break;
+            }
+        }
+        uint16_t port = getPort();
+        if (port) {
+            *p++ = ':';
+            p = AppendUint(p, port);
+        }
+        size_t len = std::min((size_t)(p - tmp), size - 1);
+        memcpy(buf, tmp, len);
+        buf[len] = '\0';
+        return len;
+    }
+
+    std::string SockAddr::toString() const {
+        char buf[MAX_STRING];
+        size_t len = format(buf, sizeof(buf));
+        return std::string(buf, len);
+    }
+
+    size_t SockAddr::hash() const {
+        // FNV-1a
+        uint64_t h = 14695981039346656037ull;
+        const uint8_t* p = (const uint8_t*)&m_addr;
+        for (socklen_t i = 0; i < m_len; ++i) {
+            h ^= p[i];
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    Address::ptr SockAddr::toAddress() const {
+        switch (getFamily()) {
+            case AF_INET:
+            case AF_INET6:
+                return Address::Create(&m_addr.sa, m_len);
+            case AF_UNIX: {
+                UnixAddress::ptr addr(new UnixAddress());
+                memcpy(addr->getAddr(), &m_addr, m_len);
+                addr->setAddrLen(m_len);
+                return addr;
+            }
+            default:
+                return Address::ptr(new UnknownAddress(getFamily()));
+        }
+    }
+
+    bool SockAddr::operator==(const SockAddr &rhs) const {
+        return m_len == rhs.m_len && memcmp(&m_addr, &rhs.m_addr, m_len) == 0;
+    }
+
+    bool SockAddr::operator<(const SockAddr &rhs) const {
+        int ret = memcmp(&m_addr, &rhs.m_addr, std::min(m_len, rhs.m_len));
+        return ret < 0 || (ret == 0 && m_len < rhs.m_len);
+    }
+}
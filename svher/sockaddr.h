@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string>
+#include <functional>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include "address.h"
+
+namespace svher {
+
+    // 值类型的 socket 地址，内部为 sockaddr_storage 大小的 union，不分配内存、没有虚函数
+    // 用于 accept/recvFrom 等热路径，需要多态接口时再用 toAddress 转为 Address
+    // 相等与哈希按 getAddrLen 字节比较，可作为 unordered_map 的键
+    class SockAddr {
+    public:
+        // format 需要的最大缓冲区，含结尾 '\0'
+        static const size_t MAX_STRING = 128;
+
+        SockAddr() : m_len(0) { m_addr.sa.sa_family = AF_UNSPEC; }
+        SockAddr(const sockaddr* addr, socklen_t len);
+        explicit SockAddr(const Address& addr) : SockAddr(addr.getAddr(), addr.getAddrLen()) {}
+        // ip 为主机字节序
+        static SockAddr IPv4(uint32_t ip, uint16_t port);
+        // 只接受数字形式的 IPv4/IPv6 地址，失败时 out 不变
+        static bool Parse(const char* ip, uint16_t port, SockAddr& out);
+
+        bool empty() const { return m_len == 0; }
+        int getFamily() const { return m_len ? m_addr.sa.sa_family : AF_UNSPEC; }
+        const sockaddr* getAddr() const { return &m_addr.sa; }
+        sockaddr* getAddr() { return &m_addr.sa; }
+        socklen_t getAddrLen() const { return m_len; }
+        // 作为 accept/recvfrom 等的输出参数时先传 getAddr() 与 GetCapacity()，返回后 setAddrLen
+        static socklen_t GetCapacity() { return sizeof(sockaddr_storage); }
+        void setAddrLen(socklen_t v) { m_len = v > sizeof(sockaddr_storage) ? sizeof(sockaddr_storage) : v; }
+        void clear() { m_len = 0; m_addr.sa.sa_family = AF_UNSPEC; }
+        // 主机字节序，非 IP 地址返回 0
+        uint16_t getPort() const;
+        void setPort(uint16_t v);
+
+        // 与 Address::toString 格式相同 (IPv6 按 inet_ntop 压缩)，写入 buf 并以 '\0' 结尾，
+        // 返回不含 '\0' 的长度，空间不足时截断
+        size_t format(char* buf, size_t size) const;
+        std::string toString() const;
+        size_t hash() const;
+        Address::ptr toAddress() const;
+
+        bool operator==(const SockAddr& rhs) const;
+        bool operator!=(const SockAddr& rhs) const { return !(*this == rhs); }
+        bool operator<(const SockAddr& rhs) const;
+    private:
+        union {
+            sockaddr sa;
+            sockaddr_in v4;
+            sockaddr_in6 v6;
+            sockaddr_un un;
+            sockaddr_storage ss;
+        } m_addr;
+        socklen_t m_len;
+    };
+}
+
+namespace std {
+    template<>
+    struct hash<svher::SockAddr> {
+        size_t operator()(const svher::SockAddr& addr) const {
+            return addr.hash();
+        }
+    };
+}
@@ -1,6 +1,11 @@
 #include <netinet/tcp.h>
+#include <netinet/udp.h>
+#include <linux/errqueue.h>
 #include "socket.h"
+#include "udpbatch.h"
+#include "socketprofile.h"
 #include "log.h"
+#include "config.h"
 #include "fdmanager.h"
 #include "macro.h"
 #include "hook.h"
@@ -9,10 +14,20 @@ namespace svher {
 
     static Logger::ptr g_logger = LOG_NAME("sys");
 
+    static ConfigVar<uint32_t>::ptr g_zerocopy_threshold =
+            Config::Lookup<uint32_t>("socket.zerocopy_threshold", 16 * 1024,
+                                     "min bytes sent with MSG_ZEROCOPY, smaller sends are copied");
+
     Socket::Socket(int family, int type, int protocol) :
         m_sock(-1), m_family(family), m_type(type),
-        m_protocol(protocol), m_isConnected(false) {
+        m_protocol(protocol), m_isConnected(false),
+        m_profile(SocketProfile::GetDefaultName()) {
+
+    }
 
+    Socket::~Socket() {
+        // 析构时不等待在途的零拷贝发送，需要等待时先显式 close
+        doClose(false);
     }
 
     int64_t Socket::getSendTimeout() {
@@ -43,7 +58,9 @@ namespace svher {
     }
 
     bool Socket::getOption(int level, int option, void *result, size_t &len) {
-        int ret = ::getsockopt(m_sock, level, option, result, (socklen_t*)&len);
+        socklen_t length = len;
+        int ret = ::getsockopt(m_sock, level, option, result, &length);
+        len = length;
         if (ret) {
             LOG_DEBUG(g_logger) << "getOption sock=" << m_sock
                 << " level=" << level << " option=" << option
@@ -64,27 +81,62 @@ namespace svher {
         return true;
     }
 
+    bool Socket::setProfile(const std::string &name) {
+        SocketProfile profile;
+        if (!SocketProfile::Lookup(name, profile)) {
+            LOG_ERROR(g_logger) << "setProfile sock=" << m_sock << " unknown profile " << name;
+            return false;
+        }
+        m_profile = name;
+        if (isValid()) {
+            applyProfile(m_profileStages);
+        }
+        return true;
+    }
+
+    std::map<std::string, int> Socket::getEffectiveOptions() const {
+        if (!isValid()) {
+            return {};
+        }
+        return SocketProfile::GetEffective(m_sock, m_type);
+    }
+
+    void Socket::applyProfile(int stage) {
+        m_profileStages |= stage;
+        SocketProfile profile;
+        if (SocketProfile::Lookup(m_profile, profile)) {
+            profile.apply(m_sock, m_type, stage);
+        }
+        SocketProfile::Track(m_sock, m_profile, m_type, m_profileStages);
+    }
+
     Socket::ptr Socket::accept() {
         Socket::ptr sock(new Socket(m_family, m_type, m_protocol));
-        int newsock = ::accept(m_sock, nullptr, nullptr);
+        sock->m_profile = m_profile;
+        SockAddr peer;
+        socklen_t len = SockAddr::GetCapacity();
+        int newsock = ::accept(m_sock, peer.getAddr(), &len);
         if (newsock == -1) {
             LOG_ERROR(g_logger) << "accept(" << m_sock << ") errno="
                 << errno << " errstr=" << strerror(errno);
+        } else {
+            peer.setAddrLen(len);
         }
-        if (sock->init(newsock)) {
+        if (sock->init(newsock, peer)) {
             return sock;
         }
         return nullptr;
     }
 
-    bool Socket::init(int sock) {
+    bool Socket::init(int sock, const SockAddr& remote) {
         FdContext::ptr ctx = FdMgr::GetInstance()->get(sock);
         if (ctx && ctx->isSocket() && !ctx->isClosed()) {
             m_sock = sock;
             m_isConnected = true;
             initSock();
-            getLocalAddress();
-            getRemoteAddress();
+            applyProfile(SocketProfile::CREATE | SocketProfile::CONNECTED);
+            // 地址按需获取
+            m_remoteSockAddr = remote;
             return true;
         }
         return false;
@@ -109,7 +161,7 @@ namespace svher {
                 << " strerr=" << strerror(errno);
             return false;
         }
-        getLocalAddress();
+        getLocalSockAddr();
         return true;
     }
 
@@ -126,6 +178,7 @@ namespace svher {
                                 << ") not equal, addr=" << addr->toString();
             return false;
         }
+        applyProfile(SocketProfile::CONNECT);
         if (timeout_ms == (uint64_t)-1) {
             if (::connect(m_sock, addr->getAddr(), addr->getAddrLen())) {
                 LOG_ERROR(g_logger) << "sock=" << m_sock << " connect("
@@ -140,8 +193,9 @@ namespace svher {
             }
         }
         m_isConnected = true;
-        getRemoteAddress();
-        getLocalAddress();
+        applyProfile(SocketProfile::CONNECTED);
+        m_remoteSockAddr = SockAddr(*addr);
+        getLocalSockAddr();
         return true;
     }
 
@@ -150,6 +204,7 @@ namespace svher {
             LOG_ERROR(g_logger) << "listen error sock=-1";
             return false;
         }
+        applyProfile(SocketProfile::LISTEN);
         if(::listen(m_sock, backlog)) {
             LOG_ERROR(g_logger) << "listen error errno=" << errno
                 << " errstr=" << strerror(errno);
@@ -158,9 +213,28 @@ namespace svher {
     }
 
     bool Socket::close() {
+        return doClose(true);
+    }
+
+    bool Socket::doClose(bool flush) {
         if (!m_isConnected && m_sock == -1) return true;
         m_isConnected = false;
+        if (!m_zcPending.empty()) {
+            // 关闭后收不到完成通知，内核可能仍在发送这些页面
+            if (flush && IOManager::GetThis()) {
+                flushZeroCopy(1000);
+            } else {
+                reapZeroCopy();
+            }
+        }
+        if (!m_zcPending.empty()) {
+            LOG_WARN(g_logger) << "close sock=" << m_sock << " with "
+                << m_zcPending.size() << " zerocopy sends in flight";
+            m_zcPending.clear();
+        }
         if (m_sock != -1) {
+            SocketProfile::Untrack(m_sock);
+            m_profileStages = 0;
             ::close(m_sock);
             m_sock = -1;
         }
@@ -186,14 +260,14 @@ namespace svher {
     }
 
     int Socket::sendTo(const void *buffer, size_t length, const Address::ptr to, int flags) {
-        if (isConnected()) {
+        if (canTransfer()) {
             return ::sendto(m_sock, buffer, length, flags, to->getAddr(), to->getAddrLen());
         }
         return -1;
     }
 
     int Socket::sendTo(const iovec *buffers, int length, const Address::ptr to, int flags) {
-        if (isConnected()) {
+        if (canTransfer()) {
             msghdr msg;
             memset(&msg, 0, sizeof(msg));
             msg.msg_iov = (iovec*) buffers;
@@ -205,6 +279,213 @@ namespace svher {
         return -1;
     }
 
+    bool Socket::setZeroCopy(bool v) {
+        if (m_type != SOCK_STREAM || (m_family != AF_INET && m_family != AF_INET6)) {
+            return false;
+        }
+        if (!setOption(SOL_SOCKET, SO_ZEROCOPY, (int)v)) {
+            return false;
+        }
+        m_zeroCopy = v;
+        return true;
+    }
+
+    int Socket::sendZeroCopy(const void *buffer, size_t length, std::shared_ptr<void> hold, int flags) {
+        iovec iov;
+        iov.iov_base = (void*)buffer;
+        iov.iov_len = length;
+        return doSendZeroCopy(&iov, 1, length, hold, flags);
+    }
+
+    int Socket::sendZeroCopy(const iovec *buffers, size_t length, std::shared_ptr<void> hold, int flags) {
+        size_t total = 0;
+        for (size_t i = 0; i < length; ++i) {
+            total += buffers[i].iov_len;
+        }
+        return doSendZeroCopy(buffers, length, total, hold, flags);
+    }
+
+    int Socket::sendZeroCopy(ByteArray::ptr ba, size_t length, int flags) {
+        std::vector<iovec> iovs;
+        size_t total = ba->getReadBuffers(iovs, std::min(length, ba->getReadSize()));
+        if (iovs.empty()) {
+            return 0;
+        }
+        std::shared_ptr<void> hold = ba;
+        int ret = doSendZeroCopy(&iovs[0], iovs.size(), total, hold, flags);
+        if (ret > 0) {
+            ba->setPosition(ba->getPosition() + ret);
+        }
+        return ret;
+    }
+
+    int Socket::doSendZeroCopy(const iovec *buffers, size_t length, size_t total,
+                               std::shared_ptr<void>& hold, int flags) {
+        if (!isConnected()) {
+            return -1;
+        }
+        if (m_zeroCopy && !m_zcPending.empty()) {
+            reapZeroCopy();
+        }
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = (iovec*) buffers;
+        msg.msg_iovlen = length;
+        if (!m_zeroCopy || total < g_zerocopy_threshold->getValue()) {
+            return ::sendmsg(m_sock, &msg, flags);
+        }
+        int ret = ::sendmsg(m_sock, &msg, flags | MSG_ZEROCOPY);
+        if (ret < 0 && errno == ENOBUFS) {
+            // 在途通知超过 optmem 限制
+            reapZeroCopy();
+            return ::sendmsg(m_sock, &msg, flags);
+        }
+        if (ret > 0) {
+            m_zcPending[m_zcNext++] = std::move(hold);
+        }
+        return ret;
+    }
+
+    int Socket::reapZeroCopy() {
+        int released = 0;
+        char control[128];
+        while (!m_zcPending.empty()) {
+            msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+            // 错误队列总是立即返回，不经过 hook
+            if (recvmsg_f(m_sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+                break;
+            }
+            for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+                if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR)
+                      || (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))) {
+                    continue;
+                }
+                auto* serr = (sock_extended_err*)CMSG_DATA(cm);
+                if (serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY || serr->ee_errno != 0) {
+                    continue;
+                }
+                if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                    ++m_zcCopied;
+                }
+                // [ee_info, ee_data] 区间内的发送均已完成
+                for (uint32_t id = serr->ee_info; ; ++id) {
+                    released += m_zcPending.erase(id);
+                    if (id == serr->ee_data) break;
+                }
+            }
+        }
+        return released;
+    }
+
+    bool Socket::flushZeroCopy(uint64_t timeout_ms) {
+        uint64_t deadline = timeout_ms == (uint64_t)-1 ? -1 : GetCurrentMS() + timeout_ms;
+        while (true) {
+            reapZeroCopy();
+            if (m_zcPending.empty()) {
+                return true;
+            }
+            uint64_t now = GetCurrentMS();
+            if (now >= deadline || m_sock == -1) {
+                return false;
+            }
+            // 错误队列非空时 poll 返回 POLLERR，epoll 上则随 READ 事件唤醒
+            pollfd pfd;
+            pfd.fd = m_sock;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            int ret = ::poll(&pfd, 1, std::min<uint64_t>(deadline - now, 100));
+            if (ret > 0 && !(pfd.revents & POLLERR)) {
+                // 只是有数据可读，稍等再查，避免空转
+                usleep(1000);
+            } else if (ret < 0 && errno != EINTR) {
+                return false;
+            }
+        }
+    }
+
+    bool Socket::setGRO(bool v) {
+        if (m_type != SOCK_DGRAM) {
+            return false;
+        }
+        return setOption(SOL_UDP, UDP_GRO, (int)v);
+    }
+
+    int Socket::recvBatch(UdpBatch &batch, int flags) {
+        if (!canTransfer() || !batch.getCapacity()) {
+            return -1;
+        }
+        batch.prepareRecv();
+        int n = ::recvmmsg(m_sock, &batch.m_msgs[0], batch.getCapacity(), flags | MSG_WAITFORONE, nullptr);
+        if (n < 0) {
+            return -1;
+        }
+        batch.finishRecv(n);
+        return n;
+    }
+
+    int Socket::sendBatch(UdpBatch &batch, int flags) {
+        if (!canTransfer()) {
+            return -1;
+        }
+        size_t sent = 0;
+        int error = 0;
+        while (!batch.empty()) {
+            batch.prepareSend(0);
+            int n = ::sendmmsg(m_sock, &batch.m_msgs[0], batch.size(), flags);
+            if (n > 0) {
+                sent += n;
+                batch.consume(n);
+                continue;
+            }
+            error = n < 0 ? errno : EAGAIN;
+            // 内核或网卡不支持 UDP_SEGMENT 时拆开重发
+            if ((error == EIO || error == EINVAL) && batch.m_slots[0].segment
+                    && sendSegments(batch, flags)) {
+                continue;
+            }
+            break;
+        }
+        if (!sent && error) {
+            errno = error;
+            return -1;
+        }
+        return sent;
+    }
+
+    bool Socket::sendSegments(UdpBatch &batch, int flags) {
+        mmsghdr msgs[UdpBatch::MAX_SEGMENTS];
+        iovec iovs[UdpBatch::MAX_SEGMENTS];
+        bool progress = false;
+        // 最后一段留在槽位中，由 sendBatch 按普通报文发出并计数
+        while (batch.m_slots[0].segment) {
+            UdpBatch::Slot& slot = batch.m_slots[0];
+            char* data = &batch.m_buffer[0];
+            size_t count = 0;
+            for (size_t off = 0; off + slot.segment < slot.length; off += slot.segment) {
+                iovs[count].iov_base = data + off;
+                iovs[count].iov_len = slot.segment;
+                msghdr& hdr = msgs[count].msg_hdr;
+                memset(&hdr, 0, sizeof(hdr));
+                hdr.msg_name = slot.addrLen ? &slot.addr : nullptr;
+                hdr.msg_namelen = slot.addrLen;
+                hdr.msg_iov = &iovs[count];
+                hdr.msg_iovlen = 1;
+                msgs[count].msg_len = 0;
+                ++count;
+            }
+            int n = ::sendmmsg(m_sock, msgs, count, flags);
+            if (n <= 0) {
+                break;
+            }
+            progress = true;
+            batch.consumeSegments(0, n);
+        }
+        return progress;
+    }
+
     int Socket::recv(void *buffer, size_t length, int flags) {
         if (isConnected()) {
             return ::recv(m_sock, buffer, length, flags);
@@ -212,6 +493,74 @@ namespace svher {
         return -1;
     }
 
+    // 内核 SCM_MAX_FD，单条消息最多传递的 fd 数
+    static const size_t MAX_PASS_FDS = 253;
+
+    int Socket::sendFds(const int *fds, size_t count, const void *buffer, size_t length, int flags) {
+        if (!isConnected() || m_family != AF_UNIX || !count || count > MAX_PASS_FDS || !length) {
+            errno = EINVAL;
+            return -1;
+        }
+        std::vector<char> control(CMSG_SPACE(sizeof(int) * count), 0);
+        iovec iov;
+        iov.iov_base = (void*)buffer;
+        iov.iov_len = length;
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = &control[0];
+        msg.msg_controllen = control.size();
+        cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * count);
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * count);
+        return ::sendmsg(m_sock, &msg, flags | MSG_NOSIGNAL);
+    }
+
+    int Socket::recvFds(void *buffer, size_t length, std::vector<int> &fds, int flags) {
+        if (!isConnected() || m_family != AF_UNIX) {
+            errno = EINVAL;
+            return -1;
+        }
+        std::vector<char> control(CMSG_SPACE(sizeof(int) * MAX_PASS_FDS), 0);
+        iovec iov;
+        iov.iov_base = buffer;
+        iov.iov_len = length;
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = &control[0];
+        msg.msg_controllen = control.size();
+        int rt = ::recvmsg(m_sock, &msg, flags | MSG_CMSG_CLOEXEC);
+        if (rt < 0) {
+            return rt;
+        }
+        size_t begin = fds.size();
+        for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+                continue;
+            }
+            size_t n = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            const int* data = (const int*)CMSG_DATA(cmsg);
+            fds.insert(fds.end(), data, data + n);
+        }
+        if (msg.msg_flags & MSG_CTRUNC) {
+            for (size_t i = begin; i < fds.size(); ++i) {
+                close_f(fds[i]);
+            }
+            fds.resize(begin);
+            errno = EMSGSIZE;
+            return -1;
+        }
+        for (size_t i = begin; i < fds.size(); ++i) {
+            FdMgr::GetInstance()->get(fds[i], true);
+        }
+        return rt;
+    }
+
     int Socket::recv(iovec *buffers, size_t length, int flags) {
         if (isConnected()) {
             msghdr msg;
@@ -224,15 +573,34 @@ namespace svher {
     }
 
     int Socket::recvFrom(void *buffer, size_t length, Address::ptr from, int flags) {
-        if (isConnected()) {
-            socklen_t len;
+        if (canTransfer()) {
+            socklen_t len = from->getAddrLen();
             return ::recvfrom(m_sock, buffer, length, flags, from->getAddr(), &len);
         }
         return false;
     }
 
+    int Socket::sendTo(const void *buffer, size_t length, const SockAddr &to, int flags) {
+        if (canTransfer()) {
+            return ::sendto(m_sock, buffer, length, flags, to.getAddr(), to.getAddrLen());
+        }
+        return -1;
+    }
+
+    int Socket::recvFrom(void *buffer, size_t length, SockAddr &from, int flags) {
+        if (canTransfer()) {
+            socklen_t len = SockAddr::GetCapacity();
+            int rt = ::recvfrom(m_sock, buffer, length, flags, from.getAddr(), &len);
+            if (rt >= 0) {
+                from.setAddrLen(len);
+            }
+            return rt;
+        }
+        return -1;
+    }
+
     int Socket::recvFrom(iovec *buffers, size_t length, Address::ptr from, int flags) {
-        if (isConnected()) {
+        if (canTransfer()) {
             msghdr msg;
             memset(&msg, 0, sizeof(msg));
             msg.msg_iov = (iovec*) buffers;
@@ -248,66 +616,54 @@ namespace svher {
         if (m_remoteAddress) {
             return m_remoteAddress;
         }
-        Address::ptr result;
-        switch(m_family) {
-            case AF_INET:
-                result.reset(new IPv4Address());
-                break;
-            case AF_INET6:
-                result.reset(new IPv6Address());
-                break;
-            case AF_UNIX:
-                result.reset(new UnixAddress());
-                break;
-            default:
-                result.reset(new UnknownAddress(m_family));
-        }
-        socklen_t addrlen = result->getAddrLen();
-        if (getpeername(m_sock, result->getAddr(), &addrlen)) {
-            LOG_ERROR(g_logger) << "getpeername error sock=" << m_sock
-                << " errno" << errno << " errstr=" << strerror(errno);
+        const SockAddr& addr = getRemoteSockAddr();
+        if (addr.empty()) {
             return Address::ptr(new UnknownAddress(m_family));
         }
-        if (m_family == AF_UNIX) {
-            UnixAddress::ptr addr = std::dynamic_pointer_cast<UnixAddress>(result);
-            addr->setAddrLen(addrlen);
-        }
-        m_remoteAddress = result;
+        m_remoteAddress = addr.toAddress();
         return m_remoteAddress;
     }
 
     Address::ptr Socket::getLocalAddress() {
-        if (m_remoteAddress) {
-            return m_remoteAddress;
-        }
-        Address::ptr result;
-        switch(m_family) {
-            case AF_INET:
-                result.reset(new IPv4Address());
-                break;
-            case AF_INET6:
-                result.reset(new IPv6Address());
-                break;
-            case AF_UNIX:
-                result.reset(new UnixAddress());
-                break;
-            default:
-                result.reset(new UnknownAddress(m_family));
+        if (m_localAddress) {
+            return m_localAddress;
         }
-        socklen_t addrlen = result->getAddrLen();
-        if (getsockname(m_sock, result->getAddr(), &addrlen)) {
-            LOG_ERROR(g_logger) << "getsockname error sock=" << m_sock
-                                << " errno" << errno << " errstr=" << strerror(errno);
+        const SockAddr& addr = getLocalSockAddr();
+        if (addr.empty()) {
             return Address::ptr(new UnknownAddress(m_family));
         }
-        if (m_family == AF_UNIX) {
-            UnixAddress::ptr addr = std::dynamic_pointer_cast<UnixAddress>(result);
-            addr->setAddrLen(addrlen);
-        }
-        m_localAddress = result;
+        m_localAddress = addr.toAddress();
         return m_localAddress;
     }
 
+    const SockAddr& Socket::getRemoteSockAddr() {
+        if (m_remoteSockAddr.empty() && m_sock != -1) {
+            socklen_t len = SockAddr::GetCapacity();
+            if (getpeername(m_sock, m_remoteSockAddr.getAddr(), &len)) {
+                LOG_ERROR(g_logger) << "getpeername error sock=" << m_sock
+                    << " errno" << errno << " errstr=" << strerror(errno);
+                m_remoteSockAddr.clear();
+            } else {
+                m_remoteSockAddr.setAddrLen(len);
+            }
+        }
+        return m_remoteSockAddr;
+    }
+
+    const SockAddr& Socket::getLocalSockAddr() {
+        if (m_localSockAddr.empty() && m_sock != -1) {
+            socklen_t len = SockAddr::GetCapacity();
+            if (getsockname(m_sock, m_localSockAddr.getAddr(), &len)) {
+                LOG_ERROR(g_logger) << "getsockname error sock=" << m_sock
+                                    << " errno" << errno << " errstr=" << strerror(errno);
+                m_localSockAddr.clear();
+            } else {
+                m_localSockAddr.setAddrLen(len);
+            }
+        }
+        return m_localSockAddr;
+    }
+
     bool Socket::isValid() const {
         return m_sock != -1;
     }
@@ -326,12 +682,13 @@ namespace svher {
             << " is connected=" << m_isConnected
             << " family=" << m_family
             << " type=" << m_type
-            << " protocol=" << m_protocol;
-        if (m_localAddress) {
-            os << " local_address=" << m_localAddress->toString();
+            << " protocol=" << m_protocol
+            << " profile=" << m_profile;
+        if (!m_localSockAddr.empty()) {
+            os << " local_address=" << m_localSockAddr.toString();
         }
-        if (m_remoteAddress) {
-            os << " remote_address=" << m_remoteAddress->toString();
+        if (!m_remoteSockAddr.empty()) {
+            os << " remote_address=" << m_remoteSockAddr.toString();
         }
         return os;
     }
@@ -354,7 +711,7 @@ namespace svher {
 
     void Socket::initSock() {
         setOption(SOL_SOCKET, SO_REUSEADDR, 1);
-        if (m_type == SOCK_STREAM)
+        if (m_type == SOCK_STREAM && m_family != AF_UNIX)
             setOption(IPPROTO_TCP, TCP_NODELAY, 1);
 
     }
@@ -363,6 +720,7 @@ namespace svher {
         m_sock = socket(m_family, m_type, m_protocol);
         if (LIKELY_EXECUTED(m_sock != -1)) {
             initSock();
+            applyProfile(SocketProfile::CREATE);
         } else {
             LOG_ERROR(g_logger) << "socket(" << m_family
                 << "," << m_type << ", " << m_protocol
@@ -372,26 +730,58 @@ namespace svher {
 
     Socket::ptr Socket::CreateTCP(Address::ptr address) {
         Socket::ptr sock(new Socket(address->getFamily(), TCP, 0));
+        // 先创建 fd，bind 前可以设置 SO_REUSEPORT 等选项
+        sock->newSock();
         return sock;
     }
 
     Socket::ptr Socket::CreateUDP(Address::ptr address) {
         Socket::ptr sock(new Socket(address->getFamily(), UDP, 0));
+        // UDP 无需建立连接，创建后即可 sendTo/recvFrom
+        sock->newSock();
+        return sock;
+    }
+
+    Socket::ptr Socket::FromFd(int fd) {
+        int family = 0;
+        int type = 0;
+        int protocol = 0;
+        int listening = 0;
+        socklen_t len = sizeof(int);
+        if (getsockopt(fd, SOL_SOCKET, SO_DOMAIN, &family, &len)
+            || getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &len)
+            || getsockopt(fd, SOL_SOCKET, SO_PROTOCOL, &protocol, &len)
+            || getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &listening, &len)) {
+            LOG_ERROR(g_logger) << "FromFd(" << fd << ") errno=" << errno << " errstr=" << strerror(errno);
+            return nullptr;
+        }
+        FdContext::ptr ctx = FdMgr::GetInstance()->get(fd, true);
+        Socket::ptr sock(new Socket(family, type, protocol));
+        if (!listening) {
+            return sock->init(fd) ? sock : nullptr;
+        }
+        if (!ctx || !ctx->isSocket() || ctx->isClosed()) {
+            return nullptr;
+        }
+        sock->m_sock = fd;
+        sock->applyProfile(SocketProfile::CREATE | SocketProfile::LISTEN);
+        sock->getLocalSockAddr();
         return sock;
     }
 
     Socket::ptr Socket::CreateTCPSocket() {
-        Socket::ptr sock(new Socket(IPv4, UDP, 0));
+        Socket::ptr sock(new Socket(IPv4, TCP, 0));
         return sock;
     }
 
     Socket::ptr Socket::CreateUDPSocket() {
         Socket::ptr sock(new Socket(IPv4, UDP, 0));
+        sock->newSock();
         return sock;
     }
 
     Socket::ptr Socket::CreateUnixTCPSocket() {
-        Socket::ptr sock(new Socket(Unix, UDP, 0));
+        Socket::ptr sock(new Socket(Unix, TCP, 0));
         return sock;
     }
 
@@ -401,12 +791,13 @@ namespace svher {
     }
 
     Socket::ptr Socket::CreateTCPSocket6() {
-        Socket::ptr sock(new Socket(IPv6, UDP, 0));
+        Socket::ptr sock(new Socket(IPv6, TCP, 0));
         return sock;
     }
 
     Socket::ptr Socket::CreateUDPSocket6() {
         Socket::ptr sock(new Socket(IPv6, UDP, 0));
+        sock->newSock();
         return sock;
     }
 }
\ No newline at end of file
@@ -1,15 +1,22 @@
 #pragma once
 
 #include <memory>
+#include <map>
+#include <vector>
 #include "address.h"
+#include "sockaddr.h"
+#include "bytearray.h"
 #include "util.h"
 
 namespace svher {
+    class UdpBatch;
+
     class Socket : public std::enable_shared_from_this<Socket>, Noncopyable {
     public:
         typedef std::shared_ptr<Socket> ptr;
         typedef std::weak_ptr<Socket> weak_ptr;
         Socket(int family, int type, int protocol = 0);
+        ~Socket();
 
         enum Type {
             TCP = SOCK_STREAM,
@@ -33,6 +40,9 @@ namespace svher {
 
         static Socket::ptr CreateUnixTCPSocket();
         static Socket::ptr CreateUnixUDPSocket();
+        // 按 fd 的协议族和类型包装已有的 socket (如经 recvFds 收到)，并注册到 FdManager
+        // 处于监听状态的 fd 可直接 accept，其余视为已连接
+        static Socket::ptr FromFd(int fd);
 
         int64_t getSendTimeout();
         bool setSendTimeout(int64_t v);
@@ -44,7 +54,7 @@ namespace svher {
         template <class T>
         bool getOption(int level, int option, T& result) {
             size_t length = sizeof(T);
-            return getOption(level, option, &result, &length);
+            return getOption(level, option, &result, length);
         }
         bool setOption(int level, int option, const void* result, size_t len);
         template<class T>
@@ -52,24 +62,76 @@ namespace svher {
             return setOption(level, option, &value, sizeof(T));
         }
 
+        // 切换到配置 socket.profile 中的方案并立即应用已经过的阶段，方案不存在返回 false
+        // accept 得到的 socket 沿用监听 socket 的方案
+        bool setProfile(const std::string& name);
+        const std::string& getProfile() const { return m_profile; }
+        // 从内核读回的实际选项值
+        std::map<std::string, int> getEffectiveOptions() const;
+
+        // 对端地址取自 accept 的输出参数，不再额外 getpeername，也不创建 Address 对象
         Socket::ptr accept();
-        bool init(int sock);
+        // remote 为已知的对端地址 (如 accept4 得到的)，为空时按需 getpeername
+        bool init(int sock, const SockAddr& remote = SockAddr());
         bool bind(Address::ptr addr);
         bool connect(Address::ptr, uint64_t timeout_ms = -1);
         bool listen(int backlog = SOMAXCONN);
+        // 有在途的零拷贝发送时最多等待 1s 完成通知，析构只收取已到达的通知，不等待
         bool close();
 
         int send(const void* buffer, size_t length, int flags = 0);
         int send(const iovec* buffers, size_t length, int flags = 0);
         int sendTo(const void* buffer, size_t length, Address::ptr to, int flags = 0);
         int sendTo(const iovec* buffers, int length, Address::ptr to, int flags = 0);
+        int sendTo(const void* buffer, size_t length, const SockAddr& to, int flags = 0);
+        // 开启 SO_ZEROCOPY，内核或协议不支持时返回 false，此后 sendZeroCopy 按普通拷贝发送
+        bool setZeroCopy(bool v);
+        bool isZeroCopy() const { return m_zeroCopy; }
+        // 长度不小于 socket.zerocopy_threshold 时以 MSG_ZEROCOPY 发送，不拷贝到内核，
+        // hold 一直持有到内核通知释放对应页面，在此之前 buffer 不能被释放或改写
+        // 低于阈值、未开启或内核通知队列已满时退化为普通拷贝发送，hold 随即释放
+        int sendZeroCopy(const void* buffer, size_t length, std::shared_ptr<void> hold, int flags = 0);
+        int sendZeroCopy(const iovec* buffers, size_t length, std::shared_ptr<void> hold, int flags = 0);
+        // 从 ba 的当前位置最多发送 length 字节并前移读位置，在途期间持有 ba，不能 clear 或覆盖已发送部分
+        int sendZeroCopy(ByteArray::ptr ba, size_t length, int flags = 0);
+        // 从错误队列收取完成通知并释放对应的 hold，不阻塞，返回释放的个数
+        int reapZeroCopy();
+        // 等待所有在途的零拷贝发送完成，超时返回 false
+        // 通过 READ 事件等待通知，不能与同一 socket 上等待读的协程并发
+        bool flushZeroCopy(uint64_t timeout_ms = -1);
+        size_t getZeroCopyPending() const { return m_zcPending.size(); }
+        // 内核退化为拷贝的次数 (如回环地址)，持续增长说明零拷贝没有收益
+        uint64_t getZeroCopyCopied() const { return m_zcCopied; }
+
+        // 开启 UDP_GRO，内核把同一来源的连续报文合并后交给 recvBatch
+        bool setGRO(bool v);
+        // 一次系统调用收取多个报文，至少收到一个才返回，返回收到的槽位数
+        int recvBatch(UdpBatch& batch, int flags = 0);
+        // 发出 batch 中的报文，返回发出的槽位数，一个也没发出时返回 -1
+        // 发出的槽位从 batch 中移除，出错时未发出的槽位保留在 batch 中 (移到最前)，可以再次发送
+        // 内核或网卡拒绝 UDP_SEGMENT (EIO/EINVAL) 时，合并的槽位拆成单个报文重发
+        int sendBatch(UdpBatch& batch, int flags = 0);
+
+        // 经 SCM_RIGHTS 传递 fd，只用于 Unix socket，必须附带至少 1 字节数据，单次最多 253 个
+        // 对端收到的是指向同一打开文件的新 fd，发出后本端关闭不影响对端
+        int sendFds(const int* fds, size_t count, const void* buffer, size_t length, int flags = 0);
+        // 收到的 fd 带 FD_CLOEXEC 并已注册到 FdManager，追加到 fds；
+        // 控制信息被截断时关闭已收到的 fd 并返回 -1 (errno 为 EMSGSIZE)
+        int recvFds(void* buffer, size_t length, std::vector<int>& fds, int flags = 0);
+
         int recv(void* buffer, size_t length, int flags = 0);
         int recv(iovec* buffers, size_t length, int flags = 0);
         int recvFrom(void* buffer, size_t length, Address::ptr from, int flags = 0);
         int recvFrom(iovec* buffers, size_t length, Address::ptr from, int flags = 0);
+        // 来源地址写入 from，不分配内存
+        int recvFrom(void* buffer, size_t length, SockAddr& from, int flags = 0);
 
+        // 首次调用时由 SockAddr 创建并缓存
         Address::ptr getRemoteAddress();
         Address::ptr getLocalAddress();
+        // 未知时 getpeername/getsockname 一次并缓存，失败返回空地址
+        const SockAddr& getRemoteSockAddr();
+        const SockAddr& getLocalSockAddr();
 
         int getFamily() const { return m_family; }
         int getType() const { return m_type; }
@@ -87,15 +149,34 @@ namespace svher {
         bool cancelAccept();
         bool cancelAll();
     private:
+        bool doClose(bool flush);
         void initSock();
         void newSock();
+        // 已连接，或是已创建 fd 的数据报 socket (未连接也可 sendTo/recvFrom)
+        bool canTransfer() const { return m_isConnected || (m_type == SOCK_DGRAM && m_sock != -1); }
+        void applyProfile(int stage);
+        // 不带 UDP_SEGMENT 逐个发送 batch 首个槽位的分段，返回是否有进展
+        bool sendSegments(UdpBatch& batch, int flags);
+        int doSendZeroCopy(const iovec* buffers, size_t length, size_t total,
+                           std::shared_ptr<void>& hold, int flags);
         int m_sock;
         int m_family;
         int m_type;
         int m_protocol;
         bool m_isConnected;
 
+        SockAddr m_localSockAddr;
+        SockAddr m_remoteSockAddr;
         Address::ptr m_localAddress;
         Address::ptr m_remoteAddress;
+
+        std::string m_profile;
+        int m_profileStages = 0;
+
+        bool m_zeroCopy = false;
+        // 内核为每次成功的零拷贝发送依次分配的编号
+        uint32_t m_zcNext = 0;
+        uint64_t m_zcCopied = 0;
+        std::map<uint32_t, std::shared_ptr<void>> m_zcPending;
     };
 }
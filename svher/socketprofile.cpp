@@ -0,0 +1,211 @@
+#include "socketprofile.h"
+#include "config.h"
+#include "log.h"
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unordered_map>
+
+namespace svher {
+
+    static Logger::ptr g_logger = LOG_NAME("sys");
+
+    struct ProfileOption {
+        // 配置中的字段名
+        const char* key;
+        // GetEffective 中的选项名
+        const char* name;
+        int SocketProfile::* field;
+        int level;
+        int option;
+        int stages;
+        // 只设置 0/1
+        bool flag;
+    };
+
+    static const ProfileOption s_options[] = {
+#define XX(key, field, level, option, stages, flag) \
+        {key, #option, &SocketProfile::field, level, option, stages, flag},
+        XX("nodelay", nodelay, IPPROTO_TCP, TCP_NODELAY, SocketProfile::CREATE | SocketProfile::CONNECTED, true)
+        XX("quickack", quickack, IPPROTO_TCP, TCP_QUICKACK, SocketProfile::CONNECTED, true)
+        XX("sndbuf", sndbuf, SOL_SOCKET, SO_SNDBUF, SocketProfile::CREATE, false)
+        XX("rcvbuf", rcvbuf, SOL_SOCKET, SO_RCVBUF, SocketProfile::CREATE, false)
+        XX("notsent_lowat", notsentLowat, IPPROTO_TCP, TCP_NOTSENT_LOWAT, SocketProfile::CREATE | SocketProfile::CONNECTED, false)
+        XX("busy_poll", busyPoll, SOL_SOCKET, SO_BUSY_POLL, SocketProfile::CREATE | SocketProfile::CONNECTED, false)
+        XX("fastopen", fastopen, IPPROTO_TCP, TCP_FASTOPEN, SocketProfile::LISTEN, false)
+        XX("fastopen", fastopen, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, SocketProfile::CONNECT, true)
+        XX("defer_accept", deferAccept, IPPROTO_TCP, TCP_DEFER_ACCEPT, SocketProfile::LISTEN, false)
+        XX("keepalive", keepalive, SOL_SOCKET, SO_KEEPALIVE, SocketProfile::CREATE | SocketProfile::CONNECTED, true)
+        XX("keepidle", keepIdle, IPPROTO_TCP, TCP_KEEPIDLE, SocketProfile::CREATE | SocketProfile::CONNECTED, false)
+        XX("keepintvl", keepIntvl, IPPROTO_TCP, TCP_KEEPINTVL, SocketProfile::CREATE | SocketProfile::CONNECTED, false)
+        XX("keepcnt", keepCnt, IPPROTO_TCP, TCP_KEEPCNT, SocketProfile::CREATE | SocketProfile::CONNECTED, false)
+        XX("incoming_cpu", incomingCpu, SOL_SOCKET, SO_INCOMING_CPU, SocketProfile::CREATE | SocketProfile::CONNECTED, false)
+#undef XX
+    };
+
+    bool SocketProfile::operator==(const SocketProfile &oth) const {
+        for (auto& i : s_options) {
+            if (this->*i.field != oth.*i.field) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template<>
+    class LexicalCast<std::string, SocketProfile> {
+    public:
+        SocketProfile operator()(const std::string& v) {
+            YAML::Node node = YAML::Load(v);
+            SocketProfile profile;
+            for (auto& i : s_options) {
+                if (node[i.key].IsDefined()) {
+                    profile.*i.field = node[i.key].as<int>();
+                }
+            }
+            return profile;
+        }
+    };
+
+    template<>
+    class LexicalCast<SocketProfile, std::string> {
+    public:
+        std::string operator()(const SocketProfile& v) {
+            YAML::Node node(YAML::NodeType::Map);
+            for (auto& i : s_options) {
+                if (v.*i.field != -1) {
+                    node[i.key] = v.*i.field;
+                }
+            }
+            std::stringstream ss;
+            ss << node;
+            return ss.str();
+        }
+    };
+
+    static std::map<std::string, SocketProfile> DefaultProfiles() {
+        std::map<std::string, SocketProfile> profiles;
+        profiles["default"];
+        SocketProfile& lowlatency = profiles["lowlatency"];
+        lowlatency.nodelay = 1;
+        lowlatency.quickack = 1;
+        lowlatency.notsentLowat = 16 * 1024;
+        lowlatency.keepalive = 1;
+        SocketProfile& bulk = profiles["bulk"];
+        bulk.nodelay = 0;
+        bulk.sndbuf = 4 * 1024 * 1024;
+        bulk.rcvbuf = 4 * 1024 * 1024;
+        bulk.keepalive = 1;
+        return profiles;
+    }
+
+    static ConfigVar<std::map<std::string, SocketProfile>>::ptr g_socket_profiles =
+            Config::Lookup("socket.profile", DefaultProfiles(), "named socket option profiles");
+
+    static ConfigVar<std::string>::ptr g_socket_default_profile =
+            Config::Lookup<std::string>("socket.default_profile", "default", "profile applied to new sockets");
+
+    struct TrackedSocket {
+        std::string name;
+        int type;
+        int stages;
+    };
+
+    static Mutex& GetMutex() {
+        static Mutex s_mutex;
+        return s_mutex;
+    }
+
+    static std::unordered_map<int, TrackedSocket>& GetTracked() {
+        static std::unordered_map<int, TrackedSocket> s_tracked;
+        return s_tracked;
+    }
+
+    struct SocketProfileIniter {
+        SocketProfileIniter() {
+            g_socket_profiles->addListener([](const std::map<std::string, SocketProfile>& old_value,
+                                              const std::map<std::string, SocketProfile>& new_value) {
+                Mutex::Lock lock(GetMutex());
+                for (auto& i : GetTracked()) {
+                    auto it = new_value.find(i.second.name);
+                    if (it == new_value.end()) {
+                        continue;
+                    }
+                    auto old_it = old_value.find(i.second.name);
+                    if (old_it != old_value.end() && old_it->second == it->second) {
+                        continue;
+                    }
+                    it->second.apply(i.first, i.second.type, i.second.stages);
+                }
+            });
+        }
+    };
+
+    static SocketProfileIniter s_initer;
+
+    void SocketProfile::apply(int fd, int type, int stages) const {
+        for (auto& i : s_options) {
+            int value = this->*i.field;
+            if (value == -1 || !(i.stages & stages)) {
+                continue;
+            }
+            if (i.level == IPPROTO_TCP && type != SOCK_STREAM) {
+                continue;
+            }
+            if (i.flag) {
+                value = value ? 1 : 0;
+            }
+            if (setsockopt(fd, i.level, i.option, &value, sizeof(value))) {
+                LOG_DEBUG(g_logger) << "socket profile sock=" << fd << " " << i.name
+                                    << "=" << value << " errno=" << errno
+                                    << " errstr=" << strerror(errno);
+            }
+        }
+    }
+
+    bool SocketProfile::Lookup(const std::string &name, SocketProfile &profile) {
+        auto profiles = g_socket_profiles->getValue();
+        auto it = profiles.find(name);
+        if (it == profiles.end()) {
+            return false;
+        }
+        profile = it->second;
+        return true;
+    }
+
+    std::string SocketProfile::GetDefaultName() {
+        return g_socket_default_profile->getValue();
+    }
+
+    std::map<std::string, SocketProfile> SocketProfile::GetProfiles() {
+        return g_socket_profiles->getValue();
+    }
+
+    void SocketProfile::Track(int fd, const std::string &name, int type, int stages) {
+        Mutex::Lock lock(GetMutex());
+        TrackedSocket& tracked = GetTracked()[fd];
+        tracked.name = name;
+        tracked.type = type;
+        tracked.stages = stages;
+    }
+
+    void SocketProfile::Untrack(int fd) {
+        Mutex::Lock lock(GetMutex());
+        GetTracked().erase(fd);
+    }
+
+    std::map<std::string, int> SocketProfile::GetEffective(int fd, int type) {
+        std::map<std::string, int> rt;
+        for (auto& i : s_options) {
+            if (i.level == IPPROTO_TCP && type != SOCK_STREAM) {
+                continue;
+            }
+            int value = 0;
+            socklen_t len = sizeof(value);
+            if (getsockopt(fd, i.level, i.option, &value, &len) == 0) {
+                rt[i.name] = value;
+            }
+        }
+        return rt;
+    }
+}
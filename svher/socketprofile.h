@@ -0,0 +1,58 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+namespace svher {
+
+    // 配置 socket.profile 中的一套 socket 选项，-1 表示不设置，保留系统默认值
+    // socket 在创建、listen、connect 前后和 accept 时按阶段应用所属方案，
+    // 配置变化时重新应用到使用该方案的所有 socket 上；从方案中删掉的选项保持原值
+    struct SocketProfile {
+        enum Stage {
+            CREATE = 1,
+            LISTEN = 2,
+            // connect 之前
+            CONNECT = 4,
+            // 连接建立之后 (包括 accept 得到的 socket)
+            CONNECTED = 8
+        };
+
+        int nodelay = -1;
+        // 内核会在之后自动关闭，只在连接建立时设置一次
+        int quickack = -1;
+        int sndbuf = -1;
+        int rcvbuf = -1;
+        int notsentLowat = -1;
+        // 微秒，调高需要 CAP_NET_ADMIN
+        int busyPoll = -1;
+        // 监听端为 TFO 队列长度，客户端非 0 时开启 TCP_FASTOPEN_CONNECT
+        int fastopen = -1;
+        // 秒
+        int deferAccept = -1;
+        int keepalive = -1;
+        int keepIdle = -1;
+        int keepIntvl = -1;
+        int keepCnt = -1;
+        int incomingCpu = -1;
+
+        bool operator==(const SocketProfile& oth) const;
+        bool operator!=(const SocketProfile& oth) const { return !(*this == oth); }
+
+        // 设置适用于 stages 的选项，type 不是 SOCK_STREAM 时跳过 TCP 选项
+        void apply(int fd, int type, int stages) const;
+
+        // 查找配置中的方案，不存在返回 false
+        static bool Lookup(const std::string& name, SocketProfile& profile);
+        // 新建 socket 使用的方案，配置 socket.default_profile
+        static std::string GetDefaultName();
+        static std::map<std::string, SocketProfile> GetProfiles();
+
+        // 记录 fd 使用的方案和已经过的阶段，方案变化时按这些阶段重新应用
+        static void Track(int fd, const std::string& name, int type, int stages);
+        // 必须在 close(fd) 之前调用
+        static void Untrack(int fd);
+        // 从 fd 上读回的实际值，以选项名为 key
+        static std::map<std::string, int> GetEffective(int fd, int type);
+    };
+}
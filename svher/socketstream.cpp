@@ -0,0 +1,179 @@
+#include "socketstream.h"
+#include "config.h"
+#include <cstring>
+#include <climits>
+
+namespace svher {
+
+    static ConfigVar<uint32_t>::ptr g_stream_read_buffer =
+            Config::Lookup<uint32_t>("stream.read_buffer", 16 * 1024, "socket stream read ahead bytes");
+
+    static ConfigVar<uint32_t>::ptr g_stream_write_buffer =
+            Config::Lookup<uint32_t>("stream.write_buffer", 16 * 1024, "socket stream bytes buffered before send");
+
+    SocketStream::SocketStream(Socket::ptr sock, bool owner)
+        : m_socket(sock), m_owner(owner),
+          m_rbuf(g_stream_read_buffer->getValue()),
+          m_writeBufferSize(g_stream_write_buffer->getValue()),
+          m_wbuf(new ByteArray(std::max<size_t>(m_writeBufferSize, 4096))) {
+    }
+
+    SocketStream::~SocketStream() {
+        if (m_socket) {
+            flush();
+            if (m_owner) {
+                m_socket->close();
+            }
+        }
+    }
+
+    void SocketStream::setReadBufferSize(size_t v) {
+        // 已预读的数据保留
+        size_t buffered = getReadBuffered();
+        std::vector<char> buf(std::max(v, buffered));
+        memcpy(buf.data(), m_rbuf.data() + m_rpos, buffered);
+        m_rbuf.swap(buf);
+        m_rpos = 0;
+        m_rend = buffered;
+    }
+
+    int SocketStream::read(void *buffer, size_t length) {
+        if (!isConnected()) {
+            return -1;
+        }
+        if (m_rpos == m_rend) {
+            if (flush()) {
+                return -1;
+            }
+            ++m_readCalls;
+            if (length >= m_rbuf.size()) {
+                return m_socket->recv(buffer, length);
+            }
+            int rt = m_socket->recv(&m_rbuf[0], m_rbuf.size());
+            if (rt <= 0) {
+                return rt;
+            }
+            m_rpos = 0;
+            m_rend = rt;
+        }
+        size_t n = std::min(length, m_rend - m_rpos);
+        memcpy(buffer, &m_rbuf[m_rpos], n);
+        m_rpos += n;
+        return n;
+    }
+
+    int SocketStream::read(ByteArray::ptr ba, size_t length) {
+        if (!isConnected()) {
+            return -1;
+        }
+        if (m_rpos != m_rend) {
+            size_t n = std::min(length, m_rend - m_rpos);
+            ba->write(&m_rbuf[m_rpos], n);
+            m_rpos += n;
+            return n;
+        }
+        if (flush()) {
+            return -1;
+        }
+        std::vector<iovec> iovs;
+        ba->getWriteBuffers(iovs, length);
+        // 只提交实际读到的部分，多余的节点留给下次
+        if (iovs.size() > IOV_MAX) {
+            iovs.resize(IOV_MAX);
+        }
+        ++m_readCalls;
+        int rt = m_socket->recv(&iovs[0], iovs.size());
+        if (rt > 0) {
+            ba->commitWrite(rt);
+        }
+        return rt;
+    }
+
+    int SocketStream::write(const void *buffer, size_t length) {
+        if (!isConnected()) {
+            return -1;
+        }
+        if (m_wbuf->getSize() + length < m_writeBufferSize) {
+            m_wbuf->write(buffer, length);
+            return length;
+        }
+        // 缓冲满了，缓冲的节点和本次数据一起发出，本次数据不再拷贝
+        std::vector<iovec> iovs;
+        m_wbuf->getReadBuffers(iovs, m_wbuf->getSize(), 0);
+        iovec iov;
+        iov.iov_base = (void*)buffer;
+        iov.iov_len = length;
+        iovs.push_back(iov);
+        int rt = sendAll(iovs);
+        m_wbuf->reset();
+        return rt ? rt : length;
+    }
+
+    int SocketStream::write(ByteArray::ptr ba, size_t length) {
+        if (!isConnected()) {
+            return -1;
+        }
+        length = std::min(length, ba->getReadSize());
+        std::vector<iovec> iovs;
+        if (m_wbuf->getSize() + length < m_writeBufferSize) {
+            ba->getReadBuffers(iovs, length);
+            for (auto& i : iovs) {
+                m_wbuf->write(i.iov_base, i.iov_len);
+            }
+            ba->setPosition(ba->getPosition() + length);
+            return length;
+        }
+        m_wbuf->getReadBuffers(iovs, m_wbuf->getSize(), 0);
+        ba->getReadBuffers(iovs, length);
+        int rt = sendAll(iovs);
+        m_wbuf->reset();
+        if (rt) {
+            return rt;
+        }
+        ba->setPosition(ba->getPosition() + length);
+        return length;
+    }
+
+    int SocketStream::flush() {
+        if (!m_wbuf->getSize()) {
+            return 0;
+        }
+        std::vector<iovec> iovs;
+        m_wbuf->getReadBuffers(iovs, m_wbuf->getSize(), 0);
+        int rt = sendAll(iovs);
+        m_wbuf->reset();
+        return rt;
+    }
+
+    int SocketStream::sendAll(std::vector<iovec> &iovs) {
+        size_t begin = 0;
+        while (begin < iovs.size()) {
+            ++m_writeCalls;
+            int rt = m_socket->send(&iovs[begin], std::min<size_t>(iovs.size() - begin, IOV_MAX));
+            if (rt <= 0) {
+                return rt ? rt : -1;
+            }
+            // 跳过已发出的部分
+            size_t n = rt;
+            while (begin < iovs.size() && n >= iovs[begin].iov_len) {
+                n -= iovs[begin].iov_len;
+                ++begin;
+            }
+            if (n) {
+                iovs[begin].iov_base = (char*)iovs[begin].iov_base + n;
+                iovs[begin].iov_len -= n;
+            }
+        }
+        return 0;
+    }
+
+    void SocketStream::close() {
+        if (!m_socket) {
+            return;
+        }
+        flush();
+        if (m_owner) {
+            m_socket->close();
+        }
+    }
+}
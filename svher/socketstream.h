@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+#include "stream.h"
+#include "socket.h"
+
+namespace svher {
+
+    // 带读写缓冲的 Socket 流
+    // 读: 缓冲为空时一次 recv 预读最多 stream.read_buffer 字节，之后的小块读取直接从缓冲拷贝；
+    //     缓冲为空且读取量不小于缓冲大小时直接读入调用方内存，ByteArray 则经 getWriteBuffers 读入其节点
+    // 写: 小块数据先攒在 ByteArray 中，攒满 stream.write_buffer、需要等待对端数据之前或 flush/close 时
+    //     把缓冲节点和当前数据用一次 sendmsg 发出
+    // 进入缓冲的 write 直接返回 length，发送失败由随后的 flush 或读操作返回
+    class SocketStream : public Stream {
+    public:
+        typedef std::shared_ptr<SocketStream> ptr;
+        // owner 为 true 时 close 和析构会关闭 socket
+        SocketStream(Socket::ptr sock, bool owner = true);
+        ~SocketStream() override;
+
+        int read(void* buffer, size_t length) override;
+        int read(ByteArray::ptr ba, size_t length) override;
+        int write(const void* buffer, size_t length) override;
+        int write(ByteArray::ptr ba, size_t length) override;
+        void close() override;
+        // 发出写缓冲中的全部数据，成功返回 0
+        int flush();
+
+        // 设为 0 关闭对应的缓冲
+        void setReadBufferSize(size_t v);
+        void setWriteBufferSize(size_t v) { m_writeBufferSize = v; }
+
+        Socket::ptr getSocket() const { return m_socket; }
+        bool isConnected() const { return m_socket && m_socket->isConnected(); }
+        size_t getReadBuffered() const { return m_rend - m_rpos; }
+        size_t getWriteBuffered() const { return m_wbuf->getSize(); }
+        // 实际发生的 recv/send 调用次数
+        uint64_t getReadCalls() const { return m_readCalls; }
+        uint64_t getWriteCalls() const { return m_writeCalls; }
+    private:
+        // 发出 iovs 中的全部数据，返回 0 表示成功
+        int sendAll(std::vector<iovec>& iovs);
+        Socket::ptr m_socket;
+        bool m_owner;
+        std::vector<char> m_rbuf;
+        size_t m_rpos = 0;
+        size_t m_rend = 0;
+        size_t m_writeBufferSize;
+        ByteArray::ptr m_wbuf;
+        uint64_t m_readCalls = 0;
+        uint64_t m_writeCalls = 0;
+    };
+}
@@ -0,0 +1,150 @@
+#include "stackprofile.h"
+#include "fiber.h"
+#include "config.h"
+#include "thread.h"
+#include <cxxabi.h>
+#include <execinfo.h>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <sstream>
+
+namespace svher {
+
+    static ConfigVar<bool>::ptr g_stack_profile =
+            Config::Lookup<bool>("fiber.stack_profile", false, "paint fiber stacks and record high water marks");
+
+    static const uint64_t STACK_PATTERN = 0xa5a5a5a5a5a5a5a5ul;
+
+    std::atomic<bool> StackProfile::s_enabled{false};
+
+    struct SiteData {
+        uint64_t count = 0;
+        uint64_t maxUsed = 0;
+        uint64_t totalUsed = 0;
+        uint32_t stackSize = 0;
+    };
+
+    typedef std::pair<const std::type_info*, void*> SiteKey;
+
+    static Mutex& GetMutex() {
+        static Mutex s_mutex;
+        return s_mutex;
+    }
+
+    static std::map<SiteKey, SiteData>& GetDatas() {
+        static std::map<SiteKey, SiteData> s_datas;
+        return s_datas;
+    }
+
+    struct StackProfileIniter {
+        StackProfileIniter() {
+            StackProfile::SetEnabled(g_stack_profile->getValue());
+            g_stack_profile->addListener([](const bool& old_value, const bool& new_value) {
+                StackProfile::SetEnabled(new_value);
+            });
+        }
+    };
+
+    static StackProfileIniter s_initer;
+
+    static std::string SiteName(const SiteKey& key) {
+        if (key.second) {
+            char** symbols = backtrace_symbols(const_cast<void**>(&key.second), 1);
+            if (symbols) {
+                std::string name = symbols[0];
+                free(symbols);
+                return name;
+            }
+        }
+        if (!key.first) {
+            return "unknown";
+        }
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(key.first->name(), nullptr, nullptr, &status);
+        std::string name = status == 0 ? demangled : key.first->name();
+        free(demangled);
+        return name;
+    }
+
+    void StackProfile::Paint(void* stack, size_t size) {
+        uint64_t* p = (uint64_t*)stack;
+        for (size_t i = 0; i < size / sizeof(uint64_t); ++i) {
+            p[i] = STACK_PATTERN;
+        }
+    }
+
+    size_t StackProfile::Measure(const void* stack, size_t size) {
+        const uint64_t* p = (const uint64_t*)stack;
+        size_t n = size / sizeof(uint64_t);
+        size_t i = 0;
+        while (i < n && p[i] == STACK_PATTERN) {
+            ++i;
+        }
+        return size - i * sizeof(uint64_t);
+    }
+
+    void StackProfile::Record(const std::type_info* type, void* fn, size_t used, size_t stack_size) {
+        Mutex::Lock lock(GetMutex());
+        SiteData& data = GetDatas()[SiteKey(type, fn)];
+        ++data.count;
+        data.totalUsed += used;
+        data.maxUsed = std::max<uint64_t>(data.maxUsed, used);
+        data.stackSize = std::max<uint32_t>(data.stackSize, stack_size);
+    }
+
+    std::vector<StackSiteStats> StackProfile::GetSites() {
+        std::vector<std::pair<SiteKey, SiteData>> datas;
+        {
+            Mutex::Lock lock(GetMutex());
+            datas.assign(GetDatas().begin(), GetDatas().end());
+        }
+        std::vector<std::pair<std::string, uint32_t>> classes;
+        for (auto& i : Fiber::GetStackClasses()) {
+            classes.push_back(i);
+        }
+        std::sort(classes.begin(), classes.end(), [](const std::pair<std::string, uint32_t>& a,
+                                                     const std::pair<std::string, uint32_t>& b) {
+            return a.second < b.second;
+        });
+        std::vector<StackSiteStats> rt;
+        for (auto& i : datas) {
+            StackSiteStats stats;
+            stats.site = SiteName(i.first);
+            stats.count = i.second.count;
+            stats.maxUsed = i.second.maxUsed;
+            stats.totalUsed = i.second.totalUsed;
+            stats.stackSize = i.second.stackSize;
+            for (auto& c : classes) {
+                if (c.second >= stats.maxUsed * 2) {
+                    stats.suggest = c.first;
+                    break;
+                }
+            }
+            rt.push_back(stats);
+        }
+        std::sort(rt.begin(), rt.end(), [](const StackSiteStats& a, const StackSiteStats& b) {
+            return a.maxUsed > b.maxUsed;
+        });
+        return rt;
+    }
+
+    void StackProfile::Clear() {
+        Mutex::Lock lock(GetMutex());
+        GetDatas().clear();
+    }
+
+    std::string StackProfile::Dump() {
+        std::stringstream ss;
+        for (auto& i : GetSites()) {
+            ss << i.site
+               << " count=" << i.count
+               << " max=" << i.maxUsed
+               << " avg=" << i.totalUsed / i.count
+               << " stack=" << i.stackSize
+               << " suggest=" << (i.suggest.empty() ? "none" : i.suggest)
+               << std::endl;
+        }
+        return ss.str();
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <typeinfo>
+#include "util.h"
+
+namespace svher {
+
+    // 一个调度点的协程栈使用统计，单位为字节
+    struct StackSiteStats {
+        std::string site;
+        uint64_t count = 0;
+        uint64_t maxUsed = 0;
+        uint64_t totalUsed = 0;
+        // 该调度点用过的最大栈
+        uint32_t stackSize = 0;
+        // 最大用量两倍以内能装下的最小栈规格
+        std::string suggest;
+    };
+
+    // 协程栈水位统计，由配置 fiber.stack_profile 开启
+    // 开启后分配或复用协程栈时先填充固定字节，协程结束时从栈底扫描仍未被改写的部分得到最高水位，
+    // 按回调的类型 (函数指针则按函数地址) 区分调度点汇总
+    // 填充会让整个栈都驻留在物理内存中，只用于采样分析
+    class StackProfile {
+    public:
+        static bool IsEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+        static void SetEnabled(bool v) { s_enabled = v; }
+
+        // 填充 [stack, stack + size)
+        static void Paint(void* stack, size_t size);
+        // 返回从栈顶算起被改写过的字节数
+        static size_t Measure(const void* stack, size_t size);
+        static void Record(const std::type_info* type, void* fn, size_t used, size_t stack_size);
+
+        static std::vector<StackSiteStats> GetSites();
+        static void Clear();
+        // 按最大用量从高到低，每行一个调度点
+        static std::string Dump();
+    private:
+        static std::atomic<bool> s_enabled;
+    };
+}
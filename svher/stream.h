@@ -0,0 +1,28 @@
+#pragma once
+
+#include <memory>
+#include "bytearray.h"
+
+namespace svher {
+
+    // 字节流接口，read/write 返回实际读写的字节数，0 表示对端关闭，负数表示出错
+    // ByteArray 版本从其当前位置读写并前移位置
+    class Stream {
+    public:
+        typedef std::shared_ptr<Stream> ptr;
+        virtual ~Stream() {}
+
+        virtual int read(void* buffer, size_t length) = 0;
+        virtual int read(ByteArray::ptr ba, size_t length) = 0;
+        // 读满 length 字节才返回，中途出错或对端关闭时返回该次的结果
+        virtual int readFixSize(void* buffer, size_t length);
+        virtual int readFixSize(ByteArray::ptr ba, size_t length);
+
+        virtual int write(const void* buffer, size_t length) = 0;
+        virtual int write(ByteArray::ptr ba, size_t length) = 0;
+        virtual int writeFixSize(const void* buffer, size_t length);
+        virtual int writeFixSize(ByteArray::ptr ba, size_t length);
+
+        virtual void close() = 0;
+    };
+}
@@ -0,0 +1,240 @@
+#include "tcpserver.h"
+#include "config.h"
+#include "fdmanager.h"
+#include "hook.h"
+#include "log.h"
+
+namespace svher {
+
+    static Logger::ptr g_logger = LOG_NAME("sys");
+
+    static ConfigVar<uint64_t>::ptr g_tcp_server_read_timeout =
+            Config::Lookup<uint64_t>("tcp_server.read_timeout", 60 * 1000 * 2, "tcp server read timeout");
+
+    static ConfigVar<uint32_t>::ptr g_tcp_server_accept_batch =
+            Config::Lookup<uint32_t>("tcp_server.accept_batch", 64, "max connections accepted per wakeup");
+
+    TcpServer::TcpServer(IOManager *worker, IOManager *acceptor)
+        : m_recvTimeout(g_tcp_server_read_timeout->getValue()) {
+        m_workers.push_back(worker);
+        m_acceptors.push_back(acceptor);
+    }
+
+    TcpServer::~TcpServer() {
+        stop();
+    }
+
+    bool TcpServer::bind(Address::ptr addr, size_t listeners) {
+        std::vector<Address::ptr> addrs;
+        std::vector<Address::ptr> fails;
+        addrs.push_back(addr);
+        return bind(addrs, fails, listeners);
+    }
+
+    bool TcpServer::bind(const std::vector<Address::ptr> &addrs, std::vector<Address::ptr> &fails,
+                         size_t listeners) {
+        if (!listeners) {
+            listeners = 1;
+        }
+        for (auto& addr : addrs) {
+            std::vector<Socket::ptr> socks;
+            for (size_t i = 0; i < listeners; ++i) {
+                Socket::ptr sock = Socket::CreateTCP(addr);
+                if (!m_profile.empty()) {
+                    sock->setProfile(m_profile);
+                }
+                if (listeners > 1 && !sock->setOption(SOL_SOCKET, SO_REUSEPORT, 1)) {
+                    LOG_ERROR(g_logger) << "set SO_REUSEPORT fail errno=" << errno
+                                        << " errstr=" << strerror(errno) << " addr=" << addr->toString();
+                    break;
+                }
+                // 端口为 0 时其余分片绑定到第一个分配到的端口
+                Address::ptr bind_addr = socks.empty() ? addr : socks[0]->getLocalAddress();
+                if (!sock->bind(bind_addr)) {
+                    LOG_ERROR(g_logger) << "bind fail errno=" << errno
+                                        << " errstr=" << strerror(errno) << " addr=" << addr->toString();
+                    break;
+                }
+                if (!sock->listen()) {
+                    LOG_ERROR(g_logger) << "listen fail errno=" << errno
+                                        << " errstr=" << strerror(errno) << " addr=" << addr->toString();
+                    break;
+                }
+                socks.push_back(sock);
+            }
+            if (socks.size() != listeners) {
+                fails.push_back(addr);
+                continue;
+            }
+            for (auto& sock : socks) {
+                m_socks.push_back(sock);
+                m_shared.push_back(listeners == 1);
+            }
+        }
+        if (!fails.empty()) {
+            return false;
+        }
+        for (auto& i : m_socks) {
+            LOG_INFO(g_logger) << "server " << m_name << " bind success: " << i->getLocalAddress()->toString();
+        }
+        return true;
+    }
+
+    bool TcpServer::addListener(Socket::ptr sock, bool shared) {
+        if (!sock || !sock->isValid()) {
+            return false;
+        }
+        int listening = 0;
+        if (!sock->getOption(SOL_SOCKET, SO_ACCEPTCONN, listening) || !listening) {
+            LOG_ERROR(g_logger) << "addListener sock=" << sock->getSocket() << " is not listening";
+            return false;
+        }
+        m_socks.push_back(sock);
+        m_shared.push_back(shared);
+        LOG_INFO(g_logger) << "server " << m_name << " add listener: " << sock->getLocalAddress()->toString();
+        return true;
+    }
+
+    bool TcpServer::start() {
+        if (!m_isStop) {
+            return true;
+        }
+        if (m_socks.empty() || m_workers.empty() || m_acceptors.empty()) {
+            return false;
+        }
+        {
+            Mutex::Lock lock(m_mutex);
+            m_isClosing = false;
+        }
+        m_isStop = false;
+        m_waits.clear();
+        size_t shard = 0;
+        for (size_t i = 0; i < m_socks.size(); ++i) {
+            Socket::ptr sock = m_socks[i];
+            if (m_shared[i]) {
+                bool exclusive = m_acceptors.size() > 1;
+                for (auto iom : m_acceptors) {
+                    m_waits.emplace_back(iom, sock->getSocket());
+                    iom->schedule(std::bind(&TcpServer::startAccept, shared_from_this(), sock, iom, exclusive));
+                }
+            } else {
+                IOManager* iom = m_acceptors[shard++ % m_acceptors.size()];
+                m_waits.emplace_back(iom, sock->getSocket());
+                iom->schedule(std::bind(&TcpServer::startAccept, shared_from_this(), sock, iom, false));
+            }
+        }
+        return true;
+    }
+
+    void TcpServer::stopAccept() {
+        if (m_isStop.exchange(true)) {
+            return;
+        }
+        // 监听协程注册等待后会再检查 m_isStop，这里取消的一定是已经注册的等待
+        for (auto& i : m_waits) {
+            i.first->cancelEvent(i.second, IOManager::READ);
+        }
+    }
+
+    void TcpServer::stop() {
+        stopAccept();
+        Mutex::Lock lock(m_mutex);
+        m_isClosing = true;
+        for (auto client : m_clients) {
+            ::shutdown(client->getSocket(), SHUT_RDWR);
+        }
+    }
+
+    size_t TcpServer::getConnectionCount() {
+        Mutex::Lock lock(m_mutex);
+        return m_clients.size();
+    }
+
+    void TcpServer::startAccept(Socket::ptr sock, IOManager* iom, bool exclusive) {
+        int fd = sock->getSocket();
+        while (!m_isStop) {
+            uint32_t batch = g_tcp_server_accept_batch->getValue();
+            uint32_t n = 0;
+            bool again = false;
+            while (n < batch && !m_isStop) {
+                // 对端地址直接取自 accept4，连接建立路径上不创建 Address
+                SockAddr peer;
+                socklen_t len = SockAddr::GetCapacity();
+                int client = accept4_f(fd, peer.getAddr(), &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (client >= 0) {
+                    ++n;
+                    peer.setAddrLen(len);
+                    dispatch(sock, client, peer);
+                    continue;
+                }
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+                if (errno != EAGAIN) {
+                    // EMFILE 等错误时等下一次可读再试
+                    LOG_ERROR(g_logger) << "accept4(" << fd << ") errno=" << errno
+                                        << " errstr=" << strerror(errno);
+                }
+                again = true;
+                break;
+            }
+            if (!again) {
+                // 一批用完，让出给已分派到本线程的连接
+                Fiber::YieldToReady();
+                continue;
+            }
+            if (iom->addEvent(fd, IOManager::READ, nullptr, exclusive)) {
+                break;
+            }
+            if (m_isStop) {
+                iom->delEvent(fd, IOManager::READ);
+                break;
+            }
+            FiberWaitScope scope("accept", fd, IOManager::READ);
+            Fiber::YieldToHold();
+        }
+    }
+
+    void TcpServer::dispatch(Socket::ptr listener, int fd, const SockAddr& peer) {
+        ++m_acceptCount;
+        FdMgr::GetInstance()->get(fd, true);
+        Socket::ptr client(new Socket(listener->getFamily(), listener->getType(), listener->getProtocol()));
+        client->setProfile(listener->getProfile());
+        if (!client->init(fd, peer)) {
+            ::close(fd);
+            return;
+        }
+        IOManager* worker = m_workers[m_next++ % m_workers.size()];
+        worker->schedule(std::bind(&TcpServer::runClient, shared_from_this(), client));
+    }
+
+    void TcpServer::runClient(Socket::ptr client) {
+        {
+            Mutex::Lock lock(m_mutex);
+            if (m_isClosing) {
+                return;
+            }
+            m_clients.insert(client.get());
+        }
+        client->setRecvTimeout(m_recvTimeout);
+        try {
+            handleClient(client);
+        } catch (...) {
+            Mutex::Lock lock(m_mutex);
+            m_clients.erase(client.get());
+            throw;
+        }
+        Mutex::Lock lock(m_mutex);
+        m_clients.erase(client.get());
+    }
+
+    void TcpServer::handleClient(Socket::ptr client) {
+        if (m_handler) {
+            m_handler(client);
+        } else {
+            std::stringstream ss;
+            client->dump(ss);
+            LOG_INFO(g_logger) << "handleClient: " << ss.str();
+        }
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <set>
+#include <vector>
+#include "iomanager.h"
+#include "socket.h"
+#include "address.h"
+#include "util.h"
+
+namespace svher {
+
+    // 监听一个或多个地址，每个连接交给 worker IOManager 中独立的协程处理，处理函数返回后连接关闭
+    // bind 时 listeners > 1 则开多个 SO_REUSEPORT 监听 socket 由内核分流，按顺序分给各个 acceptor；
+    // 否则所有 acceptor 共享同一个监听 socket，以 EPOLLEXCLUSIVE 等待避免惊群
+    // 每次唤醒用 accept4 批量接受，单批最多 tcp_server.accept_batch 个
+    class TcpServer : public std::enable_shared_from_this<TcpServer>, Noncopyable {
+    public:
+        typedef std::shared_ptr<TcpServer> ptr;
+        typedef std::function<void(Socket::ptr)> Handler;
+
+        TcpServer(IOManager* worker = IOManager::GetThis(), IOManager* acceptor = IOManager::GetThis());
+        virtual ~TcpServer();
+
+        // 连接按轮转分给 workers，监听协程分布在 acceptors 上，须在 start 之前设置
+        void setWorkers(const std::vector<IOManager*>& workers) { m_workers = workers; }
+        void setAcceptors(const std::vector<IOManager*>& acceptors) { m_acceptors = acceptors; }
+
+        virtual bool bind(Address::ptr addr, size_t listeners = 1);
+        // 失败的地址放入 fails，全部成功返回 true
+        virtual bool bind(const std::vector<Address::ptr>& addrs, std::vector<Address::ptr>& fails,
+                          size_t listeners = 1);
+        // 加入一个已在监听的 socket (如经 FdHandoff 从旧进程收到)，shared 含义同 bind 的 listeners == 1
+        virtual bool addListener(Socket::ptr sock, bool shared = true);
+        virtual bool start();
+        // 停止接受新连接，已接受的连接继续处理，监听 socket 保持打开
+        virtual void stopAccept();
+        // 停止接受新连接，并 shutdown 所有未结束的连接使其处理协程退出
+        virtual void stop();
+
+        void setHandler(Handler cb) { m_handler = std::move(cb); }
+        // 监听 socket 使用的配置方案，accept 得到的连接沿用
+        void setProfile(const std::string& name) { m_profile = name; }
+        // 连接的接收超时，毫秒
+        void setRecvTimeout(uint64_t v) { m_recvTimeout = v; }
+        uint64_t getRecvTimeout() const { return m_recvTimeout; }
+        const std::string& getName() const { return m_name; }
+        void setName(const std::string& v) { m_name = v; }
+
+        bool isStop() const { return m_isStop; }
+        std::vector<Socket::ptr> getSocks() const { return m_socks; }
+        size_t getConnectionCount();
+        uint64_t getAcceptCount() const { return m_acceptCount; }
+    protected:
+        // 在 worker 的协程中处理一个连接，默认调用 setHandler 设置的回调
+        virtual void handleClient(Socket::ptr client);
+        void startAccept(Socket::ptr sock, IOManager* iom, bool exclusive);
+        void dispatch(Socket::ptr listener, int fd, const SockAddr& peer);
+        void runClient(Socket::ptr client);
+    private:
+        std::vector<IOManager*> m_workers;
+        std::vector<IOManager*> m_acceptors;
+        std::vector<Socket::ptr> m_socks;
+        // 共享的监听 socket 不需要分片
+        std::vector<bool> m_shared;
+        // 监听协程所在的 IOManager，stop 时在上面取消等待
+        std::vector<std::pair<IOManager*, int>> m_waits;
+        Handler m_handler;
+        std::string m_profile;
+        std::string m_name = "svher/1.0.0";
+        uint64_t m_recvTimeout;
+        std::atomic<bool> m_isStop{true};
+        // stop 后尚未开始处理的连接直接关闭
+        bool m_isClosing = false;
+        std::atomic<uint64_t> m_next{0};
+        std::atomic<uint64_t> m_acceptCount{0};
+        Mutex m_mutex;
+        std::set<Socket*> m_clients;
+    };
+}
@@ -10,7 +10,11 @@ namespace svher {
         if (!lhs && !rhs) return false;
         if (!lhs) return true;
         if (!rhs) return false;
-        return lhs->m_next < rhs->m_next;
+        if (lhs->m_next != rhs->m_next) {
+            return lhs->m_next < rhs->m_next;
+        }
+        // 同一毫秒到期的定时器按地址区分，否则 set 会把它们视为同一个
+        return lhs.get() < rhs.get();
     }
 
     Timer::Timer(uint64_t ms, std::function<void()> cb, bool recurring, TimerManager *manager)
@@ -27,7 +31,9 @@ namespace svher {
         if (m_cb) {
             m_cb = nullptr;
             auto it = m_manager->m_timers.find(shared_from_this());
-            m_manager->m_timers.erase(it);
+            if (it != m_manager->m_timers.end()) {
+                m_manager->m_timers.erase(it);
+            }
             return true;
         }
         return false;
@@ -130,13 +136,23 @@ namespace svher {
             }
         }
         RWMutexType::WriteLock lock(m_mutex);
+        // 释放读锁后其它线程可能已取消了全部定时器
+        if (m_timers.empty()) {
+            return;
+        }
 
         bool rollover = detectClockRollover(now_ms);
         if (!rollover && ((*m_timers.begin())->m_next > now_ms))
             return;
 
-        Timer::ptr now_timer(new Timer(now_ms));
-        auto it = rollover ? m_timers.end() : m_timers.upper_bound(now_timer);
+        auto it = m_timers.begin();
+        if (rollover) {
+            it = m_timers.end();
+        } else {
+            while (it != m_timers.end() && (*it)->m_next <= now_ms) {
+                ++it;
+            }
+        }
         expired.insert(expired.begin(), m_timers.begin(), it);
         m_timers.erase(m_timers.begin(), it);
         cbs.reserve(expired.size());
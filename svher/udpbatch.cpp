@@ -0,0 +1,169 @@
+#include "udpbatch.h"
+#include <netinet/udp.h>
+#include <algorithm>
+#include <cstring>
+
+namespace svher {
+
+    // 一个 GSO 消息的负载上限，按 IPv6 头部计算
+    static const size_t MAX_GSO_BYTES = 65535 - 40 - 8;
+
+    UdpBatch::UdpBatch(size_t count, size_t slot_size, bool gso)
+        : m_slotSize(slot_size), m_gso(gso), m_buffer(count * slot_size),
+          m_slots(count), m_msgs(count), m_iovs(count) {
+    }
+
+    size_t UdpBatch::getDatagramCount() const {
+        size_t count = 0;
+        for (size_t i = 0; i < m_size; ++i) {
+            count += m_slots[i].segments;
+        }
+        return count;
+    }
+
+    void UdpBatch::clear() {
+        m_size = 0;
+    }
+
+    bool UdpBatch::add(const void *data, size_t length, const Address::ptr &to) {
+        if (to) {
+            return add(data, length, to->getAddr(), to->getAddrLen());
+        }
+        return add(data, length, nullptr, 0);
+    }
+
+    bool UdpBatch::add(const void *data, size_t length, const sockaddr *to, socklen_t to_len) {
+        if (length > m_slotSize || to_len > sizeof(sockaddr_storage)) {
+            return false;
+        }
+        if (m_gso && m_size > 0 && length > 0) {
+            Slot& last = m_slots[m_size - 1];
+            size_t seg = last.segment ? last.segment : last.length;
+            // 只有最后一段可以短于分段长度
+            if (length <= seg && last.length == seg * last.segments
+                    && last.segments < MAX_SEGMENTS
+                    && last.length + length <= std::min(m_slotSize, MAX_GSO_BYTES)
+                    && last.addrLen == to_len
+                    && (to_len == 0 || memcmp(&last.addr, to, to_len) == 0)) {
+                memcpy(&m_buffer[(m_size - 1) * m_slotSize + last.length], data, length);
+                last.length += length;
+                last.segment = seg;
+                ++last.segments;
+                return true;
+            }
+        }
+        if (m_size == m_slots.size()) {
+            return false;
+        }
+        Slot& slot = m_slots[m_size];
+        memcpy(&m_buffer[m_size * m_slotSize], data, length);
+        if (to_len) {
+            memcpy(&slot.addr, to, to_len);
+        }
+        slot.addrLen = to_len;
+        slot.length = length;
+        slot.segment = 0;
+        slot.segments = 1;
+        ++m_size;
+        return true;
+    }
+
+    size_t UdpBatch::getSegmentSize(size_t i) const {
+        return m_slots[i].segment ? m_slots[i].segment : m_slots[i].length;
+    }
+
+    Address::ptr UdpBatch::getAddress(size_t i) const {
+        if (!m_slots[i].addrLen) {
+            return nullptr;
+        }
+        return Address::Create(getAddr(i), getAddrLen(i));
+    }
+
+    void UdpBatch::prepareSend(size_t begin) {
+        for (size_t i = begin; i < m_size; ++i) {
+            Slot& slot = m_slots[i];
+            m_iovs[i].iov_base = &m_buffer[i * m_slotSize];
+            m_iovs[i].iov_len = slot.length;
+            msghdr& hdr = m_msgs[i].msg_hdr;
+            memset(&hdr, 0, sizeof(hdr));
+            hdr.msg_name = slot.addrLen ? &slot.addr : nullptr;
+            hdr.msg_namelen = slot.addrLen;
+            hdr.msg_iov = &m_iovs[i];
+            hdr.msg_iovlen = 1;
+            if (slot.segment) {
+                hdr.msg_control = slot.control;
+                hdr.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+                cmsghdr* cm = CMSG_FIRSTHDR(&hdr);
+                cm->cmsg_level = SOL_UDP;
+                cm->cmsg_type = UDP_SEGMENT;
+                cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                *(uint16_t*)CMSG_DATA(cm) = slot.segment;
+            }
+            m_msgs[i].msg_len = 0;
+        }
+    }
+
+    void UdpBatch::consume(size_t n) {
+        n = std::min(n, m_size);
+        if (n < m_size) {
+            memmove(&m_buffer[0], &m_buffer[n * m_slotSize], (m_size - n) * m_slotSize);
+            std::copy(m_slots.begin() + n, m_slots.begin() + m_size, m_slots.begin());
+        }
+        m_size -= n;
+    }
+
+    void UdpBatch::consumeSegments(size_t i, size_t n) {
+        Slot& slot = m_slots[i];
+        if (!slot.segment || !n) {
+            return;
+        }
+        n = std::min<size_t>(n, slot.segments);
+        size_t bytes = std::min(n * slot.segment, slot.length);
+        char* data = &m_buffer[i * m_slotSize];
+        memmove(data, data + bytes, slot.length - bytes);
+        slot.length -= bytes;
+        slot.segments -= n;
+        if (slot.segments <= 1) {
+            slot.segment = 0;
+        }
+    }
+
+    void UdpBatch::prepareRecv() {
+        m_size = 0;
+        for (size_t i = 0; i < m_slots.size(); ++i) {
+            Slot& slot = m_slots[i];
+            m_iovs[i].iov_base = &m_buffer[i * m_slotSize];
+            m_iovs[i].iov_len = m_slotSize;
+            msghdr& hdr = m_msgs[i].msg_hdr;
+            memset(&hdr, 0, sizeof(hdr));
+            hdr.msg_name = &slot.addr;
+            hdr.msg_namelen = sizeof(slot.addr);
+            hdr.msg_iov = &m_iovs[i];
+            hdr.msg_iovlen = 1;
+            hdr.msg_control = slot.control;
+            hdr.msg_controllen = sizeof(slot.control);
+            m_msgs[i].msg_len = 0;
+        }
+    }
+
+    void UdpBatch::finishRecv(int n) {
+        m_size = n;
+        for (int i = 0; i < n; ++i) {
+            Slot& slot = m_slots[i];
+            msghdr& hdr = m_msgs[i].msg_hdr;
+            slot.length = m_msgs[i].msg_len;
+            slot.addrLen = hdr.msg_namelen;
+            slot.segment = 0;
+            slot.segments = 1;
+            for (cmsghdr* cm = CMSG_FIRSTHDR(&hdr); cm; cm = CMSG_NXTHDR(&hdr, cm)) {
+                if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO) {
+                    int seg = *(int*)CMSG_DATA(cm);
+                    if (seg > 0 && (size_t)seg < slot.length) {
+                        slot.segment = seg;
+                        slot.segments = (slot.length + seg - 1) / seg;
+                    }
+                }
+            }
+        }
+    }
+}
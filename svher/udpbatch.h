@@ -0,0 +1,92 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <sys/socket.h>
+#include "address.h"
+#include "sockaddr.h"
+#include "util.h"
+
+namespace svher {
+
+    // Socket::recvBatch/sendBatch 使用的预分配报文缓冲，收发一批报文只需一次系统调用
+    // 每个槽位对应一个 mmsghdr，地址和控制信息都放在槽位内，反复使用不再分配内存
+    // 开启 GSO 后发往同一地址、长度相同的连续报文合并到同一槽位，由内核按 UDP_SEGMENT 切分；
+    // 接收端开启 Socket::setGRO 后，一个槽位可能装有多个按 getSegmentSize 等长切分的报文
+    class UdpBatch : Noncopyable {
+    public:
+        typedef std::shared_ptr<UdpBatch> ptr;
+        // 单个 GSO 消息最多的分段数
+        static const size_t MAX_SEGMENTS = 64;
+
+        // count 个槽位，每个槽位 slot_size 字节；GSO/GRO 时槽位应足够装下合并后的报文 (最大 64K)
+        UdpBatch(size_t count, size_t slot_size = 2048, bool gso = false);
+
+        size_t getCapacity() const { return m_slots.size(); }
+        size_t getSlotSize() const { return m_slotSize; }
+        bool isGSO() const { return m_gso; }
+        // 有效的槽位数
+        size_t size() const { return m_size; }
+        bool empty() const { return m_size == 0; }
+        // 槽位中的报文总数，GSO/GRO 合并的按分段计
+        size_t getDatagramCount() const;
+        void clear();
+
+        // 追加一个待发送报文，to 为空时发往 connect 的地址
+        // 槽位用完或报文超过槽位大小时返回 false，应先 sendBatch
+        bool add(const void* data, size_t length, const Address::ptr& to = nullptr);
+        bool add(const void* data, size_t length, const sockaddr* to, socklen_t to_len);
+
+        const char* getData(size_t i) const { return &m_buffer[i * m_slotSize]; }
+        size_t getLength(size_t i) const { return m_slots[i].length; }
+        // 分段长度，没有合并时等于 getLength
+        size_t getSegmentSize(size_t i) const;
+        const sockaddr* getAddr(size_t i) const { return (const sockaddr*)&m_slots[i].addr; }
+        socklen_t getAddrLen(size_t i) const { return m_slots[i].addrLen; }
+        SockAddr getSockAddr(size_t i) const { return SockAddr(getAddr(i), getAddrLen(i)); }
+        // 按需创建地址对象
+        Address::ptr getAddress(size_t i) const;
+
+        // 依次回调每个报文 cb(data, length, addr, addrlen)，合并的槽位按分段拆开
+        template<class F>
+        void forEach(F cb) const {
+            for (size_t i = 0; i < m_size; ++i) {
+                size_t seg = getSegmentSize(i);
+                const char* data = getData(i);
+                for (size_t off = 0; off < m_slots[i].length; off += seg) {
+                    cb(data + off, std::min(seg, m_slots[i].length - off), getAddr(i), getAddrLen(i));
+                }
+            }
+        }
+    private:
+        friend class Socket;
+        struct Slot {
+            sockaddr_storage addr;
+            socklen_t addrLen = 0;
+            size_t length = 0;
+            // 合并报文的分段长度，0 表示未合并
+            uint16_t segment = 0;
+            uint16_t segments = 0;
+            // 收发 UDP_GRO/UDP_SEGMENT 的控制信息
+            alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+        };
+        // 按当前内容填充 [begin, m_size) 的发送消息
+        void prepareSend(size_t begin);
+        // 去掉已发出的前 n 个槽位，其余的移到前面
+        void consume(size_t n);
+        // 去掉槽位 i 中已发出的前 n 个分段，只剩一段时不再按 GSO 发送
+        void consumeSegments(size_t i, size_t n);
+        // 所有槽位准备接收
+        void prepareRecv();
+        // recvmmsg 返回后读取长度、地址和 GRO 分段
+        void finishRecv(int n);
+
+        size_t m_slotSize;
+        bool m_gso;
+        size_t m_size = 0;
+        std::vector<char> m_buffer;
+        std::vector<Slot> m_slots;
+        std::vector<mmsghdr> m_msgs;
+        std::vector<iovec> m_iovs;
+    };
+}
@@ -55,4 +55,10 @@ namespace svher {
         return tv.tv_sec * 1000 * 1000ul + tv.tv_usec;
     }
 
+    uint64_t GetMonotonicNS() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000 * 1000 * 1000ul + ts.tv_nsec;
+    }
+
 }
\ No newline at end of file
@@ -16,6 +16,8 @@ namespace svher {
     std::string BacktraceToString(int size = 64, const std::string& prefix = "", int skip = 2);
     uint64_t GetCurrentMS();
     uint64_t GetCurrentUS();
+    // 单调时钟，用于计时
+    uint64_t GetMonotonicNS();
 
     class Noncopyable {
     public:
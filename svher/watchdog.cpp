@@ -0,0 +1,287 @@
+#include "watchdog.h"
+#include "fiber.h"
+#include "thread.h"
+#include "config.h"
+#include "log.h"
+#include <execinfo.h>
+#include <signal.h>
+#include <cerrno>
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+namespace svher {
+    static Logger::ptr g_logger = LOG_NAME("sys");
+
+    static ConfigVar<bool>::ptr g_watchdog_enable =
+            Config::Lookup<bool>("watchdog.enable", false, "start the runaway fiber watchdog");
+    static ConfigVar<uint32_t>::ptr g_watchdog_slice =
+            Config::Lookup<uint32_t>("watchdog.slice_ms", 100, "fiber time slice checked by watchdog");
+    static ConfigVar<bool>::ptr g_watchdog_preempt =
+            Config::Lookup<bool>("watchdog.preempt", false, "ask long running fibers to yield at safe points");
+    static ConfigVar<bool>::ptr g_watchdog_backtrace =
+            Config::Lookup<bool>("watchdog.backtrace", true, "log backtrace of long running fibers");
+
+    // 用于抓取调度线程调用栈的信号
+    static const int BACKTRACE_SIGNAL = SIGURG;
+    static const int MAX_FRAMES = 64;
+
+    struct WorkerSlot {
+        typedef std::shared_ptr<WorkerSlot> ptr;
+        pthread_t thread;
+        pid_t tid = 0;
+        std::string name;
+        std::atomic<uint64_t> fiberId{0};
+        // 每次切入、切出协程各加一，执行协程期间为奇数
+        std::atomic<uint64_t> seq{0};
+        // 请求让出的时间片，与 seq 相等时当前协程应让出
+        std::atomic<uint64_t> preemptSeq{0};
+        // 信号处理函数只在 seq 仍等于 btSeq 时写入调用栈
+        std::atomic<uint64_t> btSeq{0};
+        std::atomic<int> frameCount{-1};
+        void* frames[MAX_FRAMES];
+        // 以下只由看门狗线程访问
+        uint64_t lastSeq = 0;
+        uint64_t lastChange = 0;
+        bool reported = false;
+    };
+
+    static thread_local WorkerSlot* t_slot = nullptr;
+
+    static std::atomic<uint64_t> s_long_slices{0};
+    static std::atomic<uint64_t> s_preempt_requests{0};
+    static std::atomic<uint64_t> s_preempt_yields{0};
+
+    struct WatchdogData {
+        // 保护 slots，抓调用栈期间持有，保证被发信号的线程未退出
+        Mutex mutex;
+        std::vector<WorkerSlot::ptr> slots;
+        // 保护看门狗线程的启停
+        Mutex threadMutex;
+        Thread::ptr thread;
+        std::atomic<bool> running{false};
+    };
+
+    // 不析构，进程退出时看门狗线程可能仍在访问
+    static WatchdogData& GetData() {
+        static WatchdogData* s_data = new WatchdogData;
+        return *s_data;
+    }
+
+    static void OnBacktraceSignal(int) {
+        WorkerSlot* slot = t_slot;
+        if (!slot) {
+            return;
+        }
+        int saved = errno;
+        int n = 0;
+        // 信号到达前协程已经切走，不记录无关的栈
+        if (slot->seq.load() == slot->btSeq.load()) {
+            n = ::backtrace(slot->frames, MAX_FRAMES);
+        }
+        slot->frameCount = n;
+        errno = saved;
+    }
+
+    static std::string CaptureBacktrace(WorkerSlot& slot, uint64_t seq) {
+        slot.frameCount = -1;
+        slot.btSeq = seq;
+        if (pthread_kill(slot.thread, BACKTRACE_SIGNAL)) {
+            return "";
+        }
+        for (int i = 0; i < 100 && slot.frameCount < 0; ++i) {
+            usleep(1000);
+        }
+        int n = slot.frameCount;
+        if (n <= 0) {
+            return "";
+        }
+        char** symbols = backtrace_symbols(slot.frames, n);
+        if (!symbols) {
+            return "";
+        }
+        std::stringstream ss;
+        // 跳过信号处理函数自身与信号返回帧
+        for (int i = 2; i < n; ++i) {
+            ss << std::endl << "    " << symbols[i];
+        }
+        free(symbols);
+        return ss.str();
+    }
+
+    static void CheckSlot(WorkerSlot& slot, uint64_t now) {
+        uint64_t seq = slot.seq.load();
+        if (seq != slot.lastSeq) {
+            slot.lastSeq = seq;
+            slot.lastChange = now;
+            slot.reported = false;
+            return;
+        }
+        uint64_t used = now - slot.lastChange;
+        if (slot.reported || used < g_watchdog_slice->getValue() * 1000 * 1000ul) {
+            return;
+        }
+        uint64_t fiber_id = slot.fiberId.load();
+        // 读 fiberId 期间发生了切换
+        if (!fiber_id || slot.seq.load() != seq) {
+            return;
+        }
+        slot.reported = true;
+        ++s_long_slices;
+        bool preempt = g_watchdog_preempt->getValue();
+        if (preempt) {
+            slot.preemptSeq = seq;
+            ++s_preempt_requests;
+        }
+        std::string bt;
+        if (g_watchdog_backtrace->getValue()) {
+            bt = CaptureBacktrace(slot, seq);
+        }
+        LOG_WARN(g_logger) << "fiber " << fiber_id << " running over " << used / 1000 / 1000
+                           << "ms on thread " << slot.name << "(" << slot.tid << ")"
+                           << (preempt ? ", preempt requested" : "") << bt;
+    }
+
+    static void WatchdogRun() {
+        WatchdogData& data = GetData();
+        while (data.running) {
+            uint32_t slice = g_watchdog_slice->getValue();
+            // 以时间片的 1/4 为检查周期，超时的判定误差不超过 25%
+            usleep(std::max(slice / 4, 1u) * 1000);
+            uint64_t now = GetMonotonicNS();
+            Mutex::Lock lock(data.mutex);
+            for (auto& slot : data.slots) {
+                CheckSlot(*slot, now);
+            }
+        }
+    }
+
+    void Watchdog::Start() {
+        WatchdogData& data = GetData();
+        Mutex::Lock lock(data.threadMutex);
+        if (data.thread) {
+            return;
+        }
+        struct sigaction sa = {};
+        sa.sa_handler = OnBacktraceSignal;
+        sa.sa_flags = SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+        sigaction(BACKTRACE_SIGNAL, &sa, nullptr);
+        // backtrace 首次调用会加载 libgcc，不能在信号处理函数里做
+        void* warm[1];
+        ::backtrace(warm, 1);
+        static bool s_atexit = false;
+        if (!s_atexit) {
+            s_atexit = true;
+            atexit(&Watchdog::Stop);
+        }
+        data.running = true;
+        data.thread.reset(new Thread(&WatchdogRun, "watchdog"));
+    }
+
+    void Watchdog::Stop() {
+        WatchdogData& data = GetData();
+        Mutex::Lock lock(data.threadMutex);
+        if (!data.thread) {
+            return;
+        }
+        data.running = false;
+        data.thread->join();
+        data.thread.reset();
+    }
+
+    bool Watchdog::IsRunning() {
+        return GetData().running;
+    }
+
+    void Watchdog::RegisterThread() {
+        if (t_slot) {
+            return;
+        }
+        WorkerSlot::ptr slot(new WorkerSlot);
+        slot->thread = pthread_self();
+        slot->tid = GetThreadId();
+        slot->name = Thread::GetName();
+        WatchdogData& data = GetData();
+        Mutex::Lock lock(data.mutex);
+        data.slots.push_back(slot);
+        t_slot = slot.get();
+    }
+
+    void Watchdog::UnregisterThread() {
+        if (!t_slot) {
+            return;
+        }
+        WatchdogData& data = GetData();
+        Mutex::Lock lock(data.mutex);
+        for (auto it = data.slots.begin(); it != data.slots.end(); ++it) {
+            if (it->get() == t_slot) {
+                data.slots.erase(it);
+                break;
+            }
+        }
+        t_slot = nullptr;
+    }
+
+    void Watchdog::EnterFiber(Fiber* fiber) {
+        WorkerSlot* slot = t_slot;
+        if (slot) {
+            slot->fiberId.store(fiber->getId(), std::memory_order_relaxed);
+            slot->seq.fetch_add(1, std::memory_order_release);
+        }
+    }
+
+    void Watchdog::LeaveFiber() {
+        WorkerSlot* slot = t_slot;
+        if (slot) {
+            slot->fiberId.store(0, std::memory_order_relaxed);
+            slot->seq.fetch_add(1, std::memory_order_release);
+        }
+    }
+
+    bool Watchdog::PreemptRequested() {
+        WorkerSlot* slot = t_slot;
+        if (!slot) {
+            return false;
+        }
+        uint64_t seq = slot->seq.load(std::memory_order_relaxed);
+        return (seq & 1) && slot->preemptSeq.load(std::memory_order_relaxed) == seq;
+    }
+
+    uint64_t Watchdog::GetLongSlices() {
+        return s_long_slices;
+    }
+
+    uint64_t Watchdog::GetPreemptRequests() {
+        return s_preempt_requests;
+    }
+
+    uint64_t Watchdog::GetPreemptYields() {
+        return s_preempt_yields;
+    }
+
+    void PreemptPoint() {
+        if (Watchdog::PreemptRequested()) {
+            ++s_preempt_yields;
+            Fiber::YieldToReady();
+        }
+    }
+
+    struct WatchdogIniter {
+        WatchdogIniter() {
+            if (g_watchdog_enable->getValue()) {
+                Watchdog::Start();
+            }
+            g_watchdog_enable->addListener([](const bool& old_value, const bool& new_value) {
+                if (new_value) {
+                    Watchdog::Start();
+                } else {
+                    Watchdog::Stop();
+                }
+            });
+        }
+    };
+
+    static WatchdogIniter s_initer;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include "util.h"
+
+namespace svher {
+
+    class Fiber;
+
+    // 看门狗: 后台线程定期检查各调度线程，同一协程连续执行超过
+    // watchdog.slice_ms 时计为一次长时间片，记录其调用栈，
+    // 开启 watchdog.preempt 时请求该协程在下一个安全点让出
+    class Watchdog {
+    public:
+        // 启停看门狗线程，通常由配置 watchdog.enable 控制
+        static void Start();
+        static void Stop();
+        static bool IsRunning();
+
+        // 调度线程进入/退出调度循环时调用
+        static void RegisterThread();
+        static void UnregisterThread();
+        // 调度器切入/切出协程时调用
+        static void EnterFiber(Fiber* fiber);
+        static void LeaveFiber();
+
+        // 当前协程是否被请求让出
+        static bool PreemptRequested();
+
+        // 超过时间片的次数
+        static uint64_t GetLongSlices();
+        // 发出的抢占请求次数与在安全点实际让出的次数
+        static uint64_t GetPreemptRequests();
+        static uint64_t GetPreemptYields();
+    };
+
+    // 安全点: 看门狗请求抢占时以 READY 状态让出当前协程
+    // hook 的 I/O 入口会调用，长时间计算的循环里也可以主动调用
+    void PreemptPoint();
+}
@@ -0,0 +1,218 @@
+#include "writequeue.h"
+#include "config.h"
+#include "log.h"
+#include <climits>
+#include <cstring>
+
+namespace svher {
+
+    static Logger::ptr g_logger = LOG_NAME("sys");
+
+    static ConfigVar<uint32_t>::ptr g_write_queue_high =
+            Config::Lookup<uint32_t>("write_queue.high_watermark", 1024 * 1024, "write queue bytes before push blocks");
+    static ConfigVar<uint32_t>::ptr g_write_queue_low =
+            Config::Lookup<uint32_t>("write_queue.low_watermark", 256 * 1024, "write queue bytes to resume push");
+
+    WriteQueue::WriteQueue(Socket::ptr sock, IOManager *iom)
+        : m_sock(sock),
+          m_iom(iom),
+          m_low(g_write_queue_low->getValue()),
+          m_high(g_write_queue_high->getValue()) {
+        if (m_low > m_high) {
+            m_low = m_high;
+        }
+    }
+
+    WriteQueue::~WriteQueue() {
+        close();
+    }
+
+    int WriteQueue::push(ByteArray::ptr ba) {
+        Mutex::Lock lock(m_mutex);
+        return append(lock, nullptr, ba->getReadSize(), ba, true);
+    }
+
+    int WriteQueue::push(const void *buffer, size_t length) {
+        Mutex::Lock lock(m_mutex);
+        return append(lock, buffer, length, nullptr, true);
+    }
+
+    int WriteQueue::tryPush(const void *buffer, size_t length) {
+        Mutex::Lock lock(m_mutex);
+        return append(lock, buffer, length, nullptr, false);
+    }
+
+    int WriteQueue::append(Mutex::Lock& lock, const void *buffer, size_t length, ByteArray::ptr ba, bool needWait) {
+        while (true) {
+            if (m_error) {
+                return m_error;
+            }
+            if (m_closed) {
+                return EPIPE;
+            }
+            if (m_queued < m_high || !length) {
+                break;
+            }
+            if (!needWait) {
+                return EAGAIN;
+            }
+            FiberWaiter::ptr waiter(new FiberWaiter("write_queue"));
+            m_pushWaiters.push_back(waiter);
+            ++m_blocks;
+            lock.unlock();
+            int err = waiter->waitInterruptible();
+            lock.lock();
+            if (err) {
+                m_pushWaiters.remove(waiter);
+                return err;
+            }
+        }
+        if (!length) {
+            return 0;
+        }
+        if (ba) {
+            m_chunks.push_back({ba, ba->getPosition(), length, false});
+        } else {
+            if (m_chunks.empty() || !m_chunks.back().owned) {
+                m_chunks.push_back({ByteArray::ptr(new ByteArray), 0, 0, true});
+            }
+            Chunk& chunk = m_chunks.back();
+            chunk.ba->write(buffer, length);
+            chunk.length += length;
+        }
+        m_queued += length;
+        if (m_queued > m_peak) {
+            m_peak = (size_t)m_queued;
+        }
+        startWriter();
+        return 0;
+    }
+
+    int WriteQueue::flush() {
+        Mutex::Lock lock(m_mutex);
+        while (true) {
+            if (m_error) {
+                return m_error;
+            }
+            if (m_closed) {
+                return EPIPE;
+            }
+            if (m_queued == 0) {
+                return 0;
+            }
+            FiberWaiter::ptr waiter(new FiberWaiter("write_queue_flush"));
+            m_flushWaiters.push_back(waiter);
+            lock.unlock();
+            int err = waiter->waitInterruptible();
+            lock.lock();
+            if (err) {
+                m_flushWaiters.remove(waiter);
+                return err;
+            }
+        }
+    }
+
+    void WriteQueue::close() {
+        Mutex::Lock lock(m_mutex);
+        if (m_closed) {
+            return;
+        }
+        m_closed = true;
+        // 正在发送的一批不受影响
+        for (auto& i : m_chunks) {
+            m_queued -= i.length;
+        }
+        m_chunks.clear();
+        wakeup();
+    }
+
+    void WriteQueue::setWatermarks(size_t low, size_t high) {
+        Mutex::Lock lock(m_mutex);
+        m_high = high;
+        m_low = std::min(low, high);
+        wakeup();
+    }
+
+    void WriteQueue::wakeup() {
+        bool done = m_closed || m_error;
+        if (done || m_queued <= m_low) {
+            for (auto& i : m_pushWaiters) {
+                i->notify();
+            }
+            m_pushWaiters.clear();
+        }
+        if (done || m_queued == 0) {
+            for (auto& i : m_flushWaiters) {
+                i->notify();
+            }
+            m_flushWaiters.clear();
+        }
+    }
+
+    void WriteQueue::startWriter() {
+        if (m_writing) {
+            return;
+        }
+        m_writing = true;
+        m_iom->schedule(std::bind(&WriteQueue::writeLoop, shared_from_this()));
+    }
+
+    void WriteQueue::writeLoop() {
+        while (true) {
+            std::deque<Chunk> chunks;
+            {
+                Mutex::Lock lock(m_mutex);
+                if (m_chunks.empty() || m_closed || m_error) {
+                    m_writing = false;
+                    wakeup();
+                    return;
+                }
+                chunks.swap(m_chunks);
+            }
+            // 发送期间新 push 的数据进入 m_chunks，下一轮一起发出
+            std::vector<iovec> iovs;
+            for (auto& i : chunks) {
+                i.ba->getReadBuffers(iovs, i.length, i.position);
+            }
+            int err = sendAll(iovs);
+            if (err) {
+                LOG_DEBUG(g_logger) << "write queue fd=" << m_sock->getSocket() << " send fail errno="
+                                    << err << " errstr=" << strerror(err);
+                Mutex::Lock lock(m_mutex);
+                m_error = err;
+                m_chunks.clear();
+                m_queued = 0;
+                m_writing = false;
+                wakeup();
+                return;
+            }
+        }
+    }
+
+    int WriteQueue::sendAll(std::vector<iovec> &iovs) {
+        size_t begin = 0;
+        while (begin < iovs.size()) {
+            ++m_sendCalls;
+            int rt = m_sock->send(&iovs[begin], std::min<size_t>(iovs.size() - begin, IOV_MAX));
+            if (rt <= 0) {
+                return rt ? errno : EPIPE;
+            }
+            {
+                // 每次发出后就更新排队量，不必等整批发完才唤醒生产者
+                Mutex::Lock lock(m_mutex);
+                m_queued -= rt;
+                wakeup();
+            }
+            size_t n = rt;
+            while (begin < iovs.size() && n >= iovs[begin].iov_len) {
+                n -= iovs[begin].iov_len;
+                ++begin;
+            }
+            if (n) {
+                iovs[begin].iov_base = (char*)iovs[begin].iov_base + n;
+                iovs[begin].iov_len -= n;
+            }
+        }
+        return 0;
+    }
+}
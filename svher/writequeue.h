@@ -0,0 +1,83 @@
+#pragma once
+
+#include <memory>
+#include <deque>
+#include <list>
+#include <atomic>
+#include "socket.h"
+#include "bytearray.h"
+#include "fibersync.h"
+#include "iomanager.h"
+#include "thread.h"
+
+namespace svher {
+
+    // 单个连接的发送队列，多个协程可以并发写入，须由 shared_ptr 持有
+    // 数据以 ByteArray 块排队，由一个发送协程取出当前所有块，用一次 sendmsg (writev) 合并发出，
+    // 连续的小块 push 追加到队尾同一个 ByteArray 中
+    // 排队字节数达到高水位时 push 挂起当前协程，降到低水位以下再统一唤醒，慢速对端不会让内存无限增长
+    // 水位默认值来自配置 write_queue.high_watermark / write_queue.low_watermark
+    class WriteQueue : public std::enable_shared_from_this<WriteQueue>, Noncopyable {
+    public:
+        typedef std::shared_ptr<WriteQueue> ptr;
+        // 发送协程调度到 iom
+        explicit WriteQueue(Socket::ptr sock, IOManager* iom = IOManager::GetThis());
+        ~WriteQueue();
+
+        // 以下成功返回 0，失败返回错误码: 截止时间到达或被取消 (ETIMEDOUT/ECANCELED)、
+        // 队列已关闭 (EPIPE) 或之前的发送已失败 (发送时的 errno)
+        // ba 从当前位置起的 getReadSize 字节入队，不移动其位置，发出前调用方不能再修改
+        int push(ByteArray::ptr ba);
+        // 拷贝入队
+        int push(const void* buffer, size_t length);
+        // 不挂起，超过高水位时返回 EAGAIN
+        int tryPush(const void* buffer, size_t length);
+        // 挂起直到已入队的数据全部发出
+        int flush();
+        // 丢弃未发出的数据，挂起的 push/flush 返回 EPIPE；不关闭 socket
+        void close();
+
+        void setWatermarks(size_t low, size_t high);
+        size_t getLowWatermark() const { return m_low; }
+        size_t getHighWatermark() const { return m_high; }
+        // 已入队未发出的字节数
+        size_t getQueued() const { return m_queued; }
+        size_t getPeakQueued() const { return m_peak; }
+        bool isWritable() const { return m_queued < m_high; }
+        int getError() const { return m_error; }
+        uint64_t getSendCalls() const { return m_sendCalls; }
+        // push 因高水位挂起的次数
+        uint64_t getBlockCount() const { return m_blocks; }
+    private:
+        struct Chunk {
+            ByteArray::ptr ba;
+            size_t position;
+            size_t length;
+            // 队列自己分配的块，后续 push 可以继续追加
+            bool owned;
+        };
+        // 持有 m_mutex 时调用，needWait 为 false 时不挂起
+        int append(Mutex::Lock& lock, const void* buffer, size_t length, ByteArray::ptr ba, bool needWait);
+        // 持有 m_mutex 时调用，按状态唤醒挂起的 push 与 flush
+        void wakeup();
+        void startWriter();
+        void writeLoop();
+        int sendAll(std::vector<iovec>& iovs);
+
+        Socket::ptr m_sock;
+        IOManager* m_iom;
+        Mutex m_mutex;
+        std::deque<Chunk> m_chunks;
+        std::list<FiberWaiter::ptr> m_pushWaiters;
+        std::list<FiberWaiter::ptr> m_flushWaiters;
+        size_t m_low;
+        size_t m_high;
+        bool m_writing = false;
+        bool m_closed = false;
+        std::atomic<int> m_error{0};
+        std::atomic<size_t> m_queued{0};
+        std::atomic<size_t> m_peak{0};
+        std::atomic<uint64_t> m_sendCalls{0};
+        std::atomic<uint64_t> m_blocks{0};
+    };
+}
@@ -89,7 +89,49 @@ void test() {
     std::cout << ba->toHexString(16) << std::endl;
 }
 
+// getWriteBuffers 写入后用 commitWrite 提交，setPosition 不能越过已写入大小
+void test_commit() {
+    svher::ByteArray::ptr ba(new svher::ByteArray(8));
+    ba->write("ab", 2);
+    std::vector<iovec> iovs;
+    ASSERT(ba->getWriteBuffers(iovs, 20) == 20);
+    bool thrown = false;
+    try {
+        ba->setPosition(10);
+    } catch (std::out_of_range&) {
+        thrown = true;
+    }
+    ASSERT(thrown && ba->getSize() == 2);
+
+    size_t n = 0;
+    for (auto& i : iovs) {
+        memset(i.iov_base, 'c', std::min<size_t>(i.iov_len, 13 - n));
+        n += std::min<size_t>(i.iov_len, 13 - n);
+    }
+    ba->commitWrite(13);
+    ba->write("d", 1);
+    ASSERT(ba->getSize() == 16 && ba->getPosition() == 16);
+    ba->setPosition(0);
+    ASSERT(ba->toString() == "ab" + std::string(13, 'c') + "d");
+
+    // reset 后复用已分配的节点
+    std::vector<iovec> before;
+    ba->getReadBuffers(before, 16, 0);
+    ba->reset();
+    ASSERT(ba->getSize() == 0 && ba->getPosition() == 0);
+    std::vector<iovec> after;
+    ba->getWriteBuffers(after, 16);
+    ASSERT(before.size() == after.size());
+    for (size_t i = 0; i < before.size(); ++i) {
+        ASSERT(before[i].iov_base == after[i].iov_base);
+    }
+    ba->write("xyz", 3);
+    ba->setPosition(0);
+    ASSERT(ba->toString() == "xyz");
+}
+
 int main(int argc, char** argv) {
     test();
+    test_commit();
     return 0;
 }
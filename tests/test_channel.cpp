@@ -0,0 +1,96 @@
+#include "webserver.h"
+
+static svher::Logger::ptr g_logger = LOG_ROOT();
+
+static const int N = 100000;
+
+// 三级流水线: 生产 -> 平方 -> 汇总，中间用有界通道背压
+void test_pipeline() {
+    auto source = std::make_shared<svher::Channel<int>>(16);
+    auto squared = std::make_shared<svher::Channel<uint64_t>>(16);
+    uint64_t sum = 0;
+    uint64_t begin = svher::GetCurrentMS();
+    {
+        svher::IOManager iom(2, false);
+        iom.schedule([source]() {
+            for (int i = 1; i <= N; ++i) {
+                ASSERT(source->send(i));
+            }
+            source->close();
+        });
+        iom.schedule([source, squared]() {
+            int v;
+            while (source->recv(v)) {
+                squared->send((uint64_t)v * v);
+            }
+            squared->close();
+        });
+        iom.schedule([squared, &sum]() {
+            std::vector<uint64_t> batch;
+            while (squared->recvMany(batch, 8)) {
+                for (auto i : batch) sum += i;
+                batch.clear();
+            }
+        });
+    }
+    uint64_t expect = 0;
+    for (uint64_t i = 1; i <= N; ++i) expect += i * i;
+    ASSERT(sum == expect);
+    LOG_INFO(g_logger) << "pipeline ok, " << N << " items in "
+            << svher::GetCurrentMS() - begin << "ms";
+}
+
+void test_try_and_close() {
+    svher::Channel<std::string> ch(2);
+    ASSERT(ch.trySend("a"));
+    ASSERT(ch.trySend("b"));
+    ASSERT(!ch.trySend("c"));
+    std::string v;
+    ASSERT(ch.tryRecv(v) && v == "a");
+    ch.close();
+    ASSERT(!ch.send("d"));
+    ASSERT(ch.recv(v) && v == "b");
+    ASSERT(!ch.recv(v));
+    ASSERT(!ch.tryRecv(v));
+
+    // 只能移动的类型也可以 trySend，满时不移走
+    svher::Channel<std::unique_ptr<int>> moves(1);
+    std::unique_ptr<int> p1(new int(1)), p2(new int(2));
+    ASSERT(moves.trySend(std::move(p1)) && !p1);
+    ASSERT(!moves.trySend(std::move(p2)) && p2 && *p2 == 2);
+    std::unique_ptr<int> out;
+    ASSERT(moves.tryRecv(out) && *out == 1);
+    LOG_INFO(g_logger) << "try and close ok";
+}
+
+// 协程生产，普通线程消费，无界通道
+void test_fiber_to_thread() {
+    svher::Channel<std::unique_ptr<int>> ch;
+    int sum = 0;
+    svher::Thread consumer([&ch, &sum]() {
+        std::unique_ptr<int> v;
+        while (ch.recv(v)) {
+            sum += *v;
+        }
+    }, "consumer");
+    {
+        svher::IOManager iom(1);
+        iom.schedule([&ch]() {
+            for (int i = 1; i <= 100; ++i) {
+                ch.send(std::unique_ptr<int>(new int(i)));
+                if (i % 10 == 0) usleep(1000);
+            }
+            ch.close();
+        });
+    }
+    consumer.join();
+    ASSERT(sum == 5050);
+    LOG_INFO(g_logger) << "fiber to thread ok";
+}
+
+int main(int argc, char** argv) {
+    test_try_and_close();
+    test_pipeline();
+    test_fiber_to_thread();
+    return 0;
+}
@@ -0,0 +1,161 @@
+#include "webserver.h"
+
+static svher::Logger::ptr g_logger = LOG_ROOT();
+
+static void echo(svher::Socket::ptr client) {
+    char buf[256];
+    while (true) {
+        int ret = client->recv(buf, sizeof(buf));
+        if (ret <= 0) {
+            break;
+        }
+        client->send(buf, ret);
+    }
+}
+
+static bool ping(const svher::Socket::ptr& sock) {
+    char rsp[4];
+    return sock->send("ping", 4) == 4 && sock->recv(rsp, 4) == 4 && memcmp(rsp, "ping", 4) == 0;
+}
+
+// 顺序使用只建立一条连接
+void test_reuse(svher::Address::ptr addr) {
+    svher::ConnectionPool::ptr pool(new svher::ConnectionPool);
+    for (int i = 0; i < 100; ++i) {
+        svher::Socket::ptr sock = pool->get(addr);
+        ASSERT(sock && ping(sock));
+    }
+    ASSERT(pool->getConnectCount() == 1);
+    ASSERT(pool->getReuseCount() == 99);
+    ASSERT(pool->getIdleCount(addr) == 1);
+
+    // 主动 close 的连接不再归还
+    {
+        svher::Socket::ptr sock = pool->get(addr);
+        sock->close();
+    }
+    ASSERT(pool->getIdleCount(addr) == 0 && pool->getTotalCount(addr) == 0);
+    ASSERT(pool->get(addr));
+    ASSERT(pool->getConnectCount() == 2);
+    LOG_INFO(g_logger) << "reuse ok";
+}
+
+// 达到上限时挂起等待归还，等待超时返回 ETIMEDOUT
+void test_limit(svher::Address::ptr addr) {
+    svher::ConnectionPool::ptr pool(new svher::ConnectionPool);
+    pool->setMaxPerHost(2);
+    svher::Socket::ptr a = pool->get(addr);
+    svher::Socket::ptr b = pool->get(addr);
+    ASSERT(a && b);
+    uint64_t begin = svher::GetCurrentMS();
+    ASSERT(!pool->get(addr, 50) && errno == ETIMEDOUT);
+    ASSERT(svher::GetCurrentMS() - begin >= 50);
+
+    svher::FiberSemaphore finished;
+    std::atomic<int> got{0};
+    for (int i = 0; i < 4; ++i) {
+        svher::IOManager::GetThis()->schedule([&]() {
+            svher::Socket::ptr sock = pool->get(addr, 1000);
+            if (sock && ping(sock)) {
+                ++got;
+            }
+            finished.notify();
+        });
+    }
+    usleep(20 * 1000);
+    a.reset();
+    b.reset();
+    for (int i = 0; i < 4; ++i) {
+        finished.wait();
+    }
+    ASSERT(got == 4);
+    ASSERT(pool->getConnectCount() == 2);
+    ASSERT(pool->getWaitCount() >= 4);
+    LOG_INFO(g_logger) << "limit ok";
+}
+
+// 空闲超时关闭，minIdle 预建连接
+void test_check(svher::Address::ptr addr) {
+    svher::ConnectionPool::ptr pool(new svher::ConnectionPool);
+    pool->setCheckInterval(10);
+    pool->setIdleTimeout(30);
+    {
+        svher::Socket::ptr a = pool->get(addr);
+        svher::Socket::ptr b = pool->get(addr);
+    }
+    ASSERT(pool->getIdleCount(addr) == 2);
+    usleep(100 * 1000);
+    ASSERT(pool->getIdleCount(addr) == 0 && pool->getTotalCount(addr) == 0);
+
+    pool->setMinIdle(3);
+    usleep(100 * 1000);
+    ASSERT(pool->getIdleCount(addr) == 3);
+    uint64_t connects = pool->getConnectCount();
+    ASSERT(pool->get(addr));
+    ASSERT(pool->getConnectCount() == connects);
+    LOG_INFO(g_logger) << "check ok";
+}
+
+// 服务端关闭后空闲连接不会被取出
+void test_broken(svher::IOManager* server_iom) {
+    svher::TcpServer::ptr server(new svher::TcpServer(server_iom, server_iom));
+    server->setHandler(&echo);
+    ASSERT(server->bind(svher::IPv4Address::Create("127.0.0.1", 0)));
+    svher::Address::ptr addr = server->getSocks()[0]->getLocalAddress();
+    ASSERT(server->start());
+    svher::ConnectionPool::ptr pool(new svher::ConnectionPool);
+    {
+        svher::Socket::ptr sock = pool->get(addr);
+        ASSERT(sock && ping(sock));
+    }
+    server->stop();
+    usleep(20 * 1000);
+    // 断开的空闲连接被丢弃，转而新建连接 (监听已关闭时失败)
+    svher::Socket::ptr sock = pool->get(addr, 200);
+    ASSERT(pool->getBrokenCount() == 1);
+    ASSERT(pool->getReuseCount() == 0);
+    ASSERT(pool->getTotalCount(addr) == (sock ? 1u : 0u));
+    LOG_INFO(g_logger) << "broken ok";
+}
+
+void bench(svher::Address::ptr addr) {
+    const int total = 2000;
+    uint64_t begin = svher::GetCurrentMS();
+    for (int i = 0; i < total; ++i) {
+        svher::Socket::ptr sock = svher::Socket::CreateTCP(addr);
+        linger lg{1, 0};
+        sock->setOption(SOL_SOCKET, SO_LINGER, lg);
+        ASSERT(sock->connect(addr) && ping(sock));
+    }
+    uint64_t fresh = svher::GetCurrentMS() - begin;
+    svher::ConnectionPool::ptr pool(new svher::ConnectionPool);
+    begin = svher::GetCurrentMS();
+    for (int i = 0; i < total; ++i) {
+        svher::Socket::ptr sock = pool->get(addr);
+        ASSERT(sock && ping(sock));
+    }
+    uint64_t pooled = svher::GetCurrentMS() - begin;
+    LOG_INFO(g_logger) << total << " requests: fresh connect " << fresh << " ms, pooled " << pooled << " ms";
+}
+
+int main(int argc, char** argv) {
+    svher::IOManager server_iom(2, false, "server");
+    svher::IOManager iom(2, false, "client");
+    svher::Semaphore done;
+    iom.schedule([&]() {
+        svher::TcpServer::ptr server(new svher::TcpServer(&server_iom, &server_iom));
+        server->setHandler(&echo);
+        ASSERT(server->bind(svher::IPv4Address::Create("127.0.0.1", 0)));
+        svher::Address::ptr addr = server->getSocks()[0]->getLocalAddress();
+        ASSERT(server->start());
+        test_reuse(addr);
+        test_limit(addr);
+        test_check(addr);
+        bench(addr);
+        server->stop();
+        test_broken(&server_iom);
+        done.notify();
+    });
+    done.wait();
+    return 0;
+}
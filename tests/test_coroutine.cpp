@@ -0,0 +1,160 @@
+#include "webserver.h"
+#include "svher/coroutine.h"
+#include <sys/socket.h>
+
+static svher::Logger::ptr g_logger = LOG_ROOT();
+
+static const int SWITCHES = 100000;
+static const int CONNS = 1000;
+
+// 常驻内存 (KB)
+static long rss_kb() {
+    long pages = 0, resident = 0;
+    FILE* fp = fopen("/proc/self/statm", "r");
+    if (fp) {
+        if (fscanf(fp, "%ld %ld", &pages, &resident) != 2) resident = 0;
+        fclose(fp);
+    }
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static svher::Socket::ptr wrap(int fd) {
+    svher::FdMgr::GetInstance()->get(fd, true);
+    svher::Socket::ptr sock(new svher::Socket(AF_UNIX, SOCK_STREAM, 0));
+    ASSERT(sock->init(fd));
+    return sock;
+}
+
+svher::Task<> echo_server(svher::Socket::ptr listener) {
+    svher::Socket::ptr client = co_await svher::AsyncAccept(listener);
+    ASSERT(client);
+    char buf[64];
+    ssize_t n;
+    while ((n = co_await svher::AsyncRecv(client, buf, sizeof(buf))) > 0) {
+        co_await svher::AsyncSend(client, buf, n);
+    }
+}
+
+svher::Task<std::string> echo_once(svher::Address::ptr addr, std::string msg) {
+    svher::Socket::ptr sock = co_await svher::AsyncConnect(addr);
+    ASSERT(sock);
+    co_await svher::SleepAwaiter(10);
+    ssize_t n = co_await svher::AsyncSend(sock, msg.c_str(), msg.size());
+    ASSERT(n == (ssize_t)msg.size());
+    std::string rt(msg.size(), '\0');
+    n = co_await svher::AsyncRecv(sock, &rt[0], rt.size());
+    rt.resize(n > 0 ? n : 0);
+    // 关闭后服务端读到 EOF 退出
+    sock->close();
+    co_return rt;
+}
+
+svher::Task<> test_echo(svher::Socket::ptr listener, svher::Address::ptr addr) {
+    std::string rt = co_await echo_once(addr, "hello coroutine");
+    ASSERT(rt == "hello coroutine");
+    LOG_INFO(g_logger) << "echo ok: " << rt;
+}
+
+svher::Task<> yield_loop(uint64_t* used) {
+    uint64_t begin = svher::GetCurrentUS();
+    for (int i = 0; i < SWITCHES; ++i) {
+        co_await svher::YieldAwaiter();
+    }
+    *used = svher::GetCurrentUS() - begin;
+}
+
+// 单线程调度下，一次让出 + 重新调度的耗时
+void bench_switch() {
+    uint64_t coro_us = 0, fiber_us = 0;
+    {
+        svher::IOManager iom(1, false);
+        yield_loop(&coro_us).start(&iom);
+    }
+    {
+        svher::IOManager iom(1, false);
+        svher::Fiber::ptr fiber(new svher::Fiber([&fiber_us]() {
+            uint64_t begin = svher::GetCurrentUS();
+            for (int i = 0; i < SWITCHES; ++i) {
+                svher::Fiber::YieldToReady();
+            }
+            fiber_us = svher::GetCurrentUS() - begin;
+        }));
+        iom.schedule(fiber);
+    }
+    LOG_INFO(g_logger) << "switch x" << SWITCHES << " coroutine=" << coro_us << "us ("
+            << coro_us * 1000 / SWITCHES << "ns/op) fiber=" << fiber_us << "us ("
+            << fiber_us * 1000 / SWITCHES << "ns/op)";
+}
+
+svher::Task<> wait_one(svher::Socket::ptr sock, std::atomic<int>* done) {
+    char c;
+    ssize_t n = co_await svher::AsyncRecv(sock, &c, 1);
+    ASSERT(n == 1);
+    ++*done;
+}
+
+// 每个连接挂起一个读操作时的内存占用
+void bench_memory() {
+    std::vector<svher::Socket::ptr> readers, writers;
+    for (int i = 0; i < CONNS; ++i) {
+        int fds[2];
+        ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        readers.push_back(wrap(fds[0]));
+        writers.push_back(wrap(fds[1]));
+    }
+    std::atomic<int> done{0};
+    {
+        svher::IOManager iom(1, false);
+        long rss = rss_kb();
+        for (auto& i : readers) {
+            wait_one(i, &done).start(&iom);
+        }
+        while (svher::CoroutineFrameCount() < (uint64_t)CONNS) usleep(1000);
+        usleep(50 * 1000);
+        LOG_INFO(g_logger) << "coroutine: " << CONNS << " pending reads, frames="
+                << svher::CoroutineFrameBytes() << "B ("
+                << svher::CoroutineFrameBytes() / CONNS << "B/conn) rss+="
+                << rss_kb() - rss << "KB";
+        for (auto& i : writers) {
+            i->send("x", 1);
+        }
+    }
+    ASSERT(done == CONNS);
+    done = 0;
+    {
+        svher::IOManager iom(1, false);
+        long rss = rss_kb();
+        for (auto& i : readers) {
+            iom.schedule([i, &done]() {
+                char c;
+                ASSERT(i->recv(&c, 1) == 1);
+                ++done;
+            });
+        }
+        usleep(200 * 1000);
+        uint64_t stack = svher::Config::Lookup<uint32_t>("fiber.stack_size")->getValue();
+        LOG_INFO(g_logger) << "fiber: " << CONNS << " pending reads, stacks="
+                << stack * CONNS << "B (" << stack << "B/conn) rss+="
+                << rss_kb() - rss << "KB";
+        for (auto& i : writers) {
+            i->send("x", 1);
+        }
+    }
+    ASSERT(done == CONNS);
+}
+
+int main(int argc, char** argv) {
+    svher::Address::ptr addr = svher::Address::LookupAnyIPAddress("127.0.0.1:18086");
+    svher::Socket::ptr listener = svher::Socket::CreateTCP(addr);
+    ASSERT(listener->bind(addr) && listener->listen());
+    svher::FdMgr::GetInstance()->get(listener->getSocket(), true);
+    {
+        svher::IOManager iom(2, false);
+        echo_server(listener).start(&iom);
+        test_echo(listener, addr).start(&iom);
+    }
+    bench_switch();
+    bench_memory();
+    ASSERT(svher::CoroutineFrameCount() == 0);
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include "webserver.h"
+#include <sys/socket.h>
+
+static svher::Logger::ptr g_logger = LOG_ROOT();
+
+// 一个请求里多次后端调用共享同一份预算
+void test_budget() {
+    int fds[2];
+    ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    // 单次读超时比整体预算长
+    struct timeval tv = {1, 0};
+    setsockopt(fds[0], SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    uint64_t begin = svher::GetCurrentMS();
+    {
+        svher::DeadlineScope scope(100);
+        char buf[16];
+        for (int i = 0; i < 5; ++i) {
+            ASSERT(read(fds[0], buf, sizeof(buf)) == -1 && errno == ETIMEDOUT);
+        }
+        ASSERT(usleep(1000 * 1000) == -1 && errno == ETIMEDOUT);
+        struct pollfd pfd = {fds[0], POLLIN, 0};
+        ASSERT(poll(&pfd, 1, 1000) == -1 && errno == ETIMEDOUT);
+    }
+    uint64_t used = svher::GetCurrentMS() - begin;
+    ASSERT(used >= 100 && used < 200);
+    ASSERT(svher::FiberDeadline::Get() == svher::FiberDeadline::NONE);
+    close(fds[0]);
+    close(fds[1]);
+    LOG_INFO(g_logger) << "budget ok, used=" << used << "ms";
+}
+
+// 远端取消立即唤醒挂起的协程
+void test_cancel() {
+    int fds[2];
+    ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    svher::CancelToken::ptr token(new svher::CancelToken);
+    svher::IOManager::GetThis()->addTimer(50, [token]() {
+        token->cancel();
+    });
+    uint64_t begin = svher::GetCurrentMS();
+    {
+        svher::CancelScope scope(token);
+        char buf[16];
+        ASSERT(read(fds[0], buf, sizeof(buf)) == -1 && errno == ECANCELED);
+        ASSERT(sleep(10) > 0 && errno == ECANCELED);
+        svher::Channel<int> ch(1);
+        int v;
+        ASSERT(!ch.recv(v) && errno == ECANCELED);
+    }
+    uint64_t used = svher::GetCurrentMS() - begin;
+    ASSERT(used < 100);
+    close(fds[0]);
+    close(fds[1]);
+    LOG_INFO(g_logger) << "cancel ok, used=" << used << "ms";
+}
+
+// 超时放弃的等待者不会吞掉之后的唤醒
+void test_sync() {
+    svher::FiberSemaphore sem;
+    {
+        svher::DeadlineScope scope(30);
+        ASSERT(!sem.wait() && errno == ETIMEDOUT);
+    }
+    sem.notify();
+    ASSERT(sem.tryWait());
+
+    svher::FiberMutex mutex;
+    svher::FiberCondVar cond;
+    {
+        svher::DeadlineScope scope(30);
+        svher::FiberMutex::Lock lock(mutex);
+        ASSERT(!cond.wait(lock) && errno == ETIMEDOUT);
+    }
+
+    svher::Promise<int> promise;
+    bool caught = false;
+    try {
+        svher::DeadlineScope scope(30);
+        promise.getFuture().get();
+    } catch (std::system_error& e) {
+        caught = e.code().value() == ETIMEDOUT;
+    }
+    ASSERT(caught);
+    promise.setValue(1);
+
+    // async 出去的子任务继承截止时间
+    svher::Future<int> child;
+    {
+        svher::DeadlineScope scope(30);
+        child = svher::async(svher::Scheduler::GetThis(), []() {
+            return usleep(1000 * 1000) == -1 ? errno : 0;
+        });
+    }
+    ASSERT(child.get() == ETIMEDOUT);
+    LOG_INFO(g_logger) << "sync ok";
+}
+
+int main(int argc, char** argv) {
+    svher::IOManager iom(2, false);
+    iom.schedule(test_budget);
+    iom.schedule(test_cancel);
+    iom.schedule(test_sync);
+    return 0;
+}
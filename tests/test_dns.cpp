@@ -0,0 +1,202 @@
+#include "webserver.h"
+#include "svher/fdmanager.h"
+#include <atomic>
+
+static svher::Logger::ptr g_logger = LOG_ROOT();
+
+static const uint16_t STUB_PORT = 15353;
+static std::atomic<int> s_udp_queries{0};
+static std::atomic<int> s_tcp_queries{0};
+static std::atomic<bool> s_stop{false};
+
+static void append16(std::string& buf, uint16_t v) {
+    buf.push_back((char)(v >> 8));
+    buf.push_back((char)(v & 0xff));
+}
+
+static void append32(std::string& buf, uint32_t v) {
+    append16(buf, v >> 16);
+    append16(buf, v & 0xffff);
+}
+
+// 本地桩服务器:
+// svher.test  A    -> 10.0.0.1 (ttl 1s)
+// none.test        -> NXDOMAIN (SOA minimum 60s)
+// big.test    A    -> UDP 返回截断，TCP 返回 10.0.0.2
+// zero.test   A    -> UDP 返回截断，TCP 返回长度为 0 的应答 (返回空串)
+static std::string answer(const std::string& req, bool tcp) {
+    std::string name;
+    size_t pos = 12;
+    while (pos < req.size() && req[pos]) {
+        uint8_t len = req[pos];
+        if (!name.empty()) name += ".";
+        name.append(req, pos + 1, len);
+        pos += len + 1;
+    }
+    uint16_t qtype = ((uint8_t)req[pos + 1] << 8) | (uint8_t)req[pos + 2];
+    std::string question = req.substr(12, pos + 5 - 12);
+
+    std::string rsp = req.substr(0, 2);
+    uint16_t flags = 0x8180;
+    int ancount = 0, nscount = 0;
+    std::string records;
+    if (name == "svher.test" && qtype == 1) {
+        ancount = 1;
+        append16(records, 0xc00c);
+        append16(records, 1);
+        append16(records, 1);
+        append32(records, 1);
+        append16(records, 4);
+        records += std::string("\x0a\x00\x00\x01", 4);
+    } else if (name == "zero.test" && qtype == 1) {
+        if (tcp) {
+            return "";
+        }
+        flags |= 0x0200;
+    } else if (name == "big.test" && qtype == 1) {
+        if (!tcp) {
+            flags |= 0x0200;
+        } else {
+            ancount = 1;
+            append16(records, 0xc00c);
+            append16(records, 1);
+            append16(records, 1);
+            append32(records, 300);
+            append16(records, 4);
+            records += std::string("\x0a\x00\x00\x02", 4);
+        }
+    } else {
+        flags |= 3;
+        nscount = 1;
+        append16(records, 0xc00c);
+        append16(records, 6);
+        append16(records, 1);
+        append32(records, 300);
+        append16(records, 2 + 20);
+        records.push_back(0);
+        records.push_back(0);
+        for (int i = 0; i < 4; ++i) append32(records, 0);
+        append32(records, 60);
+    }
+    append16(rsp, flags);
+    append16(rsp, 1);
+    append16(rsp, ancount);
+    append16(rsp, nscount);
+    append16(rsp, 0);
+    return rsp + question + records;
+}
+
+void run_udp_stub(svher::Socket::ptr sock) {
+    sock->setRecvTimeout(100);
+    while (!s_stop) {
+        std::string buf(512, '\0');
+        svher::Address::ptr from(new svher::IPv4Address);
+        int rt = sock->recvFrom(&buf[0], buf.size(), from);
+        if (rt <= 0) continue;
+        buf.resize(rt);
+        ++s_udp_queries;
+        // 放慢应答，便于并发查询合并
+        usleep(50 * 1000);
+        std::string rsp = answer(buf, false);
+        sock->sendTo(rsp.c_str(), rsp.size(), from);
+    }
+}
+
+void run_tcp_stub(svher::Socket::ptr sock) {
+    sock->setRecvTimeout(1000);
+    while (!s_stop) {
+        auto client = sock->accept();
+        if (!client) continue;
+        ++s_tcp_queries;
+        std::string buf(1024, '\0');
+        int rt = client->recv(&buf[0], buf.size());
+        if (rt <= 2) continue;
+        buf = buf.substr(2, rt - 2);
+        std::string rsp = answer(buf, true);
+        std::string out;
+        append16(out, rsp.size());
+        out += rsp;
+        client->send(out.c_str(), out.size());
+        if (rsp.empty()) {
+            // 保持连接，确认客户端不会等待后续数据
+            client->recv(&buf[0], buf.size());
+        }
+    }
+}
+
+void test_dns() {
+    svher::DnsResolver* resolver = svher::DnsMgr::GetInstance();
+    resolver->setServers({svher::IPv4Address::Create("127.0.0.1", STUB_PORT)});
+    resolver->setSearch({});
+    resolver->setTimeout(500);
+
+    // 并发查询同一域名只发一次
+    std::atomic<int> done{0};
+    for (int i = 0; i < 5; ++i) {
+        svher::IOManager::GetThis()->schedule([&done]() {
+            auto addr = svher::Address::LookupAnyIPAddressAsync("svher.test:80");
+            ASSERT(addr);
+            LOG_INFO(g_logger) << "coalesced: " << addr->toString();
+            ++done;
+        });
+    }
+    while (done != 5) {
+        usleep(10 * 1000);
+    }
+    ASSERT(s_udp_queries == 1);
+
+    // 命中缓存
+    std::vector<svher::IPAddress::ptr> addrs;
+    ASSERT(resolver->resolve(addrs, "SVHER.test"));
+    ASSERT(s_udp_queries == 1);
+
+    // 否定缓存
+    addrs.clear();
+    ASSERT(!resolver->resolve(addrs, "none.test"));
+    ASSERT(!resolver->resolve(addrs, "none.test"));
+    ASSERT(s_udp_queries == 2);
+
+    // 截断后走 TCP
+    addrs.clear();
+    ASSERT(resolver->resolve(addrs, "big.test"));
+    ASSERT(addrs.size() == 1 && addrs[0]->toString() == "10.0.0.2");
+    ASSERT(s_tcp_queries == 1);
+
+    // TTL 过期后重新查询
+    sleep(2);
+    addrs.clear();
+    ASSERT(resolver->resolve(addrs, "svher.test"));
+    ASSERT(s_udp_queries == 4);
+
+    // 字面地址不发查询
+    ASSERT(svher::Address::LookupAnyIPAddressAsync("127.0.0.1:8080")->toString() == "127.0.0.1:8080");
+    ASSERT(s_udp_queries == 4);
+
+    LOG_INFO(g_logger) << "dns test ok, udp queries=" << s_udp_queries
+            << " tcp queries=" << s_tcp_queries << " cache=" << resolver->getCacheSize();
+
+    // TCP 应答长度为 0 时视为非法应答，立即失败
+    uint64_t begin = svher::GetCurrentMS();
+    addrs.clear();
+    ASSERT(!resolver->resolve(addrs, "zero.test"));
+    ASSERT(svher::GetCurrentMS() - begin < 2000);
+    LOG_INFO(g_logger) << "zero length tcp response rejected";
+    s_stop = true;
+}
+
+int main(int argc, char** argv) {
+    // 先绑定好端口，避免查询先于 stub 启动
+    auto addr = svher::IPv4Address::Create("127.0.0.1", STUB_PORT);
+    auto udp = svher::Socket::CreateUDP(addr);
+    ASSERT(udp->bind(addr));
+    auto tcp = svher::Socket::CreateTCP(addr);
+    ASSERT(tcp->bind(addr) && tcp->listen());
+    // 主线程未开启 hook，手动登记为 hook 管理的 socket
+    svher::FdMgr::GetInstance()->get(udp->getSocket(), true);
+    svher::FdMgr::GetInstance()->get(tcp->getSocket(), true);
+    svher::IOManager iom(2);
+    iom.schedule(std::bind(run_udp_stub, udp));
+    iom.schedule(std::bind(run_tcp_stub, tcp));
+    iom.schedule(test_dns);
+    return 0;
+}
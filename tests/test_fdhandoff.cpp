@@ -0,0 +1,153 @@
+#include "webserver.h"
+#include <fcntl.h>
+#include <sys/wait.h>
+
+static svher::Logger::ptr g_logger = LOG_ROOT();
+
+static const char* s_path = "/tmp/test_fdhandoff.sock";
+
+// 每个请求 1 字节，回复处理它的进程标记，'q' 让新进程退出
+static void serve(svher::Socket::ptr client, char mark, svher::FiberSemaphore* quit) {
+    char c;
+    while (client->recv(&c, 1) == 1) {
+        if (c == 'q') {
+            quit->notify();
+            break;
+        }
+        if (client->send(&mark, 1) != 1) {
+            break;
+        }
+    }
+}
+
+static char request(const svher::Socket::ptr& sock) {
+    char c = 'p';
+    if (sock->send(&c, 1) != 1 || sock->recv(&c, 1) != 1) {
+        return 0;
+    }
+    return c;
+}
+
+// 新进程: 从旧进程接管监听 socket 与一条空闲连接
+static int run_new() {
+    std::atomic<int> rt{1};
+    svher::IOManager iom(2, false, "new");
+    iom.schedule([&rt]() {
+        std::vector<svher::FdHandoff::Item> items;
+        // 旧进程可能还没开始等待
+        for (int i = 0; i < 500 && !svher::FdHandoff::Receive(s_path, items, 1000); ++i) {
+            usleep(10 * 1000);
+        }
+        ASSERT(items.size() == 2);
+        ASSERT(items[0].name == "http" && items[1].name == "conn");
+        svher::FiberSemaphore quit;
+        svher::TcpServer::ptr server(new svher::TcpServer);
+        server->setHandler(std::bind(&serve, std::placeholders::_1, 'B', &quit));
+        ASSERT(server->addListener(items[0].sock));
+        ASSERT(server->start());
+        ASSERT(items[1].sock->isConnected());
+        svher::IOManager::GetThis()->schedule(std::bind(&serve, items[1].sock, 'B', &quit));
+        quit.wait();
+        server->stop();
+        rt = 0;
+    });
+    iom.stop();
+    return rt;
+}
+
+void test_fds() {
+    // 同一进程内收发，收到的是新的 fd 编号
+    int fds[2];
+    ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    svher::Socket::ptr a = svher::Socket::FromFd(fds[0]);
+    svher::Socket::ptr b = svher::Socket::FromFd(fds[1]);
+    ASSERT(a && b && a->getFamily() == AF_UNIX && a->getType() == SOCK_STREAM);
+    int pipes[2];
+    ASSERT(pipe(pipes) == 0);
+    ASSERT(a->sendFds(&pipes[1], 1, "x", 1) == 1);
+    std::vector<int> got;
+    char c;
+    ASSERT(b->recvFds(&c, 1, got) == 1 && c == 'x' && got.size() == 1);
+    ASSERT(got[0] != pipes[1]);
+    ASSERT(write(got[0], "y", 1) == 1);
+    ASSERT(read(pipes[0], &c, 1) == 1 && c == 'y');
+    ASSERT(fcntl(got[0], F_GETFD) & FD_CLOEXEC);
+    for (int fd : {pipes[0], pipes[1], got[0]}) {
+        close(fd);
+    }
+    // 没有旧进程时直接失败
+    std::vector<svher::FdHandoff::Item> items;
+    ASSERT(!svher::FdHandoff::Receive("/tmp/test_fdhandoff_none.sock", items, 100));
+    LOG_INFO(g_logger) << "fds ok";
+}
+
+int main(int argc, char** argv) {
+    // 在创建任何线程之前 fork
+    pid_t pid = fork();
+    ASSERT(pid >= 0);
+    if (pid == 0) {
+        return run_new();
+    }
+    svher::IOManager iom(2, false, "old");
+    svher::Semaphore done;
+    iom.schedule([&]() {
+        test_fds();
+        svher::FiberSemaphore quit;
+        svher::TcpServer::ptr server(new svher::TcpServer);
+        server->setHandler(std::bind(&serve, std::placeholders::_1, 'A', &quit));
+        ASSERT(server->bind(svher::IPv4Address::Create("127.0.0.1", 0)));
+        svher::Address::ptr addr = server->getSocks()[0]->getLocalAddress();
+        ASSERT(server->start());
+
+        // 一条空闲的长连接，服务端交给新进程
+        svher::Socket::ptr listener = svher::Socket::CreateTCP(addr);
+        svher::Address::ptr any = svher::IPv4Address::Create("127.0.0.1", 0);
+        ASSERT(listener->bind(any) && listener->listen());
+        svher::Socket::ptr idle_client = svher::Socket::CreateTCP(any);
+        ASSERT(idle_client->connect(listener->getLocalAddress()));
+        svher::Socket::ptr idle_server = listener->accept();
+        ASSERT(idle_server);
+
+        // 交接期间不断新建连接，不应出现失败
+        std::atomic<bool> running{true};
+        std::atomic<int> fails{0};
+        std::atomic<int> by_a{0};
+        std::atomic<int> by_b{0};
+        svher::FiberSemaphore clients_done;
+        svher::IOManager::GetThis()->schedule([&]() {
+            while (running || by_b < 100) {
+                svher::Socket::ptr sock = svher::Socket::CreateTCP(addr);
+                char c = sock->connect(addr, 1000) ? request(sock) : 0;
+                if (c == 'A') {
+                    ++by_a;
+                } else if (c == 'B') {
+                    ++by_b;
+                } else {
+                    ++fails;
+                }
+            }
+            clients_done.notify();
+        });
+        usleep(50 * 1000);
+        ASSERT(svher::FdHandoff::Send(s_path, {{"http", server->getSocks()[0]}, {"conn", idle_server}}, 10000));
+        // 交出后不再 accept，已接受的连接由旧进程处理完
+        server->stopAccept();
+        idle_server.reset();
+        running = false;
+        clients_done.wait();
+        ASSERT(fails == 0);
+        ASSERT(by_a > 0 && by_b >= 100);
+        // 空闲连接此后由新进程应答
+        ASSERT(request(idle_client) == 'B');
+        LOG_INFO(g_logger) << "handoff ok: old served " << by_a << ", new served " << by_b << ", fails " << fails;
+        char q = 'q';
+        ASSERT(idle_client->send(&q, 1) == 1);
+        server->stop();
+        done.notify();
+    });
+    done.wait();
+    int status = 0;
+    ASSERT(waitpid(pid, &status, 0) == pid);
+    ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    return 0;
+}
@@ -18,6 +18,44 @@ void test_fiber() {
     fiber->call();
 }
 
+// 协程创建销毁的吞吐: 直接 new 与从协程池复用
+void bench_create() {
+    static const int N = 100000;
+    svher::Fiber::GetThis();
+    uint64_t begin = svher::GetMonotonicNS();
+    for (int i = 0; i < N; ++i) {
+        svher::Fiber::ptr fiber(new svher::Fiber([]() {}));
+    }
+    uint64_t new_ns = svher::GetMonotonicNS() - begin;
+    begin = svher::GetMonotonicNS();
+    for (int i = 0; i < N; ++i) {
+        svher::Fiber::ptr fiber = svher::Fiber::Create([]() {});
+    }
+    uint64_t pool_ns = svher::GetMonotonicNS() - begin;
+    LOG_INFO(g_logger) << "create/destroy new=" << N * 1000000000ul / new_ns << "/s"
+                       << " pool=" << N * 1000000000ul / pool_ns << "/s";
+
+    // 每个回调都挂起一次，调度器需要为其换一个回调协程，池容量为 0 即不复用
+    for (uint32_t pool_size : {0u, 64u}) {
+        svher::Config::Lookup<uint32_t>("fiber.pool_size")->setValue(pool_size);
+        std::atomic<int> done{0};
+        begin = svher::GetMonotonicNS();
+        {
+            svher::IOManager iom(1, false);
+            for (int i = 0; i < N; ++i) {
+                iom.schedule([&done]() {
+                    svher::IOManager::GetThis()->schedule(svher::Fiber::GetThis());
+                    svher::Fiber::YieldToHold();
+                    ++done;
+                });
+            }
+        }
+        ASSERT(done == N);
+        LOG_INFO(g_logger) << "blocking callbacks pool_size=" << pool_size << " "
+                           << N * 1000000000ul / (svher::GetMonotonicNS() - begin) << "/s";
+    }
+}
+
 int main(int argc, char** argv) {
     svher::Thread::SetName("main");
     YAML::Node root = YAML::LoadFile("../log.yml");
@@ -30,6 +68,7 @@ int main(int argc, char** argv) {
     for (auto t : threads) {
         t->join();
     }
+    bench_create();
     LOG_INFO(g_logger) << "main exit";
     return 0;
 }
\ No newline at end of file
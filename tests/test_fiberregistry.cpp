@@ -0,0 +1,85 @@
+#include "webserver.h"
+#include <sys/socket.h>
+#include <signal.h>
+
+static svher::Logger::ptr g_logger = LOG_ROOT();
+
+static int s_fds[2];
+static svher::Channel<int> s_channel(1);
+
+// 非 static 函数，-rdynamic 下回溯可以显示符号名
+void park_on_read() {
+    char c;
+    ASSERT(read(s_fds[0], &c, 1) == 1);
+}
+
+void park_on_sleep() {
+    usleep(300 * 1000);
+}
+
+void park_on_channel() {
+    int v;
+    ASSERT(s_channel.recv(v));
+}
+
+static bool contains(const std::string& s, const std::string& sub) {
+    return s.find(sub) != std::string::npos;
+}
+
+void test_dump() {
+    svher::Config::Lookup<bool>("fiber.registry")->setValue(true);
+    ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, s_fds) == 0);
+    size_t base = svher::FiberRegistry::GetCount();
+    {
+        svher::IOManager iom(2, false, "registry");
+        iom.schedule(park_on_read);
+        iom.schedule(park_on_sleep);
+        iom.schedule(park_on_channel);
+        usleep(100 * 1000);
+        std::string dump = svher::FiberRegistry::Dump();
+        LOG_INFO(g_logger) << dump;
+        ASSERT(contains(dump, "wait=fd(fd=" + std::to_string(s_fds[0]) + " READ)"));
+        ASSERT(contains(dump, "wait=sleep"));
+        ASSERT(contains(dump, "wait=channel"));
+        ASSERT(contains(dump, "scheduler=registry"));
+#if defined(__x86_64__)
+        ASSERT(contains(dump, "parked at:"));
+        ASSERT(contains(dump, "park_on_read"));
+        ASSERT(contains(dump, "park_on_channel"));
+#endif
+
+        // 信号触发，由后台线程转储
+        // 在开启 hook 的调度线程中安装，多次触发都能转储
+        svher::Semaphore sem;
+        std::string signal_dump;
+        svher::Semaphore installed;
+        iom.schedule([&]() {
+            svher::FiberRegistry::InstallDumpSignal(SIGUSR2, [&sem, &signal_dump](const std::string& s) {
+                signal_dump = s;
+                sem.notify();
+            });
+            installed.notify();
+        });
+        installed.wait();
+        for (int i = 0; i < 3; ++i) {
+            signal_dump.clear();
+            raise(SIGUSR2);
+            sem.wait();
+            ASSERT(contains(signal_dump, "wait=channel"));
+        }
+
+        ASSERT(write(s_fds[1], "x", 1) == 1);
+        s_channel.send(1);
+    }
+    close(s_fds[0]);
+    close(s_fds[1]);
+    // 调度器的工作协程都已销毁
+    ASSERT(svher::FiberRegistry::GetCount() <= base);
+    svher::Config::Lookup<bool>("fiber.registry")->setValue(false);
+    LOG_INFO(g_logger) << "dump ok";
+}
+
+int main(int argc, char** argv) {
+    test_dump();
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include "webserver.h"
+
+static svher::Logger::ptr g_logger = LOG_ROOT();
+
+static uint32_t s_cpu_tag = svher::FiberStats::RegisterTag("cpu");
+static uint32_t s_io_tag = svher::FiberStats::RegisterTag("io");
+
+static void busy(uint64_t ms) {
+    uint64_t end = svher::GetMonotonicNS() + ms * 1000 * 1000;
+    while (svher::GetMonotonicNS() < end);
+}
+
+void test_accounting() {
+    svher::Config::Lookup<bool>("fiber.stats")->setValue(true);
+    svher::Fiber::ptr worker(new svher::Fiber([]() {
+        svher::Fiber::SetTag(s_cpu_tag);
+        for (int i = 0; i < 5; ++i) {
+            busy(5);
+            svher::Fiber::YieldToReady();
+        }
+    }));
+    svher::SchedStatsSnapshot stats;
+    {
+        svher::IOManager iom(1, false);
+        iom.schedule(worker);
+        // 单线程上排队的 10 个计算任务，后面的要等前面的执行完
+        for (int i = 0; i < 10; ++i) {
+            iom.schedule([]() {
+                svher::Fiber::SetTag(s_cpu_tag);
+                busy(10);
+            });
+        }
+        for (int i = 0; i < 10; ++i) {
+            iom.schedule([]() {
+                svher::Fiber::SetTag(s_io_tag);
+                usleep(20 * 1000);
+            });
+        }
+        sleep(1);
+        stats = iom.getStats();
+    }
+    ASSERT(worker->getSwitches() == 6);
+    ASSERT(worker->getCpuTime() >= 25 * 1000 * 1000ul);
+    auto cpu = svher::FiberStats::GetTagStats(s_cpu_tag);
+    auto io = svher::FiberStats::GetTagStats(s_io_tag);
+    ASSERT(cpu.cpuTime >= 125 * 1000 * 1000ul);
+    ASSERT(io.cpuTime < cpu.cpuTime / 10);
+    ASSERT(stats.maxWait >= 90 * 1000 * 1000ul);
+    LOG_INFO(g_logger) << "scheduler: " << stats.toString();
+    LOG_INFO(g_logger) << "by tag:" << std::endl << svher::FiberStats::Dump();
+}
+
+// 统计开关对切换开销的影响
+void bench_overhead() {
+    static const int N = 200000;
+    for (bool enable : {false, true}) {
+        svher::Config::Lookup<bool>("fiber.stats")->setValue(enable);
+        uint64_t used = 0;
+        {
+            svher::IOManager iom(1, false);
+            iom.schedule(svher::Fiber::ptr(new svher::Fiber([&used]() {
+                uint64_t begin = svher::GetMonotonicNS();
+                for (int i = 0; i < N; ++i) {
+                    svher::Fiber::YieldToReady();
+                }
+                used = svher::GetMonotonicNS() - begin;
+            })));
+        }
+        LOG_INFO(g_logger) << "stats=" << enable << " " << used / N << "ns/switch";
+    }
+}
+
+int main(int argc, char** argv) {
+    test_accounting();
+    bench_overhead();
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include "webserver.h"
+#include <atomic>
+#include <deque>
+
+static svher::Logger::ptr g_logger = LOG_ROOT();
+
+// 单线程 IOManager 上，持锁协程 sleep 让出时其它协程只挂起自己，不会卡死线程
+void test_mutex_single_thread() {
+    static svher::FiberMutex s_mutex;
+    static int s_value = 0;
+    svher::IOManager iom(1);
+    for (int i = 0; i < 10; ++i) {
+        iom.schedule([]() {
+            svher::FiberMutex::Lock lock(s_mutex);
+            int v = s_value;
+            usleep(10 * 1000);
+            s_value = v + 1;
+        });
+    }
+    iom.stop();
+    ASSERT(s_value == 10);
+    LOG_INFO(g_logger) << "mutex single thread ok";
+}
+
+// 协程与普通线程混合竞争
+void test_mutex_mixed() {
+    static svher::FiberMutex s_mutex;
+    static uint64_t s_value = 0;
+    static const int N = 20000;
+    auto add = []() {
+        for (int i = 0; i < N; ++i) {
+            svher::FiberMutex::Lock lock(s_mutex);
+            ++s_value;
+        }
+    };
+    {
+        svher::IOManager iom(3);
+        for (int i = 0; i < 8; ++i) {
+            iom.schedule(add);
+        }
+        svher::Thread thread(add, "plain");
+        thread.join();
+    }
+    ASSERT(s_value == 9ull * N);
+    LOG_INFO(g_logger) << "mutex mixed ok value=" << s_value;
+}
+
+void test_rwmutex() {
+    static svher::FiberRWMutex s_mutex;
+    static std::atomic<int> s_readers{0};
+    static std::atomic<int> s_writers{0};
+    svher::IOManager iom(2);
+    for (int i = 0; i < 20; ++i) {
+        iom.schedule([i]() {
+            for (int j = 0; j < 20; ++j) {
+                if (i % 4 == 0) {
+                    svher::FiberRWMutex::WriteLock lock(s_mutex);
+                    ASSERT(++s_writers == 1 && s_readers == 0);
+                    usleep(100);
+                    --s_writers;
+                } else {
+                    svher::FiberRWMutex::ReadLock lock(s_mutex);
+                    ++s_readers;
+                    ASSERT(s_writers == 0);
+                    usleep(100);
+                    --s_readers;
+                }
+            }
+        });
+    }
+    iom.stop();
+    LOG_INFO(g_logger) << "rwmutex ok";
+}
+
+// 信号量 + 条件变量实现的有界队列
+void test_semaphore_condvar() {
+    static svher::FiberMutex s_mutex;
+    static svher::FiberCondVar s_cond;
+    static svher::FiberSemaphore s_slots(4);
+    static std::deque<int> s_queue;
+    static int s_sum = 0;
+    svher::IOManager iom(2);
+    iom.schedule([]() {
+        for (int i = 1; i <= 1000; ++i) {
+            s_slots.wait();
+            svher::FiberMutex::Lock lock(s_mutex);
+            s_queue.push_back(i);
+            s_cond.notify();
+        }
+    });
+    iom.schedule([]() {
+        for (int i = 0; i < 1000; ++i) {
+            svher::FiberMutex::Lock lock(s_mutex);
+            while (s_queue.empty()) {
+                s_cond.wait(lock);
+            }
+            ASSERT(s_queue.size() <= 4);
+            s_sum += s_queue.front();
+            s_queue.pop_front();
+            lock.unlock();
+            s_slots.notify();
+        }
+    });
+    iom.stop();
+    ASSERT(s_sum == 500500);
+    LOG_INFO(g_logger) << "semaphore condvar ok";
+}
+
+int main(int argc, char** argv) {
+    test_mutex_single_thread();
+    test_mutex_mixed();
+    test_rwmutex();
+    test_semaphore_condvar();
+    return 0;
+}
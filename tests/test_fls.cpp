@@ -0,0 +1,98 @@
+#include "webserver.h"
+#include <map>
+
+static svher::Logger::ptr g_logger = LOG_ROOT();
+
+static std::atomic<int> s_alive{0};
+
+struct Counted {
+    Counted() { ++s_alive; }
+    ~Counted() { --s_alive; }
+    int value = 0;
+};
+
+static svher::FLS<std::string> s_trace_id;
+static svher::FLS<Counted> s_counted;
+static svher::FLS<int> s_int;
+
+// 协程之间互不可见，切换线程后仍然有效
+void test_isolation() {
+    std::atomic<int> ok{0};
+    {
+        svher::IOManager iom(3, false);
+        for (int i = 0; i < 20; ++i) {
+            iom.schedule(svher::Fiber::ptr(new svher::Fiber([i, &ok]() {
+                ASSERT(s_trace_id.tryGet() == nullptr);
+                std::string id = "trace-" + std::to_string(i);
+                s_trace_id.set(id);
+                s_counted->value = i;
+                for (int j = 0; j < 10; ++j) {
+                    svher::Fiber::YieldToReady();
+                    ASSERT(*s_trace_id == id && s_counted->value == i);
+                }
+                ++ok;
+            })));
+        }
+    }
+    ASSERT(ok == 20);
+    ASSERT(s_alive == 0);
+    LOG_INFO(g_logger) << "isolation ok";
+}
+
+// 调度器复用回调协程时，上一个回调的值已被释放
+void test_reuse() {
+    std::atomic<int> fresh{0};
+    {
+        svher::IOManager iom(1, false);
+        for (int i = 0; i < 100; ++i) {
+            iom.schedule([&fresh]() {
+                if (s_counted->value == 0) ++fresh;
+                s_counted->value = 1;
+            });
+        }
+    }
+    ASSERT(fresh == 100 && s_alive == 0);
+
+    svher::Fiber::ptr fiber(new svher::Fiber([]() {
+        s_counted.get();
+    }, 0, true));
+    svher::Fiber::GetThis();
+    fiber->call();
+    ASSERT(s_alive == 0);
+    fiber->reset([]() {
+        ASSERT(s_counted.tryGet() == nullptr);
+    });
+    fiber->call();
+    LOG_INFO(g_logger) << "reuse ok";
+}
+
+// 与按协程 id 查 map 的方式对比读取开销
+void bench_lookup() {
+    static const int N = 1000000;
+    s_int.set(1);
+    uint64_t begin = svher::GetCurrentUS();
+    int sum = 0;
+    for (int i = 0; i < N; ++i) {
+        sum += *s_int;
+    }
+    uint64_t fls_us = svher::GetCurrentUS() - begin;
+
+    std::map<uint64_t, int> by_id;
+    svher::Mutex mutex;
+    by_id[svher::Fiber::GetFiberId()] = 1;
+    begin = svher::GetCurrentUS();
+    for (int i = 0; i < N; ++i) {
+        svher::Mutex::Lock lock(mutex);
+        sum += by_id[svher::Fiber::GetFiberId()];
+    }
+    uint64_t map_us = svher::GetCurrentUS() - begin;
+    ASSERT(sum == 2 * N);
+    LOG_INFO(g_logger) << "lookup x" << N << " fls=" << fls_us << "us map=" << map_us << "us";
+}
+
+int main(int argc, char** argv) {
+    test_isolation();
+    test_reuse();
+    bench_lookup();
+    return 0;
+}
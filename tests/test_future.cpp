@@ -0,0 +1,118 @@
+#include "webserver.h"
+
+static svher::Logger::ptr g_logger = LOG_ROOT();
+
+// 模拟后端调用
+static int backend(int i, int delay_ms) {
+    usleep(delay_ms * 1000);
+    return i * i;
+}
+
+void test_fan_out() {
+    svher::Scheduler* scheduler = svher::Scheduler::GetThis();
+    std::vector<svher::Future<int>> futures;
+    uint64_t begin = svher::GetCurrentMS();
+    for (int i = 0; i < 10; ++i) {
+        futures.push_back(svher::async(scheduler, [i]() {
+            return backend(i, 50 + i * 5);
+        }));
+    }
+    std::vector<int> values = svher::when_all(futures).get();
+    int sum = 0;
+    for (auto i : values) sum += i;
+    ASSERT(values.size() == 10 && values[3] == 9 && sum == 285);
+    // 并发执行，总耗时接近最慢的一个
+    uint64_t used = svher::GetCurrentMS() - begin;
+    ASSERT(used < 300);
+    LOG_INFO(g_logger) << "when_all ok sum=" << sum << " used=" << used << "ms";
+
+    std::vector<svher::Future<int>> racers;
+    racers.push_back(svher::async(scheduler, []() { return backend(1, 200); }));
+    racers.push_back(svher::async(scheduler, []() { return backend(2, 10); }));
+    racers.push_back(svher::async(scheduler, []() { return backend(3, 100); }));
+    size_t first = svher::when_any(racers).get();
+    ASSERT(first == 1 && racers[first].get() == 4);
+    LOG_INFO(g_logger) << "when_any ok first=" << first;
+
+    auto failed = svher::async(scheduler, []() -> int {
+        throw std::runtime_error("backend down");
+    });
+    bool caught = false;
+    try {
+        failed.get();
+    } catch (std::runtime_error& e) {
+        caught = true;
+    }
+    ASSERT(caught);
+
+    svher::Promise<void> promise;
+    svher::async(scheduler, [promise]() {
+        usleep(10 * 1000);
+        promise.setValue();
+    });
+    promise.getFuture().get();
+    LOG_INFO(g_logger) << "exception and void ok";
+}
+
+// 输入永不完成时，丢弃后状态能被释放；失败时取输入顺序上的第一个异常
+void test_when_all_release() {
+    std::weak_ptr<svher::FutureState<int>> never_state;
+    std::weak_ptr<svher::FutureState<void>> void_state;
+    {
+        svher::Promise<int> never;
+        svher::Promise<int> done;
+        std::vector<svher::Future<int>> futures{never.getFuture(), done.getFuture()};
+        never_state = futures[0].getState();
+        auto all = svher::when_all(futures);
+        done.setValue(1);
+        ASSERT(!all.isReady());
+
+        svher::Promise<void> never_void;
+        std::vector<svher::Future<void>> voids{never_void.getFuture()};
+        void_state = voids[0].getState();
+        auto all_void = svher::when_all(voids);
+    }
+    ASSERT(never_state.expired() && void_state.expired());
+
+    svher::Promise<int> a, b, c;
+    auto all = svher::when_all(std::vector<svher::Future<int>>{a.getFuture(), b.getFuture(), c.getFuture()});
+    c.setException(std::make_exception_ptr(std::runtime_error("c")));
+    b.setException(std::make_exception_ptr(std::runtime_error("b")));
+    a.setValue(1);
+    std::string what;
+    try {
+        all.get();
+    } catch (std::runtime_error& e) {
+        what = e.what();
+    }
+    ASSERT(what == "b");
+    LOG_INFO(g_logger) << "when_all release ok";
+}
+
+void test_join() {
+    int step = 0;
+    svher::Fiber::ptr fiber(new svher::Fiber([&step]() {
+        usleep(50 * 1000);
+        step = 1;
+    }));
+    svher::Scheduler::GetThis()->schedule(fiber);
+    fiber->join();
+    ASSERT(step == 1);
+    // 已结束的协程 join 立即返回
+    fiber->join();
+    LOG_INFO(g_logger) << "fiber join ok";
+}
+
+int main(int argc, char** argv) {
+    svher::IOManager iom(2, false);
+    iom.schedule(test_fan_out);
+    iom.schedule(test_join);
+    iom.schedule(test_when_all_release);
+    // 普通线程等待协程产生的结果
+    auto future = svher::async(&iom, []() {
+        return backend(7, 20);
+    });
+    ASSERT(future.get() == 49);
+    LOG_INFO(g_logger) << "thread get ok";
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include <fcntl.h>
+#include <poll.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include "webserver.h"
@@ -46,9 +47,160 @@ void test_sock() {
     std::cout << buff << std::endl;
 }
 
+void test_poll() {
+    int fds[2];
+    int ret = pipe(fds);
+    ASSERT(ret == 0);
+    svher::IOManager::GetThis()->schedule([fds]() {
+        usleep(100 * 1000);
+        ssize_t n = write(fds[1], "x", 1);
+        LOG_INFO(g_logger) << "pipe write ret=" << n;
+    });
+    struct pollfd pfd = {fds[0], POLLIN, 0};
+    uint64_t start = svher::GetCurrentMS();
+    ret = poll(&pfd, 1, 1000);
+    LOG_INFO(g_logger) << "poll ret=" << ret << " revents=" << pfd.revents
+                       << " used=" << svher::GetCurrentMS() - start << "ms";
+    ASSERT(ret == 1 && (pfd.revents & POLLIN));
+
+    char c;
+    ASSERT(read(fds[0], &c, 1) == 1);
+
+    // 换算成毫秒后超出 int 的超时按 INT_MAX 处理，不会回绕成很短的超时 (约 704ms)
+    svher::IOManager::GetThis()->addTimer(1000, [fds]() {
+        ASSERT(write(fds[1], "y", 1) == 1);
+    });
+    struct timespec huge = {4294968, 0};
+    pfd.revents = 0;
+    ret = ppoll(&pfd, 1, &huge, nullptr);
+    ASSERT(ret == 1 && (pfd.revents & POLLIN));
+    ASSERT(read(fds[0], &c, 1) == 1 && c == 'y');
+    fd_set rset;
+    FD_ZERO(&rset);
+    FD_SET(fds[0], &rset);
+    timeval tv{0, 100 * 1000};
+    ret = select(fds[0] + 1, &rset, nullptr, nullptr, &tv);
+    LOG_INFO(g_logger) << "select timeout ret=" << ret;
+    ASSERT(ret == 0);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+// 另一个协程已在同一 fd 上等待读事件时，poll 改为轮询而不是重复注册，也不阻塞线程
+void test_poll_shared() {
+    int fds[2];
+    ASSERT(pipe(fds) == 0);
+    svher::FiberSemaphore reader;
+    svher::IOManager::GetThis()->schedule([fds, &reader]() {
+        char c;
+        ASSERT(read(fds[0], &c, 1) == 1 && c == 'y');
+        reader.notify();
+    });
+    usleep(10 * 1000);
+    std::atomic<int> ticks{0};
+    svher::IOManager::GetThis()->schedule([&ticks]() {
+        for (int i = 0; i < 5; ++i) {
+            usleep(10 * 1000);
+            ++ticks;
+        }
+    });
+    struct pollfd pfd = {fds[0], POLLIN, 0};
+    uint64_t start = svher::GetCurrentMS();
+    int ret = poll(&pfd, 1, 100);
+    uint64_t used = svher::GetCurrentMS() - start;
+    LOG_INFO(g_logger) << "shared poll ret=" << ret << " used=" << used << "ms ticks=" << ticks;
+    ASSERT(ret == 0 && used >= 100 && ticks == 5);
+
+    // 数据到达后轮询能及时返回，读协程只取走一个字节
+    svher::IOManager::GetThis()->addTimer(30, [fds]() {
+        ASSERT(write(fds[1], "yz", 2) == 2);
+    });
+    start = svher::GetCurrentMS();
+    ret = poll(&pfd, 1, 1000);
+    used = svher::GetCurrentMS() - start;
+    ASSERT(ret == 1 && (pfd.revents & POLLIN) && used < 500);
+    reader.wait();
+    close(fds[0]);
+    close(fds[1]);
+}
+
+// poll 的事件触发后、poll 协程恢复前，另一个协程在同一 fd 上注册了读等待，
+// poll 返回时不能把别人的注册撤销掉
+// 单线程调度下，idle 先调度到期的定时器，再调度 fd 事件，保证 reader 先于 poll 协程运行
+void test_poll_rearm() {
+    int fds[2];
+    ASSERT(pipe(fds) == 0);
+    std::atomic<bool> got{false};
+    svher::IOManager::GetThis()->schedule([fds, &got]() {
+        usleep(20 * 1000);
+        ASSERT(write(fds[1], "a", 1) == 1);
+        // 不让出执行权等待事件就绪，随后 0ms 定时器与 fd 事件在同一轮 idle 中处理
+        uint64_t until = svher::GetCurrentMS() + 10;
+        while (svher::GetCurrentMS() < until);
+        usleep(0);
+        char c;
+        ASSERT(read_f(fds[0], &c, 1) == 1 && c == 'a');
+        // 管道已空，hook 的 read 注册读事件后挂起
+        ASSERT(read(fds[0], &c, 1) == 1 && c == 'b');
+        got = true;
+    });
+    struct pollfd pfd = {fds[0], POLLIN, 0};
+    poll(&pfd, 1, 100);
+    ASSERT(write(fds[1], "b", 1) == 1);
+    uint64_t deadline = svher::GetCurrentMS() + 1000;
+    while (!got && svher::GetCurrentMS() < deadline) {
+        usleep(10 * 1000);
+    }
+    ASSERT(got);
+    LOG_INFO(g_logger) << "poll rearm ok";
+    close(fds[0]);
+    close(fds[1]);
+}
+
+void test_splice() {
+    int sv[2];
+    int ret = socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+    ASSERT(ret == 0);
+    int fds[2];
+    ret = pipe2(fds, O_CLOEXEC);
+    ASSERT(ret == 0);
+    svher::IOManager::GetThis()->schedule([sv]() {
+        sleep(1);
+        const char data[] = "hello splice";
+        send(sv[1], data, sizeof(data), 0);
+    });
+    // 数据到达前 splice 会挂起协程而不是阻塞线程
+    ssize_t n = splice(sv[0], nullptr, fds[1], nullptr, 4096, 0);
+    LOG_INFO(g_logger) << "splice socket->pipe ret=" << n;
+    std::string buff(n, '\0');
+    ASSERT(read(fds[0], &buff[0], n) == n);
+    LOG_INFO(g_logger) << "pipe read: " << buff.c_str();
+    int fd = dup(sv[0]);
+    LOG_INFO(g_logger) << "dup fd=" << fd << " nonblock="
+                       << !!(fcntl(fd, F_GETFL) & O_NONBLOCK);
+    close(fd);
+    close(sv[0]);
+    close(sv[1]);
+    close(fds[0]);
+    close(fds[1]);
+}
+
 int main(int argc, char** argv) {
 //    test_sleep();
 //    test_sock();
+    {
+        svher::IOManager iom(2);
+        iom.schedule(test_poll);
+        iom.schedule(test_splice);
+    }
+    {
+        svher::IOManager iom(1, false);
+        iom.schedule(test_poll_shared);
+    }
+    {
+        svher::IOManager iom(1, false);
+        iom.schedule(test_poll_rearm);
+    }
     YAML::Node root = YAML::LoadFile("../log.yml");
     svher::Config::LoadFromYaml(root);
     std::cout << svher::LoggerMgr().GetInstance()->toYamlString() << std::endl;
@@ -0,0 +1,91 @@
+#include "webserver.h"
+#include <atomic>
+#include <fcntl.h>
+#include <stdexcept>
+
+static svher::Logger::ptr g_logger = LOG_ROOT();
+
+static std::atomic<int> s_ticks{0};
+
+// CPU 任务放到线程池，单线程 IOManager 上的定时器不应被卡住
+void test_cpu() {
+    svher::Timer::ptr timer = svher::IOManager::GetThis()->addTimer(10, []() {
+        ++s_ticks;
+    }, true);
+    uint64_t begin = svher::GetCurrentMS();
+    uint64_t sum = svher::Offload::GetInstance()->run([]() {
+        uint64_t sum = 0;
+        uint64_t end = svher::GetCurrentMS() + 300;
+        while (svher::GetCurrentMS() < end) {
+            for (int i = 0; i < 1000; ++i) sum += i;
+        }
+        return sum;
+    });
+    timer->cancel();
+    LOG_INFO(g_logger) << "cpu task sum=" << sum << " used=" << svher::GetCurrentMS() - begin
+            << "ms ticks=" << s_ticks;
+    ASSERT(sum > 0);
+    ASSERT(s_ticks >= 10);
+
+    bool caught = false;
+    try {
+        svher::Offload::GetInstance()->run([]() {
+            throw std::runtime_error("offload error");
+        });
+    } catch (std::runtime_error& e) {
+        caught = true;
+    }
+    ASSERT(caught);
+}
+
+void test_file_io() {
+    svher::Config::Lookup<bool>("offload.file_io")->setValue(true);
+    const char* path = "/tmp/svher_test_offload";
+    int fd = open(path, O_CREAT | O_TRUNC | O_RDWR, 0644);
+    ASSERT(fd >= 0);
+    std::string data(1024 * 1024, 'x');
+    ASSERT(write(fd, data.c_str(), data.size()) == (ssize_t)data.size());
+    ASSERT(pwrite(fd, "hello", 5, 100) == 5);
+    char buf[5];
+    ASSERT(pread(fd, buf, sizeof(buf), 100) == 5);
+    ASSERT(memcmp(buf, "hello", 5) == 0);
+    ASSERT(pread(-1, buf, sizeof(buf), 0) == -1 && errno == EBADF);
+    close(fd);
+    unlink(path);
+    LOG_INFO(g_logger) << "file io ok";
+}
+
+// 协程的最后一个引用在 Offload 工作线程上释放时直接删除，不会滞留在工作线程的池里
+void test_release_on_worker() {
+    uint64_t total = svher::Fiber::TotalFibers();
+    uint64_t pooled = svher::Fiber::PooledFibers();
+    for (int i = 0; i < 100; ++i) {
+        svher::Fiber::ptr fiber = svher::Fiber::Create([]() {});
+        svher::Offload::GetInstance()->run([&fiber]() {
+            fiber.reset();
+            return 0;
+        });
+        ASSERT(!fiber);
+    }
+    LOG_INFO(g_logger) << "release on worker total=" << svher::Fiber::TotalFibers()
+            << " pooled=" << svher::Fiber::PooledFibers() << " before=" << pooled;
+    ASSERT(svher::Fiber::TotalFibers() == total);
+    ASSERT(svher::Fiber::PooledFibers() <= pooled);
+}
+
+int main(int argc, char** argv) {
+    // 不在协程中时直接执行
+    int v = svher::Offload::GetInstance()->run([]() { return 42; });
+    ASSERT(v == 42);
+    {
+        svher::IOManager iom(1);
+        iom.schedule(test_cpu);
+        iom.schedule(test_file_io);
+    }
+    {
+        svher::IOManager iom(1);
+        iom.schedule(test_release_on_worker);
+    }
+    LOG_INFO(g_logger) << "offload rejects=" << svher::Offload::GetInstance()->getRejectCount();
+    return 0;
+}
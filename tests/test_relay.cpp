@@ -0,0 +1,207 @@
+#include "webserver.h"
+
+static svher::Logger::ptr g_logger = LOG_ROOT();
+
+static void echo(svher::Socket::ptr client) {
+    char buf[4096];
+    while (true) {
+        int ret = client->recv(buf, sizeof(buf));
+        if (ret <= 0) {
+            break;
+        }
+        if (client->send(buf, ret) != ret) {
+            break;
+        }
+    }
+}
+
+static void sink(svher::Socket::ptr client) {
+    std::vector<char> buf(256 * 1024);
+    while (client->recv(&buf[0], buf.size()) > 0) {
+    }
+}
+
+static bool send_all(const svher::Socket::ptr& sock, const char* data, size_t length) {
+    while (length > 0) {
+        int n = sock->send(data, length);
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        length -= n;
+    }
+    return true;
+}
+
+struct Proxy {
+    svher::TcpServer::ptr server;
+    svher::Address::ptr upstream;
+    svher::Address::ptr local;
+    bool splice = true;
+    uint64_t idle = -1;
+    // 最近一次转发的结果
+    std::atomic<int> done{0};
+    std::atomic<int> error{0};
+    std::atomic<int> spliced{0};
+    std::atomic<uint64_t> up{0};
+    std::atomic<uint64_t> down{0};
+};
+
+static void start_proxy(Proxy& proxy, svher::IOManager* iom) {
+    proxy.server.reset(new svher::TcpServer(iom, iom));
+    proxy.server->setHandler([&proxy](svher::Socket::ptr client) {
+        svher::Socket::ptr upstream = svher::Socket::CreateTCP(proxy.upstream);
+        if (!upstream->connect(proxy.upstream)) {
+            return;
+        }
+        svher::Relay relay(client, upstream);
+        relay.setUseSplice(proxy.splice);
+        relay.setIdleTimeout(proxy.idle);
+        relay.run();
+        proxy.error = relay.getError();
+        proxy.spliced = relay.getSplicedCount();
+        proxy.up = relay.getBytesAToB();
+        proxy.down = relay.getBytesBToA();
+        ++proxy.done;
+    });
+    ASSERT(proxy.server->bind(svher::IPv4Address::Create("127.0.0.1", 0)));
+    proxy.local = proxy.server->getSocks()[0]->getLocalAddress();
+    ASSERT(proxy.server->start());
+}
+
+static void wait_done(Proxy& proxy, int n) {
+    while (proxy.done < n) {
+        usleep(1000);
+    }
+}
+
+// 边发边收校验数据，发完后半关闭，回显数据仍能读完，最后读到 EOF
+void test_echo(Proxy& proxy, bool splice) {
+    proxy.splice = splice;
+    int done = proxy.done;
+    const size_t total = 8 * 1024 * 1024;
+    svher::Socket::ptr sock = svher::Socket::CreateTCP(proxy.local);
+    ASSERT(sock->connect(proxy.local));
+    svher::FiberSemaphore sent;
+    svher::IOManager::GetThis()->schedule([&]() {
+        std::vector<char> buf(64 * 1024);
+        for (size_t offset = 0; offset < total; offset += buf.size()) {
+            for (size_t i = 0; i < buf.size(); ++i) {
+                buf[i] = (char)((offset + i) * 7);
+            }
+            ASSERT(send_all(sock, &buf[0], buf.size()));
+        }
+        ASSERT(::shutdown(sock->getSocket(), SHUT_WR) == 0);
+        sent.notify();
+    });
+    std::vector<char> buf(64 * 1024);
+    size_t received = 0;
+    while (true) {
+        int n = sock->recv(&buf[0], buf.size());
+        if (n <= 0) {
+            ASSERT(n == 0);
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            ASSERT(buf[i] == (char)((received + i) * 7));
+        }
+        received += n;
+    }
+    sent.wait();
+    ASSERT(received == total);
+    wait_done(proxy, done + 1);
+    ASSERT(proxy.error == 0);
+    ASSERT(proxy.up == total && proxy.down == total);
+    ASSERT(proxy.spliced == (splice ? 2 : 0));
+    LOG_INFO(g_logger) << "echo " << (splice ? "splice" : "copy") << " ok";
+}
+
+// 两个方向都没有数据时按空闲超时结束
+void test_idle(Proxy& proxy, bool splice) {
+    proxy.splice = splice;
+    proxy.idle = 50;
+    int done = proxy.done;
+    svher::Socket::ptr sock = svher::Socket::CreateTCP(proxy.local);
+    ASSERT(sock->connect(proxy.local));
+    // 有数据往来时不超时
+    for (int i = 0; i < 5; ++i) {
+        char c = 'x';
+        ASSERT(sock->send(&c, 1) == 1 && sock->recv(&c, 1) == 1 && c == 'x');
+        usleep(30 * 1000);
+    }
+    uint64_t begin = svher::GetCurrentMS();
+    char c;
+    ASSERT(sock->recv(&c, 1) <= 0);
+    uint64_t used = svher::GetCurrentMS() - begin;
+    ASSERT(used < 500);
+    wait_done(proxy, done + 1);
+    ASSERT(proxy.error == ETIMEDOUT);
+    proxy.idle = -1;
+    LOG_INFO(g_logger) << "idle " << (splice ? "splice" : "copy") << " ok";
+}
+
+void bench(Proxy& proxy, bool splice) {
+    proxy.splice = splice;
+    int done = proxy.done;
+    const size_t total = 512 * 1024 * 1024;
+    svher::Socket::ptr sock = svher::Socket::CreateTCP(proxy.local);
+    ASSERT(sock->connect(proxy.local));
+    std::vector<char> buf(256 * 1024, 'b');
+    uint64_t begin = svher::GetCurrentMS();
+    for (size_t offset = 0; offset < total; offset += buf.size()) {
+        ASSERT(send_all(sock, &buf[0], buf.size()));
+    }
+    ::shutdown(sock->getSocket(), SHUT_WR);
+    ASSERT(sock->recv(&buf[0], buf.size()) == 0);
+    uint64_t used = svher::GetCurrentMS() - begin;
+    wait_done(proxy, done + 1);
+    ASSERT(proxy.error == 0 && proxy.up == total);
+    LOG_INFO(g_logger) << (splice ? "splice" : "copy") << ": " << total / 1024 / 1024 << " MB in " << used
+                       << " ms, " << total / 1024 / 1024 * 1000 / (used ? used : 1) << " MB/s";
+}
+
+static bool sigpipe_ignored() {
+    struct sigaction sa;
+    ASSERT(sigaction(SIGPIPE, nullptr, &sa) == 0);
+    return sa.sa_handler == SIG_IGN;
+}
+
+int main(int argc, char** argv) {
+    // 加载时不改信号处理，首次 splice 转发时才忽略 SIGPIPE
+    ASSERT(!sigpipe_ignored());
+    svher::IOManager server_iom(2, false, "server");
+    svher::IOManager proxy_iom(2, false, "proxy");
+    svher::IOManager client_iom(2, false, "client");
+    svher::Semaphore finished;
+    client_iom.schedule([&]() {
+        svher::TcpServer::ptr echo_server(new svher::TcpServer(&server_iom, &server_iom));
+        echo_server->setHandler(&echo);
+        ASSERT(echo_server->bind(svher::IPv4Address::Create("127.0.0.1", 0)));
+        ASSERT(echo_server->start());
+        svher::TcpServer::ptr sink_server(new svher::TcpServer(&server_iom, &server_iom));
+        sink_server->setHandler(&sink);
+        ASSERT(sink_server->bind(svher::IPv4Address::Create("127.0.0.1", 0)));
+        ASSERT(sink_server->start());
+
+        Proxy proxy;
+        proxy.upstream = echo_server->getSocks()[0]->getLocalAddress();
+        start_proxy(proxy, &proxy_iom);
+        test_echo(proxy, false);
+        ASSERT(!sigpipe_ignored());
+        test_echo(proxy, true);
+        ASSERT(sigpipe_ignored());
+        test_idle(proxy, true);
+        test_idle(proxy, false);
+
+        proxy.upstream = sink_server->getSocks()[0]->getLocalAddress();
+        bench(proxy, false);
+        bench(proxy, true);
+
+        proxy.server->stop();
+        echo_server->stop();
+        sink_server->stop();
+        finished.notify();
+    });
+    finished.wait();
+    return 0;
+}
@@ -0,0 +1,180 @@
+#include "webserver.h"
+#include <sys/socket.h>
+
+static svher::Logger::ptr g_logger = LOG_ROOT();
+
+// 两条连接谁先可读就处理谁
+void test_fds() {
+    int a[2], b[2];
+    ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, a) == 0);
+    ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, b) == 0);
+    svher::IOManager::GetThis()->addTimer(50, [b]() {
+        ASSERT(write(b[1], "b", 1) == 1);
+    });
+    svher::Selector sel;
+    int ra = sel.addRead(a[0]);
+    int rb = sel.addRead(b[0]);
+    int to = sel.addTimeout(1000);
+    uint64_t begin = svher::GetCurrentMS();
+    ASSERT(sel.wait() == rb);
+    char c;
+    ASSERT(read(b[0], &c, 1) == 1 && c == 'b');
+    ASSERT(svher::GetCurrentMS() - begin < 500);
+
+    // 没有数据时超时分支返回
+    begin = svher::GetCurrentMS();
+    svher::Selector sel2;
+    sel2.addRead(a[0]);
+    sel2.addRead(b[0]);
+    int to2 = sel2.addTimeout(50);
+    ASSERT(sel2.wait() == to2);
+    uint64_t used = svher::GetCurrentMS() - begin;
+    ASSERT(used >= 50 && used < 200);
+
+    // 未选中的分支已撤销，可以反复 select 同一组 fd
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT(write(a[1], "a", 1) == 1);
+        ASSERT(sel.wait() == ra);
+        ASSERT(read(a[0], &c, 1) == 1 && c == 'a');
+    }
+    (void)to;
+    for (int fd : {a[0], a[1], b[0], b[1]}) {
+        close(fd);
+    }
+    LOG_INFO(g_logger) << "fds ok";
+}
+
+void test_channel() {
+    int fds[2];
+    ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    svher::Channel<int> ch(1);
+    svher::Selector sel;
+    int rf = sel.addRead(fds[0]);
+    int rc = sel.addRecv(ch);
+    svher::IOManager::GetThis()->schedule([&ch]() {
+        usleep(30 * 1000);
+        ch.send(42);
+    });
+    ASSERT(sel.wait() == rc);
+    int v = 0;
+    ASSERT(ch.tryRecv(v) && v == 42);
+
+    // 已就绪的通道不挂起
+    ch.send(7);
+    ASSERT(sel.wait() == rc);
+    ASSERT(ch.tryRecv(v) && v == 7);
+
+    // 满的通道可发送时返回
+    ch.send(1);
+    svher::Selector sender;
+    int sc = sender.addSend(ch);
+    sender.addTimeout(1000);
+    svher::IOManager::GetThis()->addTimer(30, [&ch]() {
+        int x;
+        ch.tryRecv(x);
+    });
+    ASSERT(sender.wait() == sc);
+    ASSERT(ch.trySend(2));
+
+    ASSERT(write(fds[1], "x", 1) == 1);
+    ASSERT(ch.tryRecv(v));
+    ASSERT(sel.wait() == rf);
+    close(fds[0]);
+    close(fds[1]);
+    LOG_INFO(g_logger) << "channel ok";
+}
+
+// 通道唤醒了 select 但选中的是另一个分支时，唤醒转交给通道的其它接收者
+// 单线程调度保证两次发送都在 select 恢复之前完成
+void test_pass() {
+    svher::Channel<int> ch;
+    svher::Channel<int> other;
+    std::atomic<bool> got{false};
+    {
+        svher::IOManager iom(1, false);
+        iom.schedule([&]() {
+            svher::Selector sel;
+            int ro = sel.addRecv(other);
+            sel.addRecv(ch);
+            svher::IOManager::GetThis()->addTimer(10, [&ch, &got]() {
+                svher::IOManager::GetThis()->schedule([&ch, &got]() {
+                    int v;
+                    ASSERT(ch.recv(v) && v == 1);
+                    got = true;
+                });
+            });
+            svher::IOManager::GetThis()->addTimer(20, [&ch, &other]() {
+                ch.send(1);
+                other.send(0);
+            });
+            ASSERT(sel.wait() == ro);
+            int v;
+            ASSERT(other.tryRecv(v) && v == 0);
+        });
+    }
+    ASSERT(got);
+    LOG_INFO(g_logger) << "pass ok";
+}
+
+// 选中 fd 分支后、select 协程恢复前，另一个协程在同一 fd 上注册了读等待，返回时不能撤销它
+// 单线程调度下，idle 先调度到期的定时器，再调度 fd 事件
+void test_rearm() {
+    int fds[2];
+    std::atomic<bool> got{false};
+    {
+        svher::IOManager iom(1, false);
+        iom.schedule([&]() {
+            ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+            svher::IOManager::GetThis()->schedule([&]() {
+                usleep(20 * 1000);
+                ASSERT(write(fds[1], "a", 1) == 1);
+                uint64_t until = svher::GetCurrentMS() + 10;
+                while (svher::GetCurrentMS() < until);
+                usleep(0);
+                char c;
+                ASSERT(read_f(fds[0], &c, 1) == 1 && c == 'a');
+                ASSERT(read(fds[0], &c, 1) == 1 && c == 'b');
+                got = true;
+            });
+            svher::Selector sel;
+            int rf = sel.addRead(fds[0]);
+            ASSERT(sel.wait() == rf);
+
+            // 同一事件已被占用时返回 EINVAL 而不是断言失败
+            svher::Selector busy;
+            busy.addRead(fds[0]);
+            ASSERT(busy.wait() == -1 && errno == EINVAL);
+
+            ASSERT(write(fds[1], "b", 1) == 1);
+            uint64_t deadline = svher::GetCurrentMS() + 1000;
+            while (!got && svher::GetCurrentMS() < deadline) {
+                usleep(10 * 1000);
+            }
+            ASSERT(got);
+        });
+    }
+    close(fds[0]);
+    close(fds[1]);
+    LOG_INFO(g_logger) << "rearm ok";
+}
+
+void test_deadline() {
+    svher::Channel<int> ch;
+    svher::Selector sel;
+    sel.addRecv(ch);
+    svher::DeadlineScope scope(30);
+    ASSERT(sel.wait() == -1 && errno == ETIMEDOUT);
+    LOG_INFO(g_logger) << "deadline ok";
+}
+
+int main(int argc, char** argv) {
+    test_pass();
+    test_rearm();
+    svher::IOManager iom(2, false);
+    iom.schedule([]() {
+        test_fds();
+        test_channel();
+        test_deadline();
+    });
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include "webserver.h"
+#include <unordered_map>
+
+static svher::Logger::ptr g_logger = LOG_ROOT();
+
+// 格式与 Address::toString 一致
+void test_format() {
+    for (auto& i : std::vector<std::pair<const char*, uint16_t>>{
+            {"127.0.0.1", 8080}, {"0.0.0.0", 0}, {"255.255.255.255", 65535}, {"10.1.20.3", 80}}) {
+        svher::Address::ptr addr = svher::IPv4Address::Create(i.first, i.second);
+        svher::SockAddr sa(*addr);
+        ASSERT(sa.toString() == addr->toString());
+        ASSERT(sa.getPort() == i.second && sa.getFamily() == AF_INET);
+        svher::SockAddr parsed;
+        ASSERT(svher::SockAddr::Parse(i.first, i.second, parsed) && parsed == sa);
+    }
+    ASSERT(svher::SockAddr::IPv4(0x7f000001, 80).toString() == "127.0.0.1:80");
+
+    svher::SockAddr v6;
+    ASSERT(svher::SockAddr::Parse("fe80::1", 443, v6));
+    ASSERT(v6.getFamily() == AF_INET6 && v6.toString() == "[fe80::1]:443");
+    svher::SockAddr bad;
+    ASSERT(!svher::SockAddr::Parse("not an ip", 0, bad) && bad.empty());
+
+    svher::UnixAddress unix_addr("/tmp/test.sock");
+    ASSERT(svher::SockAddr(unix_addr).toString() == unix_addr.toString());
+    svher::UnixAddress abstract_addr(std::string("\0abstract", 9));
+    ASSERT(svher::SockAddr(abstract_addr).toString() == abstract_addr.toString());
+
+    // 缓冲区不足时截断并以 '\0' 结尾
+    char buf[8];
+    ASSERT(svher::SockAddr::IPv4(0x7f000001, 8080).format(buf, sizeof(buf)) == 7);
+    ASSERT(strcmp(buf, "127.0.0") == 0);
+    LOG_INFO(g_logger) << "format ok";
+}
+
+void test_hash() {
+    std::unordered_map<svher::SockAddr, int> m;
+    for (int i = 0; i < 1000; ++i) {
+        m[svher::SockAddr::IPv4(0x0a000000 + i, 80)] = i;
+    }
+    ASSERT(m.size() == 1000);
+    ASSERT(m[svher::SockAddr::IPv4(0x0a000000 + 42, 80)] == 42);
+    ASSERT(m.count(svher::SockAddr::IPv4(0x0a000000 + 42, 81)) == 0);
+    // 与 Address 互相转换
+    svher::Address::ptr addr = svher::IPv4Address::Create("192.168.1.2", 53);
+    svher::SockAddr sa(*addr);
+    ASSERT(*sa.toAddress() == *addr);
+    ASSERT(svher::SockAddr(*svher::SockAddr(svher::UnixAddress("/tmp/x")).toAddress()).toString() == "/tmp/x");
+    LOG_INFO(g_logger) << "hash ok";
+}
+
+// accept 与 recvFrom 直接得到 SockAddr
+void test_socket() {
+    svher::Address::ptr any = svher::IPv4Address::Create("127.0.0.1", 0);
+    svher::Socket::ptr listener = svher::Socket::CreateTCP(any);
+    ASSERT(listener->bind(any) && listener->listen());
+    ASSERT(listener->getLocalSockAddr().getPort() != 0);
+    svher::Socket::ptr client = svher::Socket::CreateTCP(any);
+    ASSERT(client->connect(listener->getLocalAddress()));
+    svher::Socket::ptr server = listener->accept();
+    ASSERT(server);
+    ASSERT(server->getRemoteSockAddr() == client->getLocalSockAddr());
+    ASSERT(client->getRemoteSockAddr() == listener->getLocalSockAddr());
+    ASSERT(server->getRemoteAddress()->toString() == client->getLocalAddress()->toString());
+    ASSERT(server->getLocalAddress()->toString() == listener->getLocalAddress()->toString());
+
+    svher::Socket::ptr udp = svher::Socket::CreateUDP(any);
+    ASSERT(udp->bind(any));
+    svher::Socket::ptr sender = svher::Socket::CreateUDP(any);
+    ASSERT(sender->bind(any));
+    ASSERT(sender->sendTo("hi", 2, udp->getLocalSockAddr()) == 2);
+    char buf[16];
+    svher::SockAddr from;
+    ASSERT(udp->recvFrom(buf, sizeof(buf), from) == 2);
+    ASSERT(from == sender->getLocalSockAddr());
+    LOG_INFO(g_logger) << "socket ok";
+}
+
+void bench() {
+    const int n = 1000000;
+    svher::Address::ptr addr = svher::IPv4Address::Create("192.168.100.200", 54321);
+    svher::SockAddr sa(*addr);
+    size_t total = 0;
+    uint64_t begin = svher::GetCurrentUS();
+    for (int i = 0; i < n; ++i) {
+        total += addr->toString().size();
+    }
+    uint64_t to_string = svher::GetCurrentUS() - begin;
+    char buf[svher::SockAddr::MAX_STRING];
+    begin = svher::GetCurrentUS();
+    for (int i = 0; i < n; ++i) {
+        total += sa.format(buf, sizeof(buf));
+    }
+    uint64_t format = svher::GetCurrentUS() - begin;
+
+    // 从 sockaddr 得到可比较的地址: 堆上的 Address 与值类型
+    sockaddr_in raw = *(sockaddr_in*)addr->getAddr();
+    begin = svher::GetCurrentUS();
+    for (int i = 0; i < n; ++i) {
+        svher::Address::ptr a = svher::Address::Create((sockaddr*)&raw, sizeof(raw));
+        total += a->getFamily();
+    }
+    uint64_t create = svher::GetCurrentUS() - begin;
+    begin = svher::GetCurrentUS();
+    for (int i = 0; i < n; ++i) {
+        svher::SockAddr a((sockaddr*)&raw, sizeof(raw));
+        total += a.hash() & 1;
+    }
+    uint64_t value = svher::GetCurrentUS() - begin;
+    LOG_INFO(g_logger) << n << " x: Address::toString " << to_string / 1000 << " ms, SockAddr::format "
+                       << format / 1000 << " ms; Address::Create " << create / 1000 << " ms, SockAddr + hash "
+                       << value / 1000 << " ms (" << total << ")";
+}
+
+int main(int argc, char** argv) {
+    test_format();
+    test_hash();
+    bench();
+    svher::IOManager iom(1, false);
+    iom.schedule(&test_socket);
+    return 0;
+}
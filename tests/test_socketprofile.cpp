@@ -0,0 +1,77 @@
+#include "webserver.h"
+
+static svher::Logger::ptr g_logger = LOG_ROOT();
+
+static void dump(const char* what, svher::Socket::ptr sock) {
+    std::stringstream ss;
+    for (auto& i : sock->getEffectiveOptions()) {
+        ss << " " << i.first << "=" << i.second;
+    }
+    LOG_INFO(g_logger) << what << " profile=" << sock->getProfile() << ss.str();
+}
+
+void test_profile() {
+    ASSERT(svher::Config::LookupBase("socket.profile")->fromString(
+            "default: {}\n"
+            "lowlatency: {nodelay: 1, quickack: 1, notsent_lowat: 16384}\n"
+            "server: {sndbuf: 1048576, keepalive: 1, keepidle: 30, keepintvl: 5, fastopen: 16}\n"));
+
+    svher::IPv4Address::ptr addr = svher::IPv4Address::Create("127.0.0.1", 0);
+    svher::Socket::ptr listener = svher::Socket::CreateTCP(addr);
+    ASSERT(listener->getProfile() == "default");
+    ASSERT(!listener->setProfile("nosuch"));
+    ASSERT(listener->setProfile("server"));
+    ASSERT(listener->bind(addr));
+    ASSERT(listener->listen());
+    auto opts = listener->getEffectiveOptions();
+    dump("listener", listener);
+    // 内核返回的缓冲区大小是设置值的两倍
+    ASSERT(opts["SO_SNDBUF"] >= 1048576);
+    ASSERT(opts["TCP_KEEPIDLE"] == 30);
+    ASSERT(opts["SO_KEEPALIVE"] == 1);
+
+    svher::Address::ptr local = listener->getLocalAddress();
+    svher::Socket::ptr client = svher::Socket::CreateTCP(local);
+    ASSERT(client->setProfile("lowlatency"));
+    ASSERT(client->connect(local));
+    opts = client->getEffectiveOptions();
+    dump("client", client);
+    ASSERT(opts["TCP_NODELAY"] == 1);
+    ASSERT(opts["TCP_NOTSENT_LOWAT"] == 16384);
+
+    // accept 得到的 socket 沿用监听方的方案
+    svher::Socket::ptr conn = listener->accept();
+    ASSERT(conn);
+    ASSERT(conn->getProfile() == "server");
+    opts = conn->getEffectiveOptions();
+    dump("accepted", conn);
+    ASSERT(opts["TCP_KEEPIDLE"] == 30);
+
+    // 修改配置后立即作用到已有的 socket
+    ASSERT(svher::Config::LookupBase("socket.profile")->fromString(
+            "default: {}\n"
+            "lowlatency: {nodelay: 1, quickack: 1, notsent_lowat: 16384}\n"
+            "server: {sndbuf: 1048576, keepalive: 1, keepidle: 60, keepintvl: 5, fastopen: 16}\n"));
+    ASSERT(conn->getEffectiveOptions()["TCP_KEEPIDLE"] == 60);
+    ASSERT(listener->getEffectiveOptions()["TCP_KEEPIDLE"] == 60);
+    ASSERT(client->getEffectiveOptions()["TCP_NOTSENT_LOWAT"] == 16384);
+
+    // 切换方案
+    ASSERT(conn->setProfile("lowlatency"));
+    ASSERT(conn->getEffectiveOptions()["TCP_NOTSENT_LOWAT"] == 16384);
+
+    // 关闭后不再跟踪
+    int fd = conn->getSocket();
+    conn->close();
+    ASSERT(svher::Config::LookupBase("socket.profile")->fromString(
+            "default: {}\nlowlatency: {nodelay: 1, notsent_lowat: 4096}\n"));
+    ASSERT(client->getEffectiveOptions()["TCP_NOTSENT_LOWAT"] == 4096);
+    LOG_INFO(g_logger) << "closed fd=" << fd;
+    LOG_INFO(g_logger) << svher::Config::LookupBase("socket.profile")->toString();
+}
+
+int main(int argc, char** argv) {
+    svher::IOManager iom(1, false);
+    iom.schedule(&test_profile);
+    return 0;
+}
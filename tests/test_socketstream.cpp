@@ -0,0 +1,100 @@
+#include "webserver.h"
+#include <sys/socket.h>
+
+static svher::Logger::ptr g_logger = LOG_ROOT();
+
+static void make_pair(svher::SocketStream::ptr& a, svher::SocketStream::ptr& b) {
+    int fds[2];
+    ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    svher::Socket::ptr sa(new svher::Socket(AF_UNIX, SOCK_STREAM, 0));
+    svher::Socket::ptr sb(new svher::Socket(AF_UNIX, SOCK_STREAM, 0));
+    ASSERT(sa->init(fds[0]) && sb->init(fds[1]));
+    a.reset(new svher::SocketStream(sa));
+    b.reset(new svher::SocketStream(sb));
+}
+
+// 逐字段读写的协议只在攒满或预读耗尽时才发生系统调用
+void test_fields() {
+    svher::SocketStream::ptr writer, reader;
+    make_pair(writer, reader);
+    const int count = 2000;
+    svher::IOManager::GetThis()->schedule([writer, count]() {
+        for (int i = 0; i < count; ++i) {
+            std::string payload(i % 100, 'a' + i % 26);
+            uint32_t len = payload.size();
+            ASSERT(writer->writeFixSize(&len, sizeof(len)) == sizeof(len));
+            ASSERT(writer->writeFixSize(payload.c_str(), payload.size()) == (int)payload.size());
+        }
+        ASSERT(writer->flush() == 0);
+        LOG_INFO(g_logger) << "writer fields=" << count * 2 << " send calls=" << writer->getWriteCalls();
+        ASSERT(writer->getWriteCalls() < 20);
+    });
+    for (int i = 0; i < count; ++i) {
+        uint32_t len = 0;
+        ASSERT(reader->readFixSize(&len, sizeof(len)) == sizeof(len));
+        ASSERT(len == (uint32_t)(i % 100));
+        std::string payload(len, 0);
+        if (len) {
+            ASSERT(reader->readFixSize(&payload[0], len) == (int)len);
+        }
+        ASSERT(payload == std::string(i % 100, 'a' + i % 26));
+    }
+    LOG_INFO(g_logger) << "reader fields=" << count * 2 << " recv calls=" << reader->getReadCalls();
+    ASSERT(reader->getReadCalls() < 100);
+}
+
+// 大块数据直接在 ByteArray 节点和 socket 之间收发
+void test_bytearray() {
+    svher::SocketStream::ptr writer, reader;
+    make_pair(writer, reader);
+    const size_t total = 1024 * 1024 + 123;
+    svher::ByteArray::ptr out(new svher::ByteArray(4096));
+    for (size_t i = 0; i < total; ++i) {
+        out->writeFuint8(i * 13);
+    }
+    out->setPosition(0);
+    svher::IOManager::GetThis()->schedule([writer, out, total]() {
+        ASSERT(writer->writeFixSize(out, total) == (int)total);
+        ASSERT(out->getReadSize() == 0);
+        writer->close();
+    });
+    svher::ByteArray::ptr in(new svher::ByteArray(1000));
+    ASSERT(reader->readFixSize(in, total) == (int)total);
+    char c;
+    ASSERT(reader->read(&c, 1) == 0);
+    in->setPosition(0);
+    for (size_t i = 0; i < total; ++i) {
+        ASSERT(in->readFuint8() == (uint8_t)(i * 13));
+    }
+    LOG_INFO(g_logger) << "bytearray ok recv calls=" << reader->getReadCalls();
+}
+
+// 读之前自动发出缓冲的请求，一问一答不会互相等待
+void test_pingpong() {
+    svher::SocketStream::ptr client, server;
+    make_pair(client, server);
+    svher::IOManager::GetThis()->schedule([server]() {
+        char buf[4];
+        while (server->readFixSize(buf, 4) == 4) {
+            server->writeFixSize(buf, 4);
+        }
+    });
+    for (int i = 0; i < 100; ++i) {
+        ASSERT(client->writeFixSize(&i, 4) == 4);
+        ASSERT(client->getWriteBuffered() == 4);
+        int v = -1;
+        ASSERT(client->readFixSize(&v, 4) == 4 && v == i);
+    }
+    client->close();
+    LOG_INFO(g_logger) << "pingpong ok";
+}
+
+int main(int argc, char** argv) {
+    svher::IOManager iom(2, false);
+    iom.schedule([]() {
+        test_fields();
+        test_bytearray();
+        test_pingpong();
+    });
+    return 0;
+}
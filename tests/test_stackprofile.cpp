@@ -0,0 +1,74 @@
+#include "webserver.h"
+#include <cstring>
+
+static svher::Logger::ptr g_logger = LOG_ROOT();
+
+// 非 static 函数，-rdynamic 下调度点可以显示符号名
+void deep_handler() {
+    char buf[200 * 1024];
+    memset(buf, 1, sizeof(buf));
+    asm volatile("" : : "r"(buf) : "memory");
+}
+
+void shallow_handler() {
+    int x = 1;
+    asm volatile("" : : "r"(&x) : "memory");
+}
+
+static const svher::StackSiteStats* find_site(const std::vector<svher::StackSiteStats>& sites,
+                                              const std::string& name) {
+    for (auto& i : sites) {
+        if (i.site.find(name) != std::string::npos) {
+            return &i;
+        }
+    }
+    return nullptr;
+}
+
+void test_classes() {
+    ASSERT(svher::Fiber::GetStackClassSize("small") == 64 * 1024);
+    ASSERT(svher::Fiber::GetStackClassSize("large") == 8 * 1024 * 1024);
+    uint32_t def = svher::Config::Lookup<uint32_t>("fiber.stack_size")->getValue();
+    ASSERT(svher::Fiber::GetStackClassSize("default") == def);
+    ASSERT(svher::Fiber::GetStackClassSize("unknown") == def);
+    svher::Fiber::ptr fiber = svher::Fiber::Create(shallow_handler, "small");
+    ASSERT(fiber->getStackSize() == 64 * 1024);
+    svher::Fiber large(shallow_handler, "large");
+    ASSERT(large.getStackSize() == 8 * 1024 * 1024);
+    LOG_INFO(g_logger) << "classes ok";
+}
+
+void test_profile() {
+    svher::Config::Lookup<bool>("fiber.stack_profile")->setValue(true);
+    svher::StackProfile::Clear();
+    {
+        svher::IOManager iom(1, false);
+        for (int i = 0; i < 100; ++i) {
+            iom.schedule(shallow_handler);
+        }
+        for (int i = 0; i < 10; ++i) {
+            iom.schedule(deep_handler);
+        }
+        // 显式指定小栈的协程同样统计
+        iom.schedule(svher::Fiber::Create(shallow_handler, "small"));
+    }
+    auto sites = svher::StackProfile::GetSites();
+    LOG_INFO(g_logger) << "stack profile:" << std::endl << svher::StackProfile::Dump();
+    auto deep = find_site(sites, "deep_handler");
+    auto shallow = find_site(sites, "shallow_handler");
+    ASSERT(deep && shallow);
+    ASSERT(deep->count == 10);
+    ASSERT(deep->maxUsed >= 200 * 1024 && deep->maxUsed < 256 * 1024);
+    ASSERT(deep->suggest == "default");
+    ASSERT(shallow->count == 101);
+    ASSERT(shallow->maxUsed < 32 * 1024);
+    ASSERT(shallow->suggest == "small");
+    svher::Config::Lookup<bool>("fiber.stack_profile")->setValue(false);
+    LOG_INFO(g_logger) << "profile ok";
+}
+
+int main(int argc, char** argv) {
+    test_classes();
+    test_profile();
+    return 0;
+}
@@ -0,0 +1,136 @@
+#include "webserver.h"
+
+static svher::Logger::ptr g_logger = LOG_ROOT();
+
+static void echo(svher::Socket::ptr client) {
+    char buf[256];
+    while (true) {
+        int ret = client->recv(buf, sizeof(buf));
+        if (ret <= 0) {
+            break;
+        }
+        client->send(buf, ret);
+    }
+}
+
+// 每个客户端协程依次建立连接、收发一次后以 RST 关闭，避免 TIME_WAIT 占满端口
+static void run_clients(svher::Address::ptr addr, size_t total, size_t concurrency, std::atomic<size_t>& done) {
+    svher::FiberSemaphore finished;
+    std::atomic<size_t> next{0};
+    for (size_t c = 0; c < concurrency; ++c) {
+        svher::IOManager::GetThis()->schedule([&]() {
+            while (next++ < total) {
+                svher::Socket::ptr sock = svher::Socket::CreateTCP(addr);
+                linger lg{1, 0};
+                sock->setOption(SOL_SOCKET, SO_LINGER, lg);
+                if (!sock->connect(addr)) {
+                    continue;
+                }
+                char buf[4] = {'p', 'i', 'n', 'g'};
+                char rsp[4];
+                if (sock->send(buf, 4) == 4 && sock->recv(rsp, 4) == 4) {
+                    ++done;
+                }
+            }
+            finished.notify();
+        });
+    }
+    for (size_t c = 0; c < concurrency; ++c) {
+        finished.wait();
+    }
+}
+
+static void bench(const char* name, svher::IOManager* client_iom, std::vector<svher::IOManager*> acceptors,
+                  std::vector<svher::IOManager*> workers, size_t listeners) {
+    svher::TcpServer::ptr server(new svher::TcpServer(workers[0], acceptors[0]));
+    server->setAcceptors(acceptors);
+    server->setWorkers(workers);
+    server->setHandler(&echo);
+    svher::Address::ptr addr = svher::IPv4Address::Create("127.0.0.1", 0);
+    ASSERT(server->bind(addr, listeners));
+    ASSERT(server->getSocks().size() == listeners);
+    svher::Address::ptr local = server->getSocks()[0]->getLocalAddress();
+    ASSERT(server->start());
+
+    const size_t total = 5000;
+    std::atomic<size_t> done{0};
+    uint64_t begin = svher::GetCurrentMS();
+    svher::FiberSemaphore finished;
+    client_iom->schedule([&]() {
+        run_clients(local, total, 64, done);
+        finished.notify();
+    });
+    finished.wait();
+    uint64_t used = svher::GetCurrentMS() - begin;
+    LOG_INFO(g_logger) << name << ": " << done << "/" << total << " connections in " << used << " ms, "
+                       << done * 1000 / (used ? used : 1) << " cps, accepted " << server->getAcceptCount();
+    ASSERT(done == total);
+    ASSERT(server->getAcceptCount() == total);
+    server->stop();
+}
+
+// stop 后未结束的连接被 shutdown，处理协程退出
+void test_stop() {
+    svher::TcpServer::ptr server(new svher::TcpServer());
+    std::atomic<int> exited{0};
+    server->setHandler([&exited](svher::Socket::ptr client) {
+        char buf[16];
+        client->recv(buf, sizeof(buf));
+        ++exited;
+    });
+    ASSERT(server->bind(svher::IPv4Address::Create("127.0.0.1", 0)));
+    svher::Address::ptr local = server->getSocks()[0]->getLocalAddress();
+    ASSERT(server->start());
+    std::vector<svher::Socket::ptr> clients;
+    for (int i = 0; i < 10; ++i) {
+        svher::Socket::ptr sock = svher::Socket::CreateTCP(local);
+        ASSERT(sock->connect(local));
+        clients.push_back(sock);
+    }
+    while (server->getConnectionCount() < 10) {
+        usleep(1000);
+    }
+    server->stop();
+    // 处理函数返回后 runClient 才把连接移出集合，这里轮询等待
+    uint64_t deadline = svher::GetCurrentMS() + 1000;
+    while ((exited < 10 || server->getConnectionCount() > 0) && svher::GetCurrentMS() < deadline) {
+        usleep(1000);
+    }
+    ASSERT(exited == 10 && server->getConnectionCount() == 0);
+    // 停止后监听 socket 仍打开 (便于交给新进程)，内核可以完成握手，但不再 accept
+    uint64_t accepted = server->getAcceptCount();
+    svher::Socket::ptr late = svher::Socket::CreateTCP(local);
+    ASSERT(late->connect(local, 200));
+    usleep(50 * 1000);
+    ASSERT(server->getAcceptCount() == accepted && server->getConnectionCount() == 0);
+    // 监听协程退出、server 释放后监听 socket 关闭，新连接被拒绝
+    server.reset();
+    bool refused = false;
+    deadline = svher::GetCurrentMS() + 1000;
+    while (!refused && svher::GetCurrentMS() < deadline) {
+        refused = !svher::Socket::CreateTCP(local)->connect(local, 200);
+        if (!refused) {
+            usleep(10 * 1000);
+        }
+    }
+    ASSERT(refused);
+    LOG_INFO(g_logger) << "stop ok";
+}
+
+int main(int argc, char** argv) {
+    svher::IOManager clients(2, false, "client");
+    svher::IOManager acceptor0(1, false, "accept0");
+    svher::IOManager acceptor1(1, false, "accept1");
+    svher::IOManager workers(4, false, "worker");
+    // 测试结束前不能析构任何一个 IOManager
+    svher::Semaphore done;
+    clients.schedule([&]() {
+        test_stop();
+        bench("single listener", &clients, {&acceptor0}, {&workers}, 1);
+        bench("shared listener, 2 acceptors (EPOLLEXCLUSIVE)", &clients, {&acceptor0, &acceptor1}, {&workers}, 1);
+        bench("4 SO_REUSEPORT listeners", &clients, {&acceptor0, &acceptor1}, {&workers}, 4);
+        done.notify();
+    });
+    done.wait();
+    return 0;
+}
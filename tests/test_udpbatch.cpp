@@ -0,0 +1,183 @@
+#include "webserver.h"
+
+static svher::Logger::ptr g_logger = LOG_ROOT();
+
+static svher::Socket::ptr bind_udp(bool gro) {
+    svher::IPv4Address::ptr addr = svher::IPv4Address::Create("127.0.0.1", 0);
+    svher::Socket::ptr sock = svher::Socket::CreateUDP(addr);
+    ASSERT(sock->bind(addr));
+    sock->setOption(SOL_SOCKET, SO_RCVBUF, 8 * 1024 * 1024);
+    sock->setRecvTimeout(300);
+    if (gro && !sock->setGRO(true)) {
+        LOG_INFO(g_logger) << "UDP_GRO not supported";
+    }
+    return sock;
+}
+
+// GSO 合并的报文在两端都按原样拆出
+void test_gso(bool gro) {
+    svher::Socket::ptr server = bind_udp(gro);
+    svher::Address::ptr to = server->getLocalAddress();
+    svher::Socket::ptr client = svher::Socket::CreateUDP(to);
+
+    svher::UdpBatch out(4, 64 * 1024, true);
+    std::vector<std::string> sent;
+    for (int i = 0; i < 100; ++i) {
+        // 最后一个短报文结束当前合并
+        std::string msg(i % 50 == 49 ? 10 : 1000, 'a' + i % 26);
+        ASSERT(out.add(msg.c_str(), msg.size(), to));
+        sent.push_back(msg);
+    }
+    ASSERT(out.size() == 2);
+    ASSERT(out.getDatagramCount() == 100);
+    int ret = client->sendBatch(out);
+    if (ret < 0) {
+        LOG_INFO(g_logger) << "UDP_SEGMENT not supported errno=" << errno;
+        return;
+    }
+    ASSERT(ret == 2 && out.empty());
+
+    svher::UdpBatch in(8, 64 * 1024);
+    std::vector<std::string> received;
+    while (received.size() < sent.size()) {
+        ASSERT(server->recvBatch(in) > 0);
+        in.forEach([&](const char* data, size_t len, const sockaddr* addr, socklen_t addrlen) {
+            received.emplace_back(data, len);
+        });
+    }
+    ASSERT(received == sent);
+    LOG_INFO(g_logger) << "gso gro=" << gro << " ok, last segment=" << in.getSegmentSize(0)
+                       << " from " << in.getAddress(0)->toString();
+}
+
+// 中途失败时未发出的槽位留在 batch 中
+void test_partial() {
+    svher::Socket::ptr server = bind_udp(false);
+    svher::Address::ptr to = server->getLocalAddress();
+    svher::Socket::ptr client = svher::Socket::CreateUDP(to);
+
+    svher::UdpBatch out(8);
+    for (int i = 0; i < 3; ++i) {
+        ASSERT(out.add("ok", 2, to));
+    }
+    // IPv4 socket 发不到 IPv6 地址
+    sockaddr_in6 bad;
+    memset(&bad, 0, sizeof(bad));
+    bad.sin6_family = AF_INET6;
+    bad.sin6_addr = in6addr_loopback;
+    bad.sin6_port = htons(9);
+    ASSERT(out.add("bad", 3, (const sockaddr*)&bad, sizeof(bad)));
+    ASSERT(out.add("late", 4, to));
+    int ret = client->sendBatch(out);
+    ASSERT(ret == 3);
+    ASSERT(out.size() == 2);
+    ASSERT(out.getAddr(0)->sa_family == AF_INET6);
+    ASSERT(std::string(out.getData(1), out.getLength(1)) == "late");
+    ASSERT(client->sendBatch(out) == -1 && out.size() == 2);
+
+    svher::UdpBatch in(8);
+    int got = 0;
+    while (got < 3) {
+        ASSERT(server->recvBatch(in) > 0);
+        got += in.size();
+    }
+    ASSERT(got == 3);
+    LOG_INFO(g_logger) << "partial ok";
+}
+
+// 拒绝 UDP_SEGMENT 时拆成单个报文重发
+void test_gso_fallback() {
+    svher::Socket::ptr server = bind_udp(false);
+    svher::Address::ptr to = server->getLocalAddress();
+    svher::Socket::ptr client = svher::Socket::CreateUDP(to);
+    // 关闭校验和后内核对 UDP_SEGMENT 返回 EINVAL
+    int on = 1;
+    client->setOption(SOL_SOCKET, SO_NO_CHECK, on);
+
+    svher::UdpBatch out(4, 64 * 1024, true);
+    std::vector<std::string> sent;
+    for (int i = 0; i < 60; ++i) {
+        std::string msg(i == 29 ? 10 : 500, 'a' + i % 26);
+        ASSERT(out.add(msg.c_str(), msg.size(), to));
+        sent.push_back(msg);
+    }
+    ASSERT(out.size() == 2);
+    ASSERT(client->sendBatch(out) == 2 && out.empty());
+
+    svher::UdpBatch in(64);
+    std::vector<std::string> received;
+    while (received.size() < sent.size()) {
+        ASSERT(server->recvBatch(in) > 0);
+        in.forEach([&](const char* data, size_t len, const sockaddr* addr, socklen_t addrlen) {
+            received.emplace_back(data, len);
+        });
+    }
+    ASSERT(received == sent);
+    LOG_INFO(g_logger) << "gso fallback ok";
+}
+
+static const size_t PAYLOAD = 100;
+static const size_t COUNT = 200000;
+
+enum Mode {
+    SINGLE,
+    BATCH,
+    GSO
+};
+
+static void bench(Mode mode) {
+    svher::Socket::ptr server = bind_udp(mode == GSO);
+    svher::Address::ptr to = server->getLocalAddress();
+    svher::Socket::ptr client = svher::Socket::CreateUDP(to);
+    std::atomic<size_t> received{0};
+    svher::FiberSemaphore done;
+    svher::IOManager::GetThis()->schedule([&]() {
+        svher::UdpBatch in(64, mode == GSO ? 64 * 1024 : 2048);
+        svher::Address::ptr from = svher::IPv4Address::Create("0.0.0.0", 0);
+        char buf[2048];
+        while (received < COUNT) {
+            if (mode == SINGLE) {
+                if (server->recvFrom(buf, sizeof(buf), from) <= 0) break;
+                ++received;
+            } else {
+                if (server->recvBatch(in) <= 0) break;
+                received += in.getDatagramCount();
+            }
+        }
+        done.notify();
+    });
+
+    char payload[PAYLOAD] = {0};
+    svher::UdpBatch out(64, mode == GSO ? PAYLOAD * svher::UdpBatch::MAX_SEGMENTS : PAYLOAD, mode == GSO);
+    uint64_t begin = svher::GetCurrentUS();
+    for (size_t i = 0; i < COUNT; ++i) {
+        if (mode == SINGLE) {
+            client->sendTo(payload, PAYLOAD, to);
+        } else if (!out.add(payload, PAYLOAD, to)) {
+            client->sendBatch(out);
+            out.add(payload, PAYLOAD, to);
+        }
+    }
+    if (!out.empty()) {
+        client->sendBatch(out);
+    }
+    uint64_t used = svher::GetCurrentUS() - begin;
+    done.wait();
+    static const char* names[] = {"sendto/recvfrom", "sendmmsg/recvmmsg", "gso/gro"};
+    LOG_INFO(g_logger) << names[mode] << ": send " << COUNT * 1000000 / (used ? used : 1)
+                       << " pps, received " << received << "/" << COUNT;
+}
+
+int main(int argc, char** argv) {
+    svher::IOManager iom(2, false);
+    iom.schedule([]() {
+        test_gso(true);
+        test_gso(false);
+        test_partial();
+        test_gso_fallback();
+        bench(SINGLE);
+        bench(BATCH);
+        bench(GSO);
+    });
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include "webserver.h"
+
+static svher::Logger::ptr g_logger = LOG_ROOT();
+
+// 不经过任何 hook 调用的计算循环，只在安全点检查抢占
+static void spin(uint64_t ms) {
+    uint64_t end = svher::GetMonotonicNS() + ms * 1000 * 1000;
+    while (svher::GetMonotonicNS() < end) {
+        svher::PreemptPoint();
+    }
+}
+
+// 单线程上一个死循环的协程，返回其他任务开始执行时已过去的毫秒数
+static uint64_t run_starved() {
+    uint64_t begin = svher::GetCurrentMS();
+    std::atomic<uint64_t> other{0};
+    {
+        svher::IOManager iom(1, false);
+        iom.schedule([]() {
+            spin(600);
+        });
+        iom.schedule([&other, begin]() {
+            other = svher::GetCurrentMS() - begin;
+        });
+    }
+    return other;
+}
+
+void test_detect() {
+    svher::Config::Lookup<bool>("watchdog.preempt")->setValue(false);
+    uint64_t slices = svher::Watchdog::GetLongSlices();
+    uint64_t other = run_starved();
+    ASSERT(other >= 600);
+    ASSERT(svher::Watchdog::GetLongSlices() == slices + 1);
+    ASSERT(svher::Watchdog::GetPreemptYields() == 0);
+    LOG_INFO(g_logger) << "detect ok, other task waited " << other << "ms";
+}
+
+void test_preempt() {
+    svher::Config::Lookup<bool>("watchdog.preempt")->setValue(true);
+    uint64_t yields = svher::Watchdog::GetPreemptYields();
+    uint64_t other = run_starved();
+    // 时间片 100ms，检查周期 25ms
+    ASSERT(other < 200);
+    ASSERT(svher::Watchdog::GetPreemptYields() > yields);
+    ASSERT(svher::Watchdog::GetPreemptRequests() >= svher::Watchdog::GetPreemptYields());
+    LOG_INFO(g_logger) << "preempt ok, other task waited " << other << "ms"
+                       << " long_slices=" << svher::Watchdog::GetLongSlices()
+                       << " yields=" << svher::Watchdog::GetPreemptYields();
+}
+
+int main(int argc, char** argv) {
+    svher::Config::Lookup<uint32_t>("watchdog.slice_ms")->setValue(100);
+    svher::Config::Lookup<bool>("watchdog.enable")->setValue(true);
+    ASSERT(svher::Watchdog::IsRunning());
+    test_detect();
+    test_preempt();
+    svher::Config::Lookup<bool>("watchdog.enable")->setValue(false);
+    return 0;
+}
@@ -0,0 +1,204 @@
+#include "webserver.h"
+
+static svher::Logger::ptr g_logger = LOG_ROOT();
+
+// 建立一条本机 TCP 连接，缩小缓冲区让背压尽快出现
+static std::pair<svher::Socket::ptr, svher::Socket::ptr> connect_pair() {
+    svher::Address::ptr addr = svher::IPv4Address::Create("127.0.0.1", 0);
+    svher::Socket::ptr listener = svher::Socket::CreateTCP(addr);
+    // 接受的连接继承监听 socket 的接收缓冲区
+    listener->setOption(SOL_SOCKET, SO_RCVBUF, 16 * 1024);
+    ASSERT(listener->bind(addr) && listener->listen());
+    svher::Address::ptr local = listener->getLocalAddress();
+    svher::Socket::ptr client = svher::Socket::CreateTCP(local);
+    client->setOption(SOL_SOCKET, SO_SNDBUF, 16 * 1024);
+    ASSERT(client->connect(local));
+    svher::Socket::ptr server = listener->accept();
+    ASSERT(server);
+    return std::make_pair(client, server);
+}
+
+static size_t read_all(const svher::Socket::ptr& sock, std::string& out) {
+    char buf[64 * 1024];
+    while (true) {
+        int n = sock->recv(buf, sizeof(buf));
+        if (n <= 0) {
+            break;
+        }
+        out.append(buf, n);
+    }
+    return out.size();
+}
+
+struct Record {
+    uint32_t producer;
+    uint32_t seq;
+    uint64_t padding;
+};
+
+// 多个生产者并发写入，每条记录完整且各自有序，小块合并发送
+void test_order() {
+    auto conn = connect_pair();
+    svher::WriteQueue::ptr queue(new svher::WriteQueue(conn.first));
+    const uint32_t producers = 4;
+    const uint32_t count = 20000;
+    svher::FiberSemaphore finished;
+    for (uint32_t p = 0; p < producers; ++p) {
+        svher::IOManager::GetThis()->schedule([&, p]() {
+            for (uint32_t i = 0; i < count; ++i) {
+                Record r{p, i, 0};
+                ASSERT(queue->push(&r, sizeof(r)) == 0);
+            }
+            finished.notify();
+        });
+    }
+    std::string data;
+    svher::FiberSemaphore received;
+    svher::IOManager::GetThis()->schedule([&]() {
+        read_all(conn.second, data);
+        received.notify();
+    });
+    for (uint32_t p = 0; p < producers; ++p) {
+        finished.wait();
+    }
+    ASSERT(queue->flush() == 0);
+    ASSERT(queue->getQueued() == 0);
+    conn.first->close();
+    received.wait();
+    ASSERT(data.size() == producers * count * sizeof(Record));
+    std::vector<uint32_t> next(producers, 0);
+    const Record* records = (const Record*)data.data();
+    for (size_t i = 0; i < data.size() / sizeof(Record); ++i) {
+        ASSERT(records[i].producer < producers);
+        ASSERT(records[i].seq == next[records[i].producer]++);
+    }
+    LOG_INFO(g_logger) << "order ok: " << producers * count << " pushes, " << queue->getSendCalls() << " sendmsg";
+    ASSERT(queue->getSendCalls() < producers * count / 10);
+}
+
+// 对端不读时排队量停在高水位附近，push 挂起；对端恢复读取后全部送达
+void test_backpressure() {
+    auto conn = connect_pair();
+    svher::WriteQueue::ptr queue(new svher::WriteQueue(conn.first));
+    queue->setWatermarks(64 * 1024, 256 * 1024);
+    std::vector<char> chunk(4096, 'w');
+    size_t pushed = 0;
+    {
+        svher::DeadlineScope scope(100);
+        while (true) {
+            int rt = queue->push(&chunk[0], chunk.size());
+            if (rt) {
+                ASSERT(rt == ETIMEDOUT);
+                break;
+            }
+            pushed += chunk.size();
+        }
+    }
+    ASSERT(queue->getBlockCount() == 1);
+    ASSERT(queue->getPeakQueued() < 256 * 1024 + chunk.size());
+    // 超时返回时发送协程可能刚发出一点，等它也停在内核缓冲区上
+    usleep(20 * 1000);
+    int rt;
+    while (!(rt = queue->tryPush(&chunk[0], chunk.size()))) {
+        pushed += chunk.size();
+    }
+    ASSERT(rt == EAGAIN && !queue->isWritable());
+
+    std::string data;
+    svher::FiberSemaphore received;
+    svher::IOManager::GetThis()->schedule([&]() {
+        read_all(conn.second, data);
+        received.notify();
+    });
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT(queue->push(&chunk[0], chunk.size()) == 0);
+        pushed += chunk.size();
+    }
+    ASSERT(queue->flush() == 0);
+    conn.first->close();
+    received.wait();
+    ASSERT(data.size() == pushed);
+    ASSERT(queue->getPeakQueued() < 256 * 1024 + chunk.size());
+    LOG_INFO(g_logger) << "backpressure ok: pushed " << pushed << " peak " << queue->getPeakQueued()
+                       << " blocks " << queue->getBlockCount();
+}
+
+// 对端复位后 push 返回发送错误；close 唤醒挂起的 push
+void test_error() {
+    auto conn = connect_pair();
+    svher::WriteQueue::ptr queue(new svher::WriteQueue(conn.first));
+    queue->setWatermarks(16 * 1024, 64 * 1024);
+    linger lg{1, 0};
+    conn.second->setOption(SOL_SOCKET, SO_LINGER, lg);
+    conn.second->close();
+    std::vector<char> chunk(4096, 'e');
+    int rt = 0;
+    for (int i = 0; i < 1000 && !rt; ++i) {
+        rt = queue->push(&chunk[0], chunk.size());
+        if (!rt) {
+            rt = queue->flush();
+        }
+    }
+    ASSERT(rt == ECONNRESET || rt == EPIPE);
+    ASSERT(queue->push(&chunk[0], chunk.size()) == rt);
+
+    auto conn2 = connect_pair();
+    svher::WriteQueue::ptr queue2(new svher::WriteQueue(conn2.first));
+    queue2->setWatermarks(16 * 1024, 64 * 1024);
+    svher::IOManager::GetThis()->addTimer(50, [queue2]() {
+        queue2->close();
+    });
+    while (!(rt = queue2->push(&chunk[0], chunk.size()))) {
+    }
+    ASSERT(rt == EPIPE);
+    ASSERT(queue2->getQueued() < 64 * 1024 + chunk.size());
+    LOG_INFO(g_logger) << "error ok";
+}
+
+// 小消息逐条 send 与经队列合并发送对比
+void bench() {
+    const size_t count = 200000;
+    char msg[64] = {0};
+    uint64_t used[2];
+    uint64_t calls[2];
+    for (int mode = 0; mode < 2; ++mode) {
+        auto conn = connect_pair();
+        std::string data;
+        svher::FiberSemaphore received;
+        svher::IOManager::GetThis()->schedule([&]() {
+            read_all(conn.second, data);
+            received.notify();
+        });
+        uint64_t begin = svher::GetCurrentMS();
+        if (mode == 0) {
+            for (size_t i = 0; i < count; ++i) {
+                ASSERT(conn.first->send(msg, sizeof(msg)) == sizeof(msg));
+            }
+            calls[mode] = count;
+        } else {
+            svher::WriteQueue::ptr queue(new svher::WriteQueue(conn.first));
+            for (size_t i = 0; i < count; ++i) {
+                ASSERT(queue->push(msg, sizeof(msg)) == 0);
+            }
+            ASSERT(queue->flush() == 0);
+            calls[mode] = queue->getSendCalls();
+        }
+        conn.first->close();
+        received.wait();
+        used[mode] = svher::GetCurrentMS() - begin;
+        ASSERT(data.size() == count * sizeof(msg));
+    }
+    LOG_INFO(g_logger) << count << " x 64B: send " << used[0] << " ms (" << calls[0] << " calls), write queue "
+                       << used[1] << " ms (" << calls[1] << " calls)";
+}
+
+int main(int argc, char** argv) {
+    svher::IOManager iom(2, false);
+    iom.schedule([]() {
+        test_order();
+        test_backpressure();
+        test_error();
+        bench();
+    });
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include "webserver.h"
+
+static svher::Logger::ptr g_logger = LOG_ROOT();
+
+static const size_t TOTAL = 8 * 1024 * 1024;
+
+void test_zerocopy() {
+    svher::IPv4Address::ptr addr = svher::IPv4Address::Create("127.0.0.1", 0);
+    svher::Socket::ptr listener = svher::Socket::CreateTCP(addr);
+    ASSERT(listener->bind(addr));
+    ASSERT(listener->listen());
+    svher::Address::ptr local = listener->getLocalAddress();
+    LOG_INFO(g_logger) << "listen on " << local->toString();
+
+    svher::IOManager::GetThis()->schedule([local]() {
+        svher::Socket::ptr client = svher::Socket::CreateTCP(local);
+        ASSERT(client->connect(local));
+        if (!client->setZeroCopy(true)) {
+            LOG_INFO(g_logger) << "SO_ZEROCOPY not supported, copy fallback";
+        }
+        std::shared_ptr<std::vector<char>> data(new std::vector<char>(TOTAL));
+        for (size_t i = 0; i < TOTAL; ++i) {
+            (*data)[i] = (char)(i * 7);
+        }
+        std::weak_ptr<std::vector<char>> weak(data);
+        // 小于阈值的发送直接拷贝，不占用在途记录
+        ASSERT(client->sendZeroCopy(&(*data)[0], 100, data) == 100);
+        ASSERT(client->getZeroCopyPending() == 0);
+        size_t offset = 100;
+        int sends = 0;
+        while (offset < TOTAL) {
+            int ret = client->sendZeroCopy(&(*data)[offset],
+                                           std::min<size_t>(TOTAL - offset, 256 * 1024), data);
+            ASSERT(ret > 0);
+            offset += ret;
+            ++sends;
+        }
+        data.reset();
+        LOG_INFO(g_logger) << "sends=" << sends << " pending=" << client->getZeroCopyPending();
+        ASSERT(client->flushZeroCopy(5000));
+        ASSERT(client->getZeroCopyPending() == 0);
+        // 所有完成通知收到后缓冲才释放
+        ASSERT(weak.expired());
+        LOG_INFO(g_logger) << "copied=" << client->getZeroCopyCopied();
+
+        // ByteArray 发送后读位置前移
+        svher::ByteArray::ptr ba(new svher::ByteArray(4096));
+        std::string payload(64 * 1024, 'z');
+        ba->write(payload.c_str(), payload.size());
+        ba->setPosition(0);
+        size_t left = payload.size();
+        while (left) {
+            int ret = client->sendZeroCopy(ba, left);
+            ASSERT(ret > 0);
+            left -= ret;
+        }
+        ASSERT(ba->getReadSize() == 0);
+        ASSERT(client->flushZeroCopy(5000));
+        client->close();
+    });
+
+    svher::Socket::ptr conn = listener->accept();
+    ASSERT(conn);
+    std::vector<char> buf(64 * 1024);
+    size_t received = 0;
+    while (received < TOTAL) {
+        int ret = conn->recv(&buf[0], std::min(buf.size(), TOTAL - received));
+        ASSERT(ret > 0);
+        for (int i = 0; i < ret; ++i) {
+            ASSERT(buf[i] == (char)((received + i) * 7));
+        }
+        received += ret;
+    }
+    size_t tail = 0;
+    while (tail < 64 * 1024) {
+        int ret = conn->recv(&buf[0], buf.size());
+        ASSERT(ret > 0);
+        for (int i = 0; i < ret; ++i) {
+            ASSERT(buf[i] == 'z');
+        }
+        tail += ret;
+    }
+    ASSERT(conn->recv(&buf[0], buf.size()) == 0);
+    conn->close();
+    listener->close();
+    LOG_INFO(g_logger) << "zerocopy ok";
+}
+
+// 对端不读时完成通知迟迟不到，析构不能等待
+void test_destroy_pending() {
+    svher::IPv4Address::ptr addr = svher::IPv4Address::Create("127.0.0.1", 0);
+    svher::Socket::ptr listener = svher::Socket::CreateTCP(addr);
+    ASSERT(listener->bind(addr));
+    ASSERT(listener->listen());
+    svher::Address::ptr local = listener->getLocalAddress();
+
+    svher::Socket::ptr client = svher::Socket::CreateTCP(local);
+    ASSERT(client->connect(local));
+    svher::Socket::ptr conn = listener->accept();
+    ASSERT(conn);
+    if (!client->setZeroCopy(true)) {
+        LOG_INFO(g_logger) << "SO_ZEROCOPY not supported, skip destroy test";
+        return;
+    }
+    std::shared_ptr<std::vector<char>> data(new std::vector<char>(256 * 1024, 'd'));
+    std::weak_ptr<std::vector<char>> weak(data);
+    ASSERT(client->sendZeroCopy(&(*data)[0], data->size(), data) > 0);
+    data.reset();
+    if (!client->getZeroCopyPending()) {
+        LOG_INFO(g_logger) << "zerocopy completed immediately, skip destroy test";
+        return;
+    }
+    uint64_t start = svher::GetCurrentMS();
+    client.reset();
+    uint64_t used = svher::GetCurrentMS() - start;
+    LOG_INFO(g_logger) << "destroy with pending zerocopy used " << used << "ms";
+    ASSERT(used < 500);
+    ASSERT(weak.expired());
+    conn->close();
+    listener->close();
+}
+
+int main(int argc, char** argv) {
+    svher::IOManager iom(2, false);
+    iom.schedule(&test_zerocopy);
+    iom.schedule(&test_destroy_pending);
+    return 0;
+}
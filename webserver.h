@@ -13,4 +13,26 @@
 #include "svher/hook.h"
 #include "svher/address.h"
 #include "svher/socket.h"
-#include "svher/bytearray.h"
\ No newline at end of file
+#include "svher/bytearray.h"
+#include "svher/dns.h"
+#include "svher/offload.h"
+#include "svher/fibersync.h"
+#include "svher/channel.h"
+#include "svher/future.h"
+#include "svher/fls.h"
+#include "svher/deadline.h"
+#include "svher/fiberstats.h"
+#include "svher/watchdog.h"
+#include "svher/fiberregistry.h"
+#include "svher/stackprofile.h"
+#include "svher/selector.h"
+#include "svher/udpbatch.h"
+#include "svher/socketprofile.h"
+#include "svher/tcpserver.h"
+#include "svher/stream.h"
+#include "svher/socketstream.h"
+#include "svher/connectionpool.h"
+#include "svher/relay.h"
+#include "svher/writequeue.h"
+#include "svher/fdhandoff.h"
+#include "svher/sockaddr.h"
\ No newline at end of file